@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "utils.h"
+
+//! \file
+//! \brief synthetic collection generator for benchmarks
+
+//! count of content subfolders
+#define GEN_FANOUT	4096
+//! minimal content size, unique prefix keeps generated files distinct
+#define GEN_MIN_SIZE	sizeof(uint64_t)
+
+static const char* usage="synthetic collection generator\n"
+"usage:\n"
+"gen -o folder [-n names] [-s sizes] [-u duplicates] [-p properties] [-r seed]\n"
+"\t-o folder\toutput folder, filelist is written to folder/filelist, content to folder/content/\n"
+"\t-n 1000\tcount of names\n"
+"\t-s lognormal:8:1\tcontent size distribution: fixed:N, uniform:MIN:MAX or lognormal:MU:SIGMA (of ln(size))\n"
+"\t-u 0.1\tratio of names pointing to already generated content\n"
+"\t-p 2\tproperties per name, cardinality of property k values is 16^(k+1)\n"
+"\t-r 1\trandom seed\n"
+"\n";
+
+typedef enum { SIZE_FIXED, SIZE_UNIFORM, SIZE_LOGNORMAL } size_dist_t;
+
+static uint64_t rng_state=1;
+
+//! splitmix64
+static uint64_t rng(void)
+{
+  uint64_t z=(rng_state+=0x9e3779b97f4a7c15ULL);
+  z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+  z=(z^(z>>27))*0x94d049bb133111ebULL;
+  return z^(z>>31);
+}
+
+static double rng_unit(void)
+{
+  return (rng()>>11)*(1.0/9007199254740992.0);
+}
+
+static double rng_normal(void)
+{
+  double u=rng_unit();
+  double v=rng_unit();
+// (log) is libm one, log() is message macro from common.h
+  return sqrt(-2*(log)(u+1e-300))*cos(2*M_PI*v);
+}
+
+static size_t gen_size(size_dist_t dist,double a,double b)
+{
+  double rv=a;
+  switch(dist)
+  {
+    case SIZE_FIXED:
+      rv=a;
+      break;
+    case SIZE_UNIFORM:
+      rv=a+(b-a+1)*rng_unit();
+      break;
+    case SIZE_LOGNORMAL:
+      rv=exp(a+b*rng_normal());
+      break;
+  }
+  if(rv<GEN_MIN_SIZE)  rv=GEN_MIN_SIZE;
+  if(rv>UINT32_MAX-1024)  rv=UINT32_MAX-1024;
+  return rv;
+}
+
+static int gen_file(const char* name,uint64_t id,size_t size,uint64_t* buf)
+{
+  FILE* f=fopen(name,"wb");
+  if(!f)  return -1;
+  size_t words=(size+sizeof(uint64_t)-1)/sizeof(uint64_t);
+  buf[0]=id;
+  for(size_t i=1;i<words;i++)
+    buf[i]=rng();
+  int rv=fwrite(buf,1,size,f)!=size;
+  return fclose(f) || rv;
+}
+
+int main(int ac,char** av)
+{
+  const char* folder=0;
+  uint64_t names=1000;
+  const char* sizes="lognormal:8:1";
+  double dup=0.1;
+  uint32_t props=2;
+
+  int c;
+  opterr=0;
+  while((c=getopt(ac,av,"ho:n:s:u:p:r:"))!=-1)
+    switch(c)
+    {
+      case 'o': folder=optarg; continue;
+      case 'n': names=strtod(optarg,0); continue;
+      case 's': sizes=optarg; continue;
+      case 'u': dup=strtod(optarg,0); continue;
+      case 'p': props=atol(optarg); continue;
+      case 'r': rng_state=strtoull(optarg,0,10); continue;
+      case 'h':
+      default:
+        fputs(usage,stderr);
+        return c!='h';
+    }
+
+  if(!folder || !names || dup<0 || dup>=1)
+  {
+    fputs(usage,stderr);
+    return 1;
+  }
+
+  size_dist_t dist;
+  double a=0,b=0;
+  if(sscanf(sizes,"fixed:%lf",&a)==1)
+    dist=SIZE_FIXED;
+  else if(sscanf(sizes,"uniform:%lf:%lf",&a,&b)==2)
+    dist=SIZE_UNIFORM;
+  else if(sscanf(sizes,"lognormal:%lf:%lf",&a,&b)==2)
+    dist=SIZE_LOGNORMAL;
+  else
+  {
+    log("invalid size distribution <%s>",sizes);
+    return 1;
+  }
+
+  char* bf=0;
+  asprintf(&bf,"%s/content/",folder);
+  if(utils_mkpath(bf,0777))
+  {
+    log("can not create <%s>: %s",bf,strerror(errno));
+    return 1;
+  }
+  free(bf);
+  for(size_t i=0;i<GEN_FANOUT && i<names;i++)
+  {
+    asprintf(&bf,"%s/content/%03zx",folder,i);
+    mkdir(bf,0777);
+    free(bf);
+  }
+
+  asprintf(&bf,"%s/filelist",folder);
+  FILE* list=fopen(bf,"w");
+  if(!list)
+  {
+    log("can not create <%s>: %s",bf,strerror(errno));
+    return 1;
+  }
+  free(bf);
+
+  size_t bufsz=1<<20;
+  uint64_t* buf=md_malloc(bufsz);
+  uint64_t files=0;
+  uint64_t bytes=0;
+
+  tic;
+  for(uint64_t i=0;i<names;i++)
+  {
+    uint64_t id;
+    if(files && rng_unit()<dup)
+      id=rng()%files;
+    else
+    {
+      id=files++;
+      size_t size=gen_size(dist,a,b);
+      if(size>bufsz)
+      {
+        bufsz=size+sizeof(uint64_t);
+        buf=md_realloc(buf,bufsz);
+      }
+      asprintf(&bf,"%s/content/%03jx/%jx",folder,(uintmax_t)(id%GEN_FANOUT),(uintmax_t)id);
+      if(gen_file(bf,id,size,buf))
+      {
+        log("can not write <%s>: %s",bf,strerror(errno));
+        return 1;
+      }
+      free(bf);
+      bytes+=size;
+    }
+
+    fprintf(list,"set%02jx/%04jx/%jx.dat\t:%s/content/%03jx/%jx",(uintmax_t)(i%97),(uintmax_t)(i%8191),(uintmax_t)i,
+            folder,(uintmax_t)(id%GEN_FANOUT),(uintmax_t)id);
+    for(uint32_t k=0;k<props;k++)
+      fprintf(list,"\tp%u:%ju",k,(uintmax_t)(rng()%(1ULL<<(4*(k%15)+4))));
+    fprintf(list,"\n");
+  }
+
+  free(buf);
+  if(fclose(list))
+  {
+    log("can not write filelist: %s",strerror(errno));
+    return 1;
+  }
+
+  log("generated %ju names, %ju files, %ju bytes, time taken %s",(uintmax_t)names,(uintmax_t)files,(uintmax_t)bytes,toc);
+  return 0;
+}
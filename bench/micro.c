@@ -0,0 +1,764 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#include "common.h"
+#include "utils.h"
+#include "dict.h"
+#include "hfile.h"
+#include "hfile_int.h"
+#include "bitmap.h"
+#include "column.h"
+#include "aio.h"
+#include "bpool.h"
+#include "hotkey.h"
+
+//! \file
+//! \brief library micro-benchmarks, results are printed as JSON
+
+//! version of result format, increment on incompatible change
+#define BENCH_FORMAT		1
+//! maximal count of sampled names
+#define BENCH_SAMPLE		(1<<20)
+//! maximal count of -O options
+#define BENCH_MAX_OPTS		64
+
+static const char* usage="library micro-benchmarks\n"
+"usage:\n"
+"micro -s filelist [-d database] [-n lookups] [-o result.json] [-k] [-m] [-O build_option=value]...\n"
+"\t-s filelist\tsource filelist, see gen\n"
+"\t-d bench.db\tdatabase to build and test\n"
+"\t-n 1000000\tcount of lookups in latency tests\n"
+"\t-o -\tresult file\n"
+"\t-k\tkeep existing database, skip build test\n"
+"\t-m\tcompare minimal perfect hash algorithms on names: build time, bits per key, lookup latency, plain and front coded names pool\n"
+"\t-O option=value\tbuild options, see hugefile -h\n"
+"\n";
+
+//! one result record
+typedef struct bench_result_t
+{
+  const char* name;
+  uint64_t ops;				//!< items or lookups
+  uint64_t bytes;			//!< bytes processed, 0 if not applicable
+  uint64_t mem;				//!< resident memory of structure under test, 0 if not applicable
+  uint64_t ns;				//!< wall time
+  uint64_t cpu_ns;			//!< process cpu time
+  uint64_t p50,p99,max;			//!< latency percentiles in ns, 0 if not measured
+  double bits_per_key;			//!< size of hash function per key, 0 if not applicable
+} bench_result_t;
+
+#define BENCH_MAX_RESULTS	32
+
+static bench_result_t results[BENCH_MAX_RESULTS];
+static size_t results_cnt=0;
+
+static uint64_t bench_ns(void)
+{
+  struct timespec tm;
+  clock_gettime(CLOCK_MONOTONIC,&tm);
+  return tm.tv_sec*1000000000ULL+tm.tv_nsec;
+}
+
+static uint64_t bench_cpu_ns(void)
+{
+  struct timespec tm;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID,&tm);
+  return tm.tv_sec*1000000000ULL+tm.tv_nsec;
+}
+
+static bench_result_t* bench_add(const char* name)
+{
+  if(results_cnt>=BENCH_MAX_RESULTS)  crash("too many results");
+  bench_result_t* r=results+results_cnt++;
+  memset(r,0,sizeof(*r));
+  r->name=name;
+  return r;
+}
+
+static int bench_cmp32(const void* a,const void* b)
+{
+  uint32_t x=*(const uint32_t*)a;
+  uint32_t y=*(const uint32_t*)b;
+  return x<y ? -1 : x>y;
+}
+
+//! fill percentiles from per operation latencies
+static void bench_latency(bench_result_t* r,uint32_t* lat,size_t cnt)
+{
+  if(!cnt)  return;
+  qsort(lat,cnt,sizeof(lat[0]),bench_cmp32);
+  r->p50=lat[cnt/2];
+  r->p99=lat[(cnt*99)/100];
+  r->max=lat[cnt-1];
+}
+
+static uint64_t rng_state=1;
+
+static uint64_t rng(void)
+{
+  uint64_t z=(rng_state+=0x9e3779b97f4a7c15ULL);
+  z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+  z=(z^(z>>27))*0x94d049bb133111ebULL;
+  return z^(z>>31);
+}
+
+//! reservoir sample of names from filelist
+static char** bench_sample(const char* filelist,size_t* cnt,uint64_t* total)
+{
+  FILE* f=fopen(filelist,"r");
+  if(!f)  return 0;
+
+  char** rv=md_pcalloc(BENCH_SAMPLE);
+  size_t z=0;
+  char* bf=0;
+  uint64_t seen=0;
+
+  while(getline(&bf,&z,f)>=0)
+  {
+    if(!*bf || strchr(" \t\n\r\f",*bf))  continue;
+    char* p=bf;
+    char* name=strsep(&p,"\t\n\r\f");
+    uint64_t slot=seen<BENCH_SAMPLE ? seen : rng()%(seen+1);
+    seen++;
+    if(slot>=BENCH_SAMPLE)  continue;
+    free(rv[slot]);
+    rv[slot]=md_strdup(name);
+  }
+
+  free(bf);
+  fclose(f);
+  *total=seen;
+  *cnt=seen<BENCH_SAMPLE ? seen : BENCH_SAMPLE;
+  return rv;
+}
+
+static uint64_t bench_du(const char* database)
+{
+  static const char* files[]={"names.hash","meta.hash","data.idx","names.content","data.content"};
+  uint64_t rv=0;
+  for(size_t i=0;i<sizeof(files)/sizeof(*files);i++)
+  {
+    char* bf=0;
+    struct stat st;
+    asprintf(&bf,"%s/%s",database,files[i]);
+    if(!stat(bf,&st))  rv+=st.st_size;
+    free(bf);
+  }
+  return rv;
+}
+
+static void bench_build(const char* database,const char* filelist,const hfile_build_opt_t* opt,uint64_t names)
+{
+  bench_result_t* r=bench_add("build");
+  uint64_t cpu=bench_cpu_ns();
+  uint64_t t=bench_ns();
+  if(hfile_build_ex(database,filelist,opt))
+    crash("build failed");
+  r->ns=bench_ns()-t;
+  r->cpu_ns=bench_cpu_ns()-cpu;
+  r->ops=names;
+  r->bytes=bench_du(database);
+}
+
+static hfile_t* bench_open(const char* database)
+{
+  bench_result_t* r=bench_add("open");
+  uint64_t cpu=bench_cpu_ns();
+  uint64_t t=bench_ns();
+  hfile_t* hf=hfile_open(database);
+  r->ns=bench_ns()-t;
+  r->cpu_ns=bench_cpu_ns()-cpu;
+  r->ops=1;
+  r->bytes=bench_du(database);
+  return hf;
+}
+
+//! lookups of names from sample, miss names are made unique by prefix. hot uses hfile_get_hot
+static void bench_get(const char* name,const hfile_t* hf,char** sample,size_t cnt,size_t lookups,int miss,int hot)
+{
+  bench_result_t* r=bench_add(name);
+  uint32_t* lat=md_tmalloc(uint32_t,lookups);
+  size_t found=0;
+  uint64_t bytes=0;
+  char key[4096];
+
+  uint64_t cpu=bench_cpu_ns();
+  uint64_t total=bench_ns();
+  for(size_t i=0;i<lookups;i++)
+  {
+    const char* k=sample[rng()%cnt];
+    if(miss)
+    {
+      snprintf(key,sizeof(key),"miss/%jx/%s",(uintmax_t)rng(),k);
+      k=key;
+    }
+    uint64_t t=bench_ns();
+    hfile_hot_ret_t hr;
+    hfile_ret_t* ret=0;
+    if(hot && !hfile_get_hot(hf,k,&hr))
+    {
+      found++;
+      bytes+=hr.size;
+    }
+    else if(!hot && (ret=hfile_get(hf,k)))
+    {
+      found++;
+      bytes+=ret->size;
+      hfile_ret_free(ret);
+    }
+    t=bench_ns()-t;
+    lat[i]=t>UINT32_MAX ? UINT32_MAX : t;
+  }
+  r->ns=bench_ns()-total;
+  r->cpu_ns=bench_cpu_ns()-cpu;
+  r->ops=lookups;
+  r->bytes=bytes;
+  bench_latency(r,lat,lookups);
+  free(lat);
+
+  if(found!=(miss ? 0 : lookups))
+    log("%s: %zu of %zu lookups found",name,found,lookups);
+}
+
+//! lookups through buffer pool of eighth of content, the rest is read again on miss
+static void bench_pool_get(const char* database,char** sample,size_t cnt,size_t lookups)
+{
+  hfile_open_opt_t opt={0,};
+  struct stat st;
+  char* path=0;
+  asprintf(&path,"%s/data.content",database);
+  opt.pool=stat(path,&st) ? 0 : st.st_size/8;
+  free(path);
+  hfile_t* hf=opt.pool ? hfile_open_ex(database,&opt) : 0;
+  if(!hf)  return;
+
+  bench_get("get_pool_hit",hf,sample,cnt,lookups,0,0);
+  bpool_stat_t ps;
+  hfile_pool_stat(hf,&ps);
+  results[results_cnt-1].mem=ps.budget;
+  log("pool: %ju hits, %ju misses, %ju evictions",(uintmax_t)ps.hits,(uintmax_t)ps.misses,(uintmax_t)ps.evictions);
+  hfile_free(hf);
+}
+
+//! lookups counted by attached hot names tracker, compare with get_hit for its cost
+static void bench_hotkey(hfile_t* hf,char** sample,size_t cnt,size_t lookups)
+{
+  hotkey_t* k=hotkey_init(hf,0,0);
+  if(hotkey_attach(hf,k))
+  {
+    hotkey_free(k);
+    return;
+  }
+  bench_get("get_hotkey",hf,sample,cnt,lookups,0,0);
+  hotkey_item_t top;
+  if(hotkey_top(k,&top,1))
+    log("hotkey: hottest %s, %ju lookups",hfile_name_by_idx(hf,top.idx),(uintmax_t)top.count);
+  hotkey_free(hotkey_detach(hf));
+}
+
+//! drop content pages from mapping and page cache
+static void bench_evict(const hfile_t* hf)
+{
+  madvise(hf->content.base,hf->content.mmapsize,MADV_DONTNEED);
+  posix_fadvise(hf->content.fd,0,0,POSIX_FADV_DONTNEED);
+}
+
+//! lookups of evicted content one by one by hfile_get or pipelined by aio
+static void bench_cold(const char* name,const hfile_t* hf,char** sample,size_t cnt,size_t lookups,int async)
+{
+  aio_t* a=async ? aio_init(hf,0,0) : 0;
+  if(async && !aio_async(a))
+  {
+    aio_free(a);
+    return;
+  }
+
+  bench_result_t* r=bench_add(name);
+  uint64_t size=1;
+  for(size_t i=0;i<cnt;i++)
+  {
+    hfile_hot_ret_t hr;
+    if(!hfile_get_hot(hf,sample[i],&hr) && hr.size>size)  size=hr.size;
+  }
+  uint8_t* buf=md_tmalloc(uint8_t,size*AIO_DEPTH);
+  uint32_t busy[AIO_DEPTH];
+  uint32_t spare=AIO_DEPTH;
+  for(uint32_t i=0;i<AIO_DEPTH;i++)
+    busy[i]=i;
+  aio_done_t done[AIO_DEPTH];
+  size_t found=0;
+  uint64_t bytes=0;
+
+  bench_evict(hf);
+  uint64_t cpu=bench_cpu_ns();
+  uint64_t t=bench_ns();
+  for(size_t i=0;i<lookups || (a && aio_pending(a));)
+  {
+    const char* k=sample[rng()%cnt];
+    if(!a)
+    {
+      hfile_ret_t* ret=hfile_get(hf,k);
+      if(ret)
+      {
+        found++;
+        bytes+=ret->size;
+        hfile_ret_free(ret);
+      }
+      i++;
+      continue;
+    }
+// buffers of requests in flight are taken from stack, user tag is buffer number
+    if(i<lookups && spare && !aio_submit(a,k,buf+busy[spare-1]*size,size,busy[spare-1]))
+    {
+      spare--;
+      i++;
+      continue;
+    }
+    ssize_t n=aio_reap(a,done,AIO_DEPTH,1);
+    for(ssize_t j=0;j<n;j++)
+    {
+      busy[spare++]=done[j].user;
+      if(done[j].err)  continue;
+      found++;
+      bytes+=done[j].size;
+    }
+  }
+  r->ns=bench_ns()-t;
+  r->cpu_ns=bench_cpu_ns()-cpu;
+  r->ops=lookups;
+  r->bytes=bytes;
+  free(buf);
+  aio_free(a);
+
+  if(found!=lookups)
+    log("%s: %zu of %zu lookups found",name,found,lookups);
+}
+
+//! names hash alone
+static void bench_dict(const char* name,const char* database,char** sample,size_t cnt,size_t lookups,int miss)
+{
+  char* bf=0;
+  asprintf(&bf,"%s/names.hash",database);
+  dict_t* d=dict_load(bf);
+  free(bf);
+  if(!d)  crash("can not load names hash");
+
+  char** keys=sample;
+  if(miss)
+  {
+    keys=md_pcalloc(cnt);
+    for(size_t i=0;i<cnt;i++)
+      asprintf(keys+i,"miss/%jx/%s",(uintmax_t)rng(),sample[i]);
+  }
+
+  bench_result_t* r=bench_add(name);
+  uint32_t* lat=md_tmalloc(uint32_t,lookups);
+  size_t found=0;
+
+  uint64_t cpu=bench_cpu_ns();
+  uint64_t total=bench_ns();
+  for(size_t i=0;i<lookups;i++)
+  {
+    const char* k=keys[rng()%cnt];
+    uint64_t t=bench_ns();
+    found+=dict_get_str(d,k)!=DICT_NOT_FOUND;
+    t=bench_ns()-t;
+    lat[i]=t>UINT32_MAX ? UINT32_MAX : t;
+  }
+  r->ns=bench_ns()-total;
+  r->cpu_ns=bench_cpu_ns()-cpu;
+  r->ops=lookups;
+  r->mem=dict_get_bytes(d);
+  bench_latency(r,lat,lookups);
+
+  if(miss)
+  {
+    for(size_t i=0;i<cnt;i++)
+      free(keys[i]);
+    free(keys);
+  }
+  free(lat);
+  dict_free(d);
+}
+
+//! build names hash with every algorithm and look sample up
+static void bench_mph(const char* filelist,char** sample,size_t cnt,size_t lookups)
+{
+  static char names[DICT_ALGO_COUNT][2][32];
+
+  for(uint32_t a=0;a<DICT_ALGO_COUNT;a++)
+  {
+    snprintf(names[a][0],sizeof(names[a][0]),"mph_%s_build",dict_algo_name(a));
+    snprintf(names[a][1],sizeof(names[a][1]),"mph_%s_hit",dict_algo_name(a));
+
+    bench_result_t* r=bench_add(names[a][0]);
+    uint64_t cpu=bench_cpu_ns();
+    uint64_t t=bench_ns();
+    dict_opt_t dopt={a,};
+    dict_t* d=dict_init_tsv_ex(0,filelist,&dopt);
+    r->ns=bench_ns()-t;
+    r->cpu_ns=bench_cpu_ns()-cpu;
+    if(!d)
+    {
+      log("%s: build failed",names[a][0]);
+      continue;
+    }
+    r->ops=dict_get_size(d);
+    r->mem=dict_get_hash_bytes(d);
+    r->bits_per_key=r->ops ? 8.0*r->mem/r->ops : 0;
+
+    r=bench_add(names[a][1]);
+    uint32_t* lat=md_tmalloc(uint32_t,lookups);
+    size_t found=0;
+
+    cpu=bench_cpu_ns();
+    uint64_t total=bench_ns();
+    for(size_t i=0;i<lookups;i++)
+    {
+      const char* k=sample[rng()%cnt];
+      t=bench_ns();
+      found+=dict_get_str(d,k)!=DICT_NOT_FOUND;
+      t=bench_ns()-t;
+      lat[i]=t>UINT32_MAX ? UINT32_MAX : t;
+    }
+    r->ns=bench_ns()-total;
+    r->cpu_ns=bench_cpu_ns()-cpu;
+    r->ops=lookups;
+    r->mem=dict_get_hash_bytes(d);
+    r->bits_per_key=results[results_cnt-2].bits_per_key;
+    bench_latency(r,lat,lookups);
+    free(lat);
+    dict_free(d);
+
+    if(found!=lookups)
+      log("%s: %zu of %zu lookups found",names[a][1],found,lookups);
+  }
+}
+
+//! plain and front coded names pool: memory, lookup and decoding cost
+static void bench_pool(const char* filelist,char** sample,size_t cnt,size_t lookups)
+{
+  static const char* names[2][2]={{"pool_plain_hit","pool_plain_byidx"},{"pool_front_hit","pool_front_byidx"}};
+
+  for(int front=0;front<2;front++)
+  {
+    dict_opt_t dopt={DICT_ALGO_PTHASH,front ? DICT_FLAG_FRONT : 0,};
+    dict_t* d=dict_init_tsv_ex(0,filelist,&dopt);
+    if(!d)
+    {
+      log("%s: build failed",names[front][0]);
+      continue;
+    }
+    size_t n=dict_get_size(d);
+
+    for(int byidx=0;byidx<2;byidx++)
+    {
+      bench_result_t* r=bench_add(names[front][byidx]);
+      uint32_t* lat=md_tmalloc(uint32_t,lookups);
+      size_t found=0;
+
+      uint64_t cpu=bench_cpu_ns();
+      uint64_t total=bench_ns();
+      for(size_t i=0;i<lookups;i++)
+      {
+        uint64_t t=bench_ns();
+        if(byidx)
+          found+=!!*dict_get_byidx(d,rng()%n);
+        else
+          found+=dict_get_str(d,sample[rng()%cnt])!=DICT_NOT_FOUND;
+        t=bench_ns()-t;
+        lat[i]=t>UINT32_MAX ? UINT32_MAX : t;
+      }
+      r->ns=bench_ns()-total;
+      r->cpu_ns=bench_cpu_ns()-cpu;
+      r->ops=lookups;
+      r->mem=dict_get_bytes(d);
+      r->bits_per_key=n ? 8.0*r->mem/n : 0;
+      bench_latency(r,lat,lookups);
+      free(lat);
+
+      if(found!=lookups)
+        log("%s: %zu of %zu lookups found",names[front][byidx],found,lookups);
+    }
+    dict_free(d);
+  }
+}
+
+//! random index access, flat array and packed index if database has one. total time only, access is shorter than timer call
+static void bench_idx(const hfile_t* hf,size_t lookups)
+{
+  size_t n=hf->idx.header.chunks;
+  if(!n)  return;
+
+  for(int packed=0;packed<=!!hf->pidx.data;packed++)
+  {
+    bench_result_t* r=bench_add(packed ? "idx_packed" : "idx_flat");
+    uint64_t sum=0;
+    uint64_t cpu=bench_cpu_ns();
+    uint64_t t=bench_ns();
+    for(size_t i=0;i<lookups;i++)
+    {
+      size_t k=rng()%n;
+      if(packed)
+        sum+=hfile_idx_content(hf,k)+hfile_idx_name(hf,k);
+      else
+        sum+=hf->idx.data[k].content_offset+hf->idx.data[k].name_offset;
+    }
+    r->ns=bench_ns()-t;
+    r->cpu_ns=bench_cpu_ns()-cpu;
+    r->ops=lookups;
+    r->mem=packed ? hf->pidx.mmapsize : hf->idx.mmapsize;
+    r->bits_per_key=8.0*r->mem/n;
+    if(!sum)  log("idx: all zeroes");
+  }
+}
+
+//! iterate over all items reading whole content
+static void bench_scan(const hfile_t* hf)
+{
+  bench_result_t* r=bench_add("scan");
+  hfile_it_t* it=hfile_it_init(hf);
+  uint64_t sum=0;
+
+  uint64_t cpu=bench_cpu_ns();
+  uint64_t t=bench_ns();
+  for(hfile_ret_t* ret;(ret=hfile_it_get(it));hfile_ret_free(ret))
+  {
+    const uint8_t* p=ret->content;
+    for(size_t i=0;i<ret->size;i+=sizeof(uint64_t))
+      sum+=p[i];
+    r->ops++;
+    r->bytes+=ret->size;
+  }
+  r->ns=bench_ns()-t;
+  r->cpu_ns=bench_cpu_ns()-cpu;
+  hfile_it_free(it);
+
+  if(!sum && r->bytes)  log("scan: all zeroes");
+}
+
+//! predicate "property >= value of first item" on first numeric column: strtod over item records, scalar and SIMD column kernels
+static void bench_filter(const hfile_t* hf)
+{
+  size_t n=hf->cols.header.chunks;
+  if(!hf->cols.count || !n)  return;
+
+  const hfile_column_t* c=hf->cols.dir;
+  const void* data=hf->cols.base+c->offset;
+  double lo=c->type==COLUMN_I64 ? (double)((const int64_t*)data)[0] : ((const double*)data)[0];
+  column_range_t range;
+  char val[64];
+  snprintf(val,sizeof(val),"%.17g",lo);
+  if(column_range(c->type,COLUMN_GE,val,&range))  return;
+
+  bitmap_t* b=bitmap_init(n);
+  size_t count[3]={0,};
+  for(int k=0;k<3;k++)
+  {
+    static const char* names[3]={"filter_strtod","filter_scalar","filter_simd"};
+    bench_result_t* r=bench_add(names[k]);
+    memset(b->data,0,bitmap_words(n)*sizeof(uint64_t));
+    uint64_t cpu=bench_cpu_ns();
+    uint64_t t=bench_ns();
+    if(k==0)
+      for(size_t i=0;i<n;i++)
+      {
+        uint64_t off=hfile_idx_name(hf,i);
+        if(off==(uint64_t)-1LL)  continue;
+        const hfile_item_t* item=hf->names.base+off;
+        const void* p=item+1;
+        hfile_prop_t prop;
+        for(size_t m=0;m<item->meta_cnt;m++)
+        {
+          p=hfile_prop_next(hf,p,&prop);
+          if(prop.idx==c->meta && strtod(prop.val,0)>=lo)
+            bitmap_set(b,i);
+        }
+      }
+    else if(k==1)
+      column_eval_scalar(c->type,data,n,&range,b->data,0);
+    else
+      column_eval(c->type,data,n,&range,b->data,0);
+    r->ns=bench_ns()-t;
+    r->cpu_ns=bench_cpu_ns()-cpu;
+    r->ops=n;
+    r->bytes=k ? n*sizeof(uint64_t) : 0;
+    count[k]=bitmap_count(b);
+  }
+  if(count[0]!=count[1] || count[1]!=count[2])
+    log("filter: results differ, %zu %zu %zu",count[0],count[1],count[2]);
+  bitmap_free(b);
+}
+
+//! glob over all names: fnmatch per name as extract did, and compiled literal scan of names pool
+static void bench_glob(const hfile_t* hf)
+{
+  static const char* glob="set1?/*/*7f.dat";
+  size_t n=hf->idx.header.chunks;
+  bitmap_t* b=bitmap_init(n);
+  size_t count[2]={0,};
+  for(int k=0;k<2;k++)
+  {
+    bench_result_t* r=bench_add(k ? "glob_scan" : "glob_fnmatch");
+    memset(b->data,0,bitmap_words(n)*sizeof(uint64_t));
+    uint64_t cpu=bench_cpu_ns();
+    uint64_t t=bench_ns();
+    if(k)
+      hfile_glob(hf,glob,b);
+    else
+      for(size_t i=0;i<n;i++)
+      {
+        const char* name=hfile_name_by_idx(hf,i);
+        if(name && !fnmatch(glob,name,FNM_EXTMATCH))  bitmap_set(b,i);
+      }
+    r->ns=bench_ns()-t;
+    r->cpu_ns=bench_cpu_ns()-cpu;
+    r->ops=n;
+    count[k]=bitmap_count(b);
+  }
+  if(count[0]!=count[1])
+    log("glob: results differ, %zu %zu",count[0],count[1]);
+  bitmap_free(b);
+}
+
+//! weighted draws from alias table in batches, total time only
+static void bench_draw(const hfile_t* hf,size_t lookups)
+{
+  if(!hfile_sample_total(hf))  return;
+
+  bench_result_t* r=bench_add("sample_alias");
+  hfile_rng_t rng;
+  hfile_rng_seed(&rng,1);
+  uint32_t out[1024];
+  uint64_t sum=0;
+  uint64_t cpu=bench_cpu_ns();
+  uint64_t t=bench_ns();
+  for(size_t i=0;i<lookups;i+=sizeof(out)/sizeof(out[0]))
+  {
+    hfile_sample_batch(hf,&rng,out,sizeof(out)/sizeof(out[0]));
+    sum+=out[0];
+    r->ops+=sizeof(out)/sizeof(out[0]);
+  }
+  r->ns=bench_ns()-t;
+  r->cpu_ns=bench_cpu_ns()-cpu;
+  r->mem=hf->alias.mmapsize;
+  if(!sum)  log("draw: all zeroes");
+}
+
+static void bench_print(FILE* f,const char* filelist,uint64_t names,size_t lookups)
+{
+  fprintf(f,"{\n");
+  fprintf(f,"  \"format\": %d,\n",BENCH_FORMAT);
+  fprintf(f,"  \"hfile_version\": %u,\n",HFILE_VERSION);
+  fprintf(f,"  \"hfile_format\": %u,\n",HFILE_FORMAT_VERSION);
+  fprintf(f,"  \"timestamp\": %ju,\n",(uintmax_t)time(0));
+  fprintf(f,"  \"cpus\": %zu,\n",utils_getCPUs());
+  fprintf(f,"  \"dataset\": { \"filelist\": \"%s\", \"names\": %ju, \"lookups\": %zu },\n",filelist,(uintmax_t)names,lookups);
+  fprintf(f,"  \"results\": [\n");
+  for(size_t i=0;i<results_cnt;i++)
+  {
+    const bench_result_t* r=results+i;
+    double sec=r->ns/1e9;
+    fprintf(f,"    { \"name\": \"%s\", \"ops\": %ju, \"bytes\": %ju, \"wall_ns\": %ju, \"cpu_ns\": %ju, "
+              "\"ops_per_s\": %.1f, \"bytes_per_s\": %.1f, \"ns_per_op\": %.1f, \"p50_ns\": %ju, \"p99_ns\": %ju, \"max_ns\": %ju, \"mem_bytes\": %ju, \"bits_per_key\": %.2f }%s\n",
+            r->name,(uintmax_t)r->ops,(uintmax_t)r->bytes,(uintmax_t)r->ns,(uintmax_t)r->cpu_ns,
+            sec>0 ? r->ops/sec : 0,sec>0 ? r->bytes/sec : 0,r->ops ? (double)r->ns/r->ops : 0,
+            (uintmax_t)r->p50,(uintmax_t)r->p99,(uintmax_t)r->max,(uintmax_t)r->mem,r->bits_per_key,i+1<results_cnt ? "," : "");
+  }
+  fprintf(f,"  ]\n}\n");
+}
+
+int main(int ac,char** av)
+{
+  const char* filelist=0;
+  const char* database="bench.db";
+  const char* output="-";
+  size_t lookups=1000000;
+  int keep=0;
+  int mph=0;
+  hfile_build_opt_t opt;
+  memset(&opt,0,sizeof(opt));
+
+  int c;
+  opterr=0;
+  while((c=getopt(ac,av,"hkms:d:n:o:O:"))!=-1)
+    switch(c)
+    {
+      case 's': filelist=optarg; continue;
+      case 'd': database=optarg; continue;
+      case 'n': lookups=strtod(optarg,0); continue;
+      case 'o': output=optarg; continue;
+      case 'k': keep=1; continue;
+      case 'm': mph=1; continue;
+      case 'O':
+        if(hfile_build_opt_set(&opt,optarg))  return 1;
+        continue;
+      case 'h':
+      default:
+        fputs(usage,stderr);
+        return c!='h';
+    }
+
+  if(!filelist || !lookups)
+  {
+    fputs(usage,stderr);
+    return 1;
+  }
+
+  size_t cnt=0;
+  uint64_t names=0;
+  char** sample=bench_sample(filelist,&cnt,&names);
+  if(!sample || !cnt)
+  {
+    log("can not read names from <%s>",filelist);
+    return 1;
+  }
+
+  if(!keep)
+    bench_build(database,filelist,&opt,names);
+
+  hfile_t* hf=bench_open(database);
+  if(!hf)  crash("can not open database");
+
+  bench_get("get_hit",hf,sample,cnt,lookups,0,0);
+  bench_get("get_miss",hf,sample,cnt,lookups,1,0);
+  bench_get("get_hot_hit",hf,sample,cnt,lookups,0,1);
+  bench_hotkey(hf,sample,cnt,lookups);
+  bench_cold("get_cold",hf,sample,cnt,lookups,0);
+  bench_cold("aio_cold",hf,sample,cnt,lookups,1);
+  bench_scan(hf);
+  bench_idx(hf,lookups);
+  bench_filter(hf);
+  bench_glob(hf);
+  bench_draw(hf,lookups);
+  hfile_free(hf);
+
+  bench_pool_get(database,sample,cnt,lookups);
+  bench_dict("dict_hit",database,sample,cnt,lookups,0);
+  bench_dict("dict_miss",database,sample,cnt,lookups,1);
+
+  if(mph)
+  {
+    bench_mph(filelist,sample,cnt,lookups);
+    bench_pool(filelist,sample,cnt,lookups);
+  }
+
+  FILE* f=strcmp(output,"-") ? fopen(output,"w") : stdout;
+  if(!f)  crash("can not create result file");
+  bench_print(f,filelist,names,lookups);
+  if(f!=stdout)  fclose(f);
+
+  for(size_t i=0;i<cnt;i++)
+    free(sample[i]);
+  free(sample);
+  return 0;
+}
@@ -15,6 +15,10 @@
 #include "utils.h"
 #include "dict.h"
 #include "hfile.h"
+#include "reload.h"
+#include "bitmap.h"
+#include "prewarm.h"
+#include "hotkey.h"
 
 #define HEADER_PREFIX		"http_"
 
@@ -28,6 +32,7 @@ static time_t started=0;
 
 static int answer(void *cls, struct MHD_Connection *connection, const char *url, const char *method, const char *version, const char *upload_data,
                   size_t *upload_data_size, void **con_cls);
+static void completed(void *cls, struct MHD_Connection *connection, void **con_cls, enum MHD_RequestTerminationCode toe);
 
 
 static const char* usage="Usage:"
@@ -40,11 +45,81 @@ static const char* usage="Usage:"
 "\t-d <datafile>\tdatafile to server, mandatory parameter, there is no default value\n"
 "\t-l <logfile>\tfile to log errors, stderr default\n"
 "\t-x <prefix>\tprefix to place before url, i.e. GET /tiles/12/234/546.png with prefix /tiles/ will search 12/234/546.png in database\n"
+"\t-w\tprewarm index and names on start and on every reload\n"
+"\t-r <accessmap>\trecord accessed items to file and read them into page cache on start, see hugefile -w\n"
+"\t-k <hotlist>\tcount requests and save hottest names as TSV on exit (or SIGUSR2), input of hugefile -O hot=\n"
+"Signals:\n"
+"\tSIGHUP\treload database from the same path without dropping connections\n"
+"\tSIGUSR1\tprint statistic\n"
+"\tSIGUSR2\tsave access map and hot list, counts of hot list halve after it\n"
 "\t-h\tthis help\n\n"
 ;
 
 static char* prefix=0;
-static hfile_t* hf=0;
+static reload_t* db=0;
+static char* access_map=0;
+static prewarm_t* recording=0;
+static char* hot_list=0;
+static hotkey_t* tracking=0;
+static const hfile_t* tracked=0;
+
+//! save list of database in service and count requests to new one
+static void hot_open(hfile_t* hf)
+{
+  if(!hot_list)  return;
+  if(tracking)  hotkey_save(tracking,tracked,hot_list);
+
+  hotkey_t* k=hotkey_init(hf,0,0);
+  if(hotkey_attach(hf,k))
+  {
+    hotkey_free(k);
+    return;
+  }
+  tracking=k;
+  tracked=hf;
+}
+
+static void hot_close(hfile_t* hf)
+{
+  hotkey_t* k=hotkey_detach(hf);
+  if(k && k==tracking)
+  {
+    hotkey_save(k,hf,hot_list);
+    tracking=0;
+    tracked=0;
+  }
+  hotkey_free(k);
+}
+
+//! replay access map of previous run and continue recording
+static void db_open(hfile_t* hf,void* arg)
+{
+  hot_open(hf);
+  if(!access_map)  return;
+  if(recording)  prewarm_save(recording,access_map);
+
+  prewarm_t* p=prewarm_load(access_map);
+  if(p && prewarm_replay(hf,p))
+  {
+    prewarm_free(p);
+    p=0;
+  }
+  if(!p)  p=prewarm_init(hf);
+  prewarm_attach(hf,p);
+  recording=p;
+}
+
+static void db_close(hfile_t* hf,void* arg)
+{
+  hot_close(hf);
+  prewarm_t* p=prewarm_detach(hf);
+  if(p && p==recording)
+  {
+    prewarm_save(p,access_map);
+    recording=0;
+  }
+  prewarm_free(p);
+}
 
 int main(int ac,char** av)
 {
@@ -57,6 +132,7 @@ int main(int ac,char** av)
   int c;
 
   int bg=0;
+  uint32_t prewarm=0;
   int bind_port= -1;
   int pool= -1;
   char* database=0;
@@ -64,7 +140,7 @@ int main(int ac,char** av)
 
   opterr=0;
 
-  while((c=getopt(ac,av,"hzb:p:d:l:x:t:"))!=-1)
+  while((c=getopt(ac,av,"hzwb:p:d:l:x:t:r:k:"))!=-1)
     switch(c)
     {
       case 'h':
@@ -75,6 +151,10 @@ int main(int ac,char** av)
         bg=1;
         continue;
 
+      case 'w':
+        prewarm=HFILE_PREWARM_IDX | HFILE_PREWARM_NAMES;
+        continue;
+
       case 'd':
         database=optarg;
         continue;
@@ -91,6 +171,12 @@ int main(int ac,char** av)
       case 'x':
         prefix=optarg;
         continue;
+      case 'r':
+        access_map=optarg;
+        continue;
+      case 'k':
+        hot_list=optarg;
+        continue;
 
       default:
         fprintf(stderr,"unknoun option -%c\n",c);
@@ -128,8 +214,9 @@ int main(int ac,char** av)
 
   setlinebuf(stderr);
 
-  hf=hfile_open(database);
-  if(!hf)
+  reload_hook_t hook={db_open,db_close,0};
+  db=reload_init_hook(database,prewarm,&hook);
+  if(!db)
   {
     fprintf(stderr,"no database '%s', %s:%u\n",database,__func__,__LINE__);
     abort();
@@ -142,6 +229,8 @@ int main(int ac,char** av)
   sigaddset(&mask, SIGTERM);
   sigaddset(&mask, SIGINT);
   sigaddset(&mask, SIGUSR1);
+  sigaddset(&mask, SIGHUP);
+  sigaddset(&mask, SIGUSR2);
   sigprocmask(SIG_BLOCK,&mask,0);
   int sfd=signalfd(-1,&mask,0);
 
@@ -150,6 +239,7 @@ int main(int ac,char** av)
   struct MHD_Daemon *proc=MHD_start_daemon(MHD_USE_SELECT_INTERNALLY|MHD_USE_EPOLL,bind_port,0,0,&answer,0,
     MHD_OPTION_LISTENING_ADDRESS_REUSE,1,
     MHD_OPTION_THREAD_POOL_SIZE,pool,
+    MHD_OPTION_NOTIFY_COMPLETED,&completed,0,
   MHD_OPTION_END);
 
   if(!proc)  return 1;
@@ -161,6 +251,21 @@ int main(int ac,char** av)
     if(si.ssi_signo==SIGTERM || si.ssi_signo==SIGINT)
       break;
 
+    if(si.ssi_signo==SIGHUP)
+    {
+      if(reload_swap(db,0))
+        fprintf(stderr,"reload of '%s' failed, old database stays in service\n",database);
+      continue;
+    }
+
+    if(si.ssi_signo==SIGUSR2)
+    {
+      if(recording)  prewarm_save(recording,access_map);
+      if(tracking && !hotkey_save(tracking,tracked,hot_list))
+        hotkey_decay(tracking,1);
+      continue;
+    }
+
     if(si.ssi_signo!=SIGUSR1)
       continue;
 
@@ -170,7 +275,7 @@ int main(int ac,char** av)
   }
 
   MHD_stop_daemon(proc);
-  hfile_free(hf);
+  reload_free(db);
   fputs("HTTP server stopped\n",stderr);
   if(log_file) fclose(stderr);
   return 0;
@@ -189,11 +294,31 @@ static int answer404(struct MHD_Connection *connection)
   return ret;
 }
 
+//! release database snapshot after response is sent, content is served straight from mmaped memory
+static void completed(void *cls, struct MHD_Connection *connection, void **con_cls, enum MHD_RequestTerminationCode toe)
+{
+  reload_ref_t* ref=*con_cls;
+  if(!ref)  return;
+  reload_release(db,ref);
+  free(ref);
+  *con_cls=0;
+}
+
 static int answer(void *cls, struct MHD_Connection *connection,
                       const char *url, const char *method,
                       const char *version, const char *upload_data,
                       size_t *upload_data_size, void **con_cls)
 {
+  reload_ref_t* ref=*con_cls;
+  if(!ref)
+  {
+    ref=calloc(1,sizeof(*ref));
+    if(!ref)  abort();
+    reload_acquire(db,ref);
+    *con_cls=ref;
+  }
+  const hfile_t* hf=ref->hf;
+
   served_count++;
   size_t url_len=strlen(url);
   size_t prefix_len=strlen(prefix);
@@ -204,12 +329,23 @@ static int answer(void *cls, struct MHD_Connection *connection,
 
 //  char name[prefix_len+url_len];
 //  snprintf(name,prefix_len+url_len,"%s%s",prefix,url);
-  hfile_ret_t* r=hfile_get(hf,url+prefix_len);
+  hfile_ret_t* r=hfile_get_view(hf,url+prefix_len);
   if(!r) return answer404(connection);;
 
   struct MHD_Response *response=0;
 
-  if(!strcmp(method,"GET"))
+  if(!strcmp(method,"GET") && r->pieces)
+  {
+// chunked content, gather pieces into buffer freed with response
+    void* bf=malloc(r->size ?: 1);
+    if(!bf)  abort();
+    void* dst=bf;
+    for(size_t i=0;i<r->pieces;i++)
+      dst=mempcpy(dst,r->piece[i].base,r->piece[i].len);
+    response=MHD_create_response_from_buffer(r->size,bf,MHD_RESPMEM_MUST_FREE);
+    served_size+=r->size;
+  }
+  else if(!strcmp(method,"GET"))
   {
     response=MHD_create_response_from_buffer(r->size,r->content,MHD_RESPMEM_PERSISTENT);
     served_size+=r->size;
@@ -246,7 +382,7 @@ static int answer(void *cls, struct MHD_Connection *connection,
   }
 
   char etag[2*CHECKSUM_SIZE+1]={0,};
-  utils_str2hex(etag,r->checksum);
+  utils_bin2hex(etag,r->checksum,CHECKSUM_SIZE);
   MHD_add_response_header(response,"ETag",etag);
 
 // expires
@@ -0,0 +1,525 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "common.h"
+#include "checksum.h"
+#include "dict.h"
+#include "utils.h"
+#include "hfile.h"
+#include "hfile_int.h"
+#include "aio.h"
+
+//! registered file slots
+#define AIO_FILE_DIRECT		0
+#define AIO_FILE_BUFFERED	1
+
+//! submitted request
+typedef struct aio_req_t
+{
+  aio_done_t done;			//!< completion to return
+  uint8_t* dest;
+  uint32_t reads;			//!< reads in flight
+  int32_t slot;				//!< bounce buffer, -1 if reads go to destination
+  uint32_t skip;			//!< content offset in bounce buffer
+  uint32_t next;			//!< free list link
+} aio_req_t;
+
+struct aio_t
+{
+  const hfile_t* hf;
+  uint32_t depth;
+  uint32_t slot;			//!< bounce buffer size
+  size_t page;
+
+  int ring;				//!< io_uring fd, -1 in pread mode
+  int efd;				//!< eventfd, -1 if there is none
+  int dfd;				//!< O_DIRECT fd of data.content, -1 if filesystem does not support it
+  int fixed_files;			//!< fds are registered
+  int fixed_bufs;			//!< bounce buffers are registered
+
+  void* sq_ptr;
+  size_t sq_size;
+  void* cq_ptr;
+  size_t cq_size;
+  struct io_uring_sqe* sqes;
+  size_t sqes_size;
+  uint32_t* sq_head;
+  uint32_t* sq_tail;
+  uint32_t sq_mask;
+  uint32_t sq_entries;
+  uint32_t* sq_array;
+  uint32_t* cq_head;
+  uint32_t* cq_tail;
+  uint32_t cq_mask;
+  struct io_uring_cqe* cqes;
+  uint32_t queued;			//!< sqes not yet submitted to kernel
+  uint32_t inflight;			//!< sqes without completion
+
+  aio_req_t* req;
+  uint32_t free;			//!< head of free requests, depth if none
+  uint32_t used;			//!< submitted and not reaped
+
+  uint8_t* slots;			//!< depth bounce buffers
+  uint32_t* slot_free;			//!< stack of free bounce buffers
+  uint32_t slot_cnt;
+
+  aio_done_t* ready;			//!< ring of completions to reap
+  uint32_t ready_head;
+  uint32_t ready_cnt;
+};
+
+
+static int aio_setup(uint32_t entries,struct io_uring_params* p)
+{
+  return syscall(__NR_io_uring_setup,entries,p);
+}
+
+static int aio_enter(int fd,uint32_t submit,uint32_t wait,uint32_t flags)
+{
+  return syscall(__NR_io_uring_enter,fd,submit,wait,flags,0,0);
+}
+
+static int aio_register(int fd,uint32_t op,const void* arg,uint32_t n)
+{
+  return syscall(__NR_io_uring_register,fd,op,arg,n);
+}
+
+//! map rings, 0 on success
+static int aio_ring_init(aio_t* a,uint32_t entries)
+{
+  struct io_uring_params p;
+  memset(&p,0,sizeof(p));
+  int fd=aio_setup(entries,&p);
+  if(fd<0)  return -1;
+
+  a->sq_size=p.sq_off.array+p.sq_entries*sizeof(uint32_t);
+  a->cq_size=p.cq_off.cqes+p.cq_entries*sizeof(struct io_uring_cqe);
+  int single=!!(p.features & IORING_FEAT_SINGLE_MMAP);
+  if(single)
+    a->sq_size=a->cq_size=a->sq_size>a->cq_size ? a->sq_size : a->cq_size;
+
+  a->sq_ptr=mmap(0,a->sq_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+  if(a->sq_ptr==MAP_FAILED)
+  {
+    close(fd);
+    return -1;
+  }
+  a->cq_ptr=single ? a->sq_ptr : mmap(0,a->cq_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_CQ_RING);
+  a->sqes_size=p.sq_entries*sizeof(struct io_uring_sqe);
+  a->sqes=a->cq_ptr==MAP_FAILED ? MAP_FAILED : mmap(0,a->sqes_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQES);
+  if(a->sqes==MAP_FAILED)
+  {
+    if(a->cq_ptr!=MAP_FAILED && !single)  munmap(a->cq_ptr,a->cq_size);
+    munmap(a->sq_ptr,a->sq_size);
+    close(fd);
+    return -1;
+  }
+
+  a->sq_head=a->sq_ptr+p.sq_off.head;
+  a->sq_tail=a->sq_ptr+p.sq_off.tail;
+  a->sq_mask=*(uint32_t*)(a->sq_ptr+p.sq_off.ring_mask);
+  a->sq_entries=p.sq_entries;
+  a->sq_array=a->sq_ptr+p.sq_off.array;
+  a->cq_head=a->cq_ptr+p.cq_off.head;
+  a->cq_tail=a->cq_ptr+p.cq_off.tail;
+  a->cq_mask=*(uint32_t*)(a->cq_ptr+p.cq_off.ring_mask);
+  a->cqes=a->cq_ptr+p.cq_off.cqes;
+  a->ring=fd;
+  return 0;
+}
+
+static void aio_ring_free(aio_t* a)
+{
+  if(a->ring<0)  return;
+  munmap(a->sqes,a->sqes_size);
+  if(a->cq_ptr!=a->sq_ptr)  munmap(a->cq_ptr,a->cq_size);
+  munmap(a->sq_ptr,a->sq_size);
+  close(a->ring);
+  a->ring=-1;
+}
+
+aio_t* aio_init(const hfile_t* hf,uint32_t depth,uint32_t slot)
+{
+  if(!hf)  return 0;
+  if(!depth)  depth=AIO_DEPTH;
+  if(!slot)  slot=AIO_SLOT;
+  slot=(slot+AIO_ALIGN-1) & ~(AIO_ALIGN-1);
+
+  aio_t* a=md_new(a);
+  a->hf=hf;
+  a->depth=depth;
+  a->slot=slot;
+  a->page=sysconf(_SC_PAGESIZE);
+  a->ring=a->efd=a->dfd=-1;
+
+  a->req=md_tcalloc(aio_req_t,depth);
+  for(uint32_t i=0;i<depth;i++)
+    a->req[i].next=i+1;
+  a->ready=md_tcalloc(aio_done_t,depth);
+
+// pieces of chunked content take a read each, so ring is bigger than depth
+  if(aio_ring_init(a,depth*2))
+  {
+    log("io_uring is not available (%s), reads are synchronous",strerror(errno));
+    return a;
+  }
+
+// O_DIRECT reopen of the same file keeps cold reads from evicting hot pages, tmpfs and some others refuse it
+  char path[64];
+  snprintf(path,sizeof(path),"/proc/self/fd/%d",hf->content.fd);
+  a->dfd=open(path,O_RDONLY|O_DIRECT);
+  if(a->dfd>=0 && posix_memalign((void**)&a->slots,AIO_ALIGN,(size_t)depth*slot))
+    a->slots=0;
+  if(!a->slots && a->dfd>=0)
+  {
+    close(a->dfd);
+    a->dfd=-1;
+  }
+  a->slot_free=md_tcalloc(uint32_t,depth);
+  for(uint32_t i=0;a->slots && i<depth;i++)
+    a->slot_free[a->slot_cnt++]=depth-1-i;
+
+  int fds[2]={a->dfd>=0 ? a->dfd : hf->content.fd,hf->content.fd};
+  a->fixed_files=!aio_register(a->ring,IORING_REGISTER_FILES,fds,2);
+
+  if(a->slots)
+  {
+    struct iovec* iov=md_tcalloc(struct iovec,depth);
+    for(uint32_t i=0;i<depth;i++)
+    {
+      iov[i].iov_base=a->slots+(size_t)i*slot;
+      iov[i].iov_len=slot;
+    }
+    a->fixed_bufs=!aio_register(a->ring,IORING_REGISTER_BUFFERS,iov,depth);
+    free(iov);
+  }
+
+  a->efd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+  if(a->efd>=0 && aio_register(a->ring,IORING_REGISTER_EVENTFD,&a->efd,1))
+  {
+    close(a->efd);
+    a->efd=-1;
+  }
+  return a;
+}
+
+void aio_free(aio_t* a)
+{
+  if(!a)  return;
+  while(a->ring>=0 && a->inflight)
+  {
+    aio_done_t d[16];
+    if(aio_reap(a,d,sizeof(d)/sizeof(d[0]),1)<0)  break;
+  }
+  aio_ring_free(a);
+  if(a->efd>=0)  close(a->efd);
+  if(a->dfd>=0)  close(a->dfd);
+  free(a->slots);
+  free(a->slot_free);
+  free(a->ready);
+  free(a->req);
+  free(a);
+}
+
+int aio_fd(const aio_t* a)
+{
+  return a ? a->efd : -1;
+}
+
+int aio_async(const aio_t* a)
+{
+  return a && a->ring>=0;
+}
+
+size_t aio_pending(const aio_t* a)
+{
+  return a ? a->used : 0;
+}
+
+
+//! all pages of range are in page cache
+static int aio_resident(const aio_t* a,const void* ptr,uint64_t size)
+{
+  uint8_t vec[256];
+  uintptr_t p=(uintptr_t)ptr & ~(a->page-1);
+  uintptr_t e=(uintptr_t)ptr+size;
+  while(p<e)
+  {
+    size_t len=e-p<sizeof(vec)*a->page ? e-p : sizeof(vec)*a->page;
+    if(mincore((void*)p,len,vec))  return 0;
+    for(size_t i=0;i<(len+a->page-1)/a->page;i++)
+      if(!(vec[i] & 1))  return 0;
+    p+=len;
+  }
+  return 1;
+}
+
+static void aio_ready(aio_t* a,const aio_done_t* d)
+{
+  a->ready[(a->ready_head+a->ready_cnt)%a->depth]=*d;
+  a->ready_cnt++;
+}
+
+//! queue read of len bytes at off, tagged by request and length needed for success
+static void aio_prep(aio_t* a,uint8_t op,int file,void* buf,uint32_t len,uint64_t off,int32_t slot,uint32_t r,uint32_t need)
+{
+  uint32_t tail=*a->sq_tail;
+  uint32_t i=tail & a->sq_mask;
+  struct io_uring_sqe* e=a->sqes+i;
+  memset(e,0,sizeof(*e));
+  e->opcode=op;
+  if(a->fixed_files)
+  {
+    e->fd=file;
+    e->flags=IOSQE_FIXED_FILE;
+  }
+  else
+    e->fd=file==AIO_FILE_DIRECT && a->dfd>=0 ? a->dfd : a->hf->content.fd;
+  e->addr=(uintptr_t)buf;
+  e->len=len;
+  e->off=off;
+  if(op==IORING_OP_READ_FIXED)  e->buf_index=slot;
+  e->user_data=(uint64_t)need<<32 | r;
+  a->sq_array[i]=i;
+  __atomic_store_n(a->sq_tail,tail+1,__ATOMIC_RELEASE);
+  a->queued++;
+  a->inflight++;
+}
+
+int aio_submit(aio_t* a,const char* name,void* dest,size_t size,uint64_t user)
+{
+  if(!a || !name || !*name)  return -1;
+  if(a->used>=a->depth)  return -1;
+  uint32_t n=dict_get_str(a->hf->names_dict,name);
+  if(n==DICT_NOT_FOUND)
+  {
+    aio_done_t d={.user=user,.idx=-1,.err=-ENOENT};
+    aio_ready(a,&d);
+    a->used++;
+    return 0;
+  }
+  return aio_submit_idx(a,n,dest,size,user);
+}
+
+int aio_submit_idx(aio_t* a,size_t idx,void* dest,size_t size,uint64_t user)
+{
+  if(!a || a->used>=a->depth)  return -1;
+  const hfile_t* h=a->hf;
+  aio_done_t d={.user=user,.idx=idx};
+
+// payload offset and size from hot record or chunk header
+  uint64_t off=HFILE_NOT_FOUND;
+  int chunked=0;
+  if(idx<h->idx.header.chunks && h->hot.data)
+  {
+    const hfile_hot_t* rec=h->hot.data+idx;
+    off=rec->content;
+    d.size=rec->size;
+    chunked=!!(rec->flags & HFILE_FILE_FLAG_CHUNKED);
+  }
+  else if(idx<h->idx.header.chunks)
+  {
+    off=hfile_idx_content(h,idx);
+    const hfile_chunk_t* chunk=h->content.base+off;
+    if(off!=HFILE_NOT_FOUND && chunk->magic2!=MAGIC2)
+      d.err=-EIO;
+    else if(off!=HFILE_NOT_FOUND)
+    {
+      off+=sizeof(hfile_chunk_t);
+      d.size=hfile_chunk_total(chunk);
+      chunked=!!(chunk->flags & HFILE_CHUNK_LIST);
+    }
+  }
+  if(off==HFILE_NOT_FOUND)
+  {
+    d.idx=-1;
+    d.err=-ENOENT;
+  }
+
+  const uint8_t* base=h->content.base;
+  if(!d.err && !chunked && aio_resident(a,base+off,d.size))
+  {
+    d.data=base+off;
+    d.flags=AIO_CACHED;
+  }
+  else if(!d.err && (!dest || size<d.size))
+    d.err=-ENOBUFS;
+  if(d.err || d.data)
+  {
+    aio_ready(a,&d);
+    a->used++;
+    return 0;
+  }
+
+  const hfile_chunk_t* list=(const hfile_chunk_t*)(base+off)-1;
+  const hfile_piece_t* piece=(const void*)(base+off);
+  size_t pieces=chunked ? list->size/sizeof(hfile_piece_t) : 1;
+
+  if(chunked)
+  {
+    int cached=1;
+    for(size_t i=0;cached && i<pieces;i++)
+      cached=aio_resident(a,base+piece[i].offset+sizeof(hfile_chunk_t),piece[i].size);
+    if(cached)
+    {
+      uint8_t* p=dest;
+      for(size_t i=0;i<pieces;i++)
+        p=mempcpy(p,base+piece[i].offset+sizeof(hfile_chunk_t),piece[i].size);
+      d.data=dest;
+      d.flags=AIO_CACHED;
+      aio_ready(a,&d);
+      a->used++;
+      return 0;
+    }
+  }
+
+// no ring or too many pieces for it, read at once
+  if(a->ring<0 || pieces>a->sq_entries)
+  {
+    uint8_t* p=dest;
+    for(size_t i=0;!d.err && i<pieces;i++)
+    {
+      uint64_t o=chunked ? piece[i].offset+sizeof(hfile_chunk_t) : off;
+      uint64_t l=chunked ? piece[i].size : d.size;
+      if(pread(h->content.fd,p,l,o)!=(ssize_t)l)  d.err=-EIO;
+      p+=l;
+    }
+    d.data=d.err ? 0 : dest;
+    aio_ready(a,&d);
+    a->used++;
+    return 0;
+  }
+
+// ring is full, submit queued ones to free sqes
+  if(a->inflight+pieces>a->sq_entries)
+    return -1;
+  if(a->sq_entries-(*a->sq_tail-__atomic_load_n(a->sq_head,__ATOMIC_ACQUIRE))<pieces)
+  {
+    int r=aio_enter(a->ring,a->queued,0,0);
+    if(r>0)  a->queued-=r;
+    if(a->sq_entries-(*a->sq_tail-__atomic_load_n(a->sq_head,__ATOMIC_ACQUIRE))<pieces)  return -1;
+  }
+
+  uint32_t r=a->free;
+  aio_req_t* q=a->req+r;
+  a->free=q->next;
+  a->used++;
+  q->done=d;
+  q->dest=dest;
+  q->reads=pieces;
+  q->slot=-1;
+
+  if(chunked)
+  {
+    uint8_t* p=dest;
+    for(size_t i=0;i<pieces;i++)
+    {
+      aio_prep(a,IORING_OP_READ,AIO_FILE_BUFFERED,p,piece[i].size,piece[i].offset+sizeof(hfile_chunk_t),-1,r,piece[i].size);
+      p+=piece[i].size;
+    }
+    return 0;
+  }
+
+// small cold content goes by O_DIRECT through aligned bounce buffer
+  uint64_t from=off & ~(uint64_t)(AIO_ALIGN-1);
+  uint64_t len=(off+d.size-from+AIO_ALIGN-1) & ~(uint64_t)(AIO_ALIGN-1);
+  if(a->dfd>=0 && a->slot_cnt && len<=a->slot)
+  {
+    q->slot=a->slot_free[--a->slot_cnt];
+    q->skip=off-from;
+    void* buf=a->slots+(size_t)q->slot*a->slot;
+    aio_prep(a,a->fixed_bufs ? IORING_OP_READ_FIXED : IORING_OP_READ,AIO_FILE_DIRECT,buf,len,from,q->slot,r,q->skip+d.size);
+  }
+  else
+    aio_prep(a,IORING_OP_READ,AIO_FILE_BUFFERED,dest,d.size,off,-1,r,d.size);
+  return 0;
+}
+
+//! move ring completions of finished requests to ready queue
+static void aio_drain(aio_t* a)
+{
+  uint32_t head=*a->cq_head;
+  uint32_t tail=__atomic_load_n(a->cq_tail,__ATOMIC_ACQUIRE);
+  for(;head!=tail;head++)
+  {
+    const struct io_uring_cqe* c=a->cqes+(head & a->cq_mask);
+    uint32_t r=c->user_data;
+    uint32_t need=c->user_data>>32;
+    aio_req_t* q=a->req+r;
+    a->inflight--;
+    if(c->res<0)
+      q->done.err=c->res;
+    else if((uint32_t)c->res<need)
+      q->done.err=-EIO;
+    if(--q->reads)  continue;
+
+    if(q->slot>=0)
+    {
+      if(!q->done.err)
+        memcpy(q->dest,a->slots+(size_t)q->slot*a->slot+q->skip,q->done.size);
+      a->slot_free[a->slot_cnt++]=q->slot;
+    }
+    q->done.data=q->done.err ? 0 : q->dest;
+    aio_ready(a,&q->done);
+    q->next=a->free;
+    a->free=r;
+  }
+  __atomic_store_n(a->cq_head,head,__ATOMIC_RELEASE);
+}
+
+ssize_t aio_reap(aio_t* a,aio_done_t* out,size_t max,int wait)
+{
+  if(!a || !out)  return -1;
+  if(a->efd>=0)
+  {
+// reset before draining, completions posted later signal it again
+    uint64_t v;
+    if(read(a->efd,&v,sizeof(v))<0)  v=0;
+  }
+  if(a->ring>=0)
+  {
+    if(a->queued)
+    {
+      int r=aio_enter(a->ring,a->queued,0,0);
+      if(r<0 && errno!=EINTR && errno!=EAGAIN && errno!=EBUSY)
+      {
+        log("io_uring_enter failed: %s",strerror(errno));
+        return -1;
+      }
+      if(r>0)  a->queued-=r;
+    }
+    aio_drain(a);
+// pieces of chunked content complete one by one, wait until whole request is done
+    while(wait && !a->ready_cnt && a->inflight)
+    {
+      int r=aio_enter(a->ring,a->queued,1,IORING_ENTER_GETEVENTS);
+      if(r<0 && errno!=EINTR && errno!=EAGAIN && errno!=EBUSY)
+      {
+        log("io_uring_enter failed: %s",strerror(errno));
+        return -1;
+      }
+      if(r>0)  a->queued-=r;
+      aio_drain(a);
+    }
+  }
+
+  size_t rv=0;
+  for(;rv<max && a->ready_cnt;rv++)
+  {
+    out[rv]=a->ready[a->ready_head];
+    a->ready_head=(a->ready_head+1)%a->depth;
+    a->ready_cnt--;
+  }
+  a->used-=rv;
+  return rv;
+}
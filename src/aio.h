@@ -0,0 +1,46 @@
+//! \file
+//! \brief asynchronous content reads on io_uring for event loops: resident content is served from mmap at once,
+//! cold one is read by O_DIRECT into registered bounce buffers or directly to destination, completions are polled
+
+typedef struct aio_t aio_t;
+
+//! default count of reads in flight
+#define AIO_DEPTH		64
+//! default bounce buffer size, bigger content is read to destination by buffered reads
+#define AIO_SLOT		(64*1024)
+//! O_DIRECT alignment of file offsets, lengths and buffers
+#define AIO_ALIGN		4096
+
+//! aio_done_t.flags: content was resident and served without I/O, data points to mmaped content or, for chunked one, to destination
+#define AIO_CACHED		1
+
+//! completion
+typedef struct aio_done_t
+{
+  uint64_t user;			//!< tag given to submit
+  ssize_t idx;				//!< name index, -1 if name is not found
+  const void* data;			//!< content, in destination or mmaped for AIO_CACHED
+  uint64_t size;			//!< content size, needed destination size on -ENOBUFS
+  int err;				//!< 0 or -errno: -ENOENT name not found, -ENOBUFS destination too small, -EIO short read
+  uint32_t flags;			//!< AIO_*
+} aio_done_t;
+
+//! ctr for database, one per event loop thread, it is not thread safe. depth and slot are 0 for defaults.
+//! without io_uring in kernel reads are done by pread at submission
+aio_t* aio_init(const hfile_t* hf,uint32_t depth,uint32_t slot);
+//! dtr, waits for reads in flight
+void aio_free(aio_t*);
+//! eventfd signalled on ring completions for epoll, -1 if there is none. reap until it returns less than max after signal
+int aio_fd(const aio_t*);
+//! 1 if reads go through io_uring
+int aio_async(const aio_t*);
+
+//! queue read of content by name into dest of size bytes. return 0 if queued, -1 if queue is full (reap first) or on error.
+//! missing names and resident content complete without I/O
+int aio_submit(aio_t* a,const char* name,void* dest,size_t size,uint64_t user);
+//! the same by name index
+int aio_submit_idx(aio_t* a,size_t idx,void* dest,size_t size,uint64_t user);
+//! submit queued reads and return up to max completions, waiting for at least one if wait is set and reads are in flight
+ssize_t aio_reap(aio_t* a,aio_done_t* out,size_t max,int wait);
+//! count of submitted but not reaped reads
+size_t aio_pending(const aio_t*);
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "common.h"
+#include "alias.h"
+
+
+double alias_build(const double* w,size_t n,alias_t* t)
+{
+  double total=0;
+  for(size_t i=0;i<n;i++)
+    if(isfinite(w[i]) && w[i]>0)  total+=w[i];
+  if(!n || !(total>0) || !isfinite(total))  return 0;
+
+// Vose: buckets below average take remainder of one above it, small ones stacked from the start, large from the end
+  double* p=md_tmalloc(double,n);
+  uint32_t* work=md_tmalloc(uint32_t,n);
+  size_t small=0,large=n;
+  uint32_t any=0;
+  for(size_t i=0;i<n;i++)
+  {
+    p[i]=isfinite(w[i]) && w[i]>0 ? w[i]*n/total : 0;
+    if(p[i]>0)  any=i;
+    if(p[i]<1)  work[small++]=i;
+    else  work[--large]=i;
+  }
+
+  while(small && large<n)
+  {
+    uint32_t s=work[--small];
+    uint32_t l=work[large++];
+    t[s].prob=p[s]*4294967296.0;
+    t[s].alias=l;
+    p[l]-=1-p[s];
+    if(p[l]<1)  work[small++]=l;
+    else  work[--large]=l;
+  }
+// leftovers are full up to rounding, zero weights still must not be drawn
+  while(small)
+  {
+    uint32_t s=work[--small];
+    t[s].prob=p[s]>0 ? UINT32_MAX : 0;
+    t[s].alias=p[s]>0 ? s : any;
+  }
+  while(large<n)
+  {
+    uint32_t l=work[large++];
+    t[l].prob=UINT32_MAX;
+    t[l].alias=l;
+  }
+  free(p);
+  free(work);
+  return total;
+}
+
+void alias_rng_seed(uint64_t s[4],uint64_t seed)
+{
+  for(size_t i=0;i<4;i++)
+  {
+    uint64_t z=(seed+=0x9e3779b97f4a7c15ULL);
+    z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+    z=(z^(z>>27))*0x94d049bb133111ebULL;
+    s[i]=z^(z>>31);
+  }
+}
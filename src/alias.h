@@ -0,0 +1,39 @@
+//! \file
+//! \brief Walker/Vose alias table for O(1) weighted draws, xoshiro256** generator
+
+//! bucket of table, stored in data.alias as is: own index is drawn if coin is below prob, alias otherwise
+typedef struct alias_t
+{
+  uint32_t prob;			//!< probability of own index scaled to 2^32, UINT32_MAX for full bucket
+  uint32_t alias;			//!< other index of bucket
+} __attribute__ ((packed)) alias_t;
+
+//! build table of n buckets from weights, non positive and non finite weights are never drawn.
+//! return sum of weights taken, 0 if there are no positive ones
+double alias_build(const double* w,size_t n,alias_t* t);
+
+//! index for 64 random bits: high part of r*n picks bucket, low part is position in it and serves as coin
+static inline uint32_t alias_draw(const alias_t* t,uint32_t n,uint64_t r)
+{
+  unsigned __int128 m=(unsigned __int128)r*n;
+  uint32_t i=m>>64;
+  return (uint32_t)((uint64_t)m>>32)<t[i].prob ? i : t[i].alias;
+}
+
+//! seed generator state by splitmix64 of seed
+void alias_rng_seed(uint64_t s[4],uint64_t seed);
+
+//! next 64 random bits, xoshiro256**
+static inline uint64_t alias_rng_next(uint64_t s[4])
+{
+  uint64_t r=s[1]*5;
+  r=(r<<7 | r>>57)*9;
+  uint64_t t=s[1]<<17;
+  s[2]^=s[0];
+  s[3]^=s[1];
+  s[1]^=s[2];
+  s[0]^=s[3];
+  s[2]^=t;
+  s[3]=s[3]<<45 | s[3]>>19;
+  return r;
+}
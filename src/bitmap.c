@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "bitmap.h"
+
+
+bitmap_t* bitmap_init(size_t bits)
+{
+  bitmap_t* rv=md_new(rv);
+  rv->bits=bits;
+  rv->data=md_tcalloc(uint64_t,bitmap_words(bits)+1);
+  return rv;
+}
+
+void bitmap_free(bitmap_t* b)
+{
+  if(!b)  return;
+  free(b->data);
+  free(b);
+}
+
+size_t bitmap_count(const bitmap_t* b)
+{
+  if(!b)  return 0;
+  size_t rv=0;
+  for(size_t i=0;i<bitmap_words(b->bits);i++)
+    rv+=__builtin_popcountll(__atomic_load_n(b->data+i,__ATOMIC_RELAXED));
+  return rv;
+}
+
+int bitmap_save_file(const bitmap_t* b,FILE* f)
+{
+  if(!b || !f)  return 1;
+  size_t w=bitmap_words(b->bits);
+  return fwrite(b->data,sizeof(uint64_t),w,f)!=w;
+}
+
+int bitmap_load_file(bitmap_t* b,FILE* f)
+{
+  if(!b || !f)  return 1;
+  size_t w=bitmap_words(b->bits);
+  return fread(b->data,sizeof(uint64_t),w,f)!=w;
+}
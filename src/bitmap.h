@@ -0,0 +1,37 @@
+//! \file
+//! \brief plain bitmap over item indices, shared by recorders and filters
+
+typedef struct bitmap_t
+{
+  size_t bits;				//!< count of bits
+  uint64_t* data;			//!< (bits+63)/64 words
+} bitmap_t;
+
+#define bitmap_words(bits_)	(((bits_)+63)/64)
+
+//! ctr, all bits cleared
+bitmap_t* bitmap_init(size_t bits);
+//! dtr
+void bitmap_free(bitmap_t*);
+//! count of set bits
+size_t bitmap_count(const bitmap_t*);
+
+//! save in stream, only words, size is caller business
+int bitmap_save_file(const bitmap_t*,FILE* f);
+//! load words from stream
+int bitmap_load_file(bitmap_t*,FILE* f);
+
+//! set bit, safe to call from many threads. bit already set costs a plain load, no locked write
+static inline void bitmap_set(bitmap_t* b,size_t i)
+{
+  if(i>=b->bits)  return;
+  uint64_t m=1ULL<<(i%64);
+  if(!(__atomic_load_n(b->data+i/64,__ATOMIC_RELAXED) & m))
+    __atomic_fetch_or(b->data+i/64,m,__ATOMIC_RELAXED);
+}
+
+//! test bit
+static inline int bitmap_test(const bitmap_t* b,size_t i)
+{
+  return i<b->bits && (__atomic_load_n(b->data+i/64,__ATOMIC_RELAXED)>>(i%64))&1;
+}
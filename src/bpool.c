@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <uthash.h>
+
+#include "common.h"
+#include "bpool.h"
+
+//! O_DIRECT alignment of offsets, lengths and buffers
+#define BPOOL_ALIGN		4096
+
+//! queues of 2Q
+#define BPOOL_AM		0	//!< LRU of reused pages
+#define BPOOL_A1IN		1	//!< FIFO of pages read once
+#define BPOOL_A1OUT		2	//!< FIFO of numbers of pages evicted from A1IN, no data
+#define BPOOL_QUEUES		3
+
+typedef struct bpool_page_t
+{
+  uint64_t id;				//!< page number
+  uint8_t* data;			//!< 0 in BPOOL_A1OUT
+  uint32_t len;				//!< bytes read, less than page at end of file
+  uint32_t queue;
+  struct bpool_page_t* prev;
+  struct bpool_page_t* next;
+  UT_hash_handle hh;
+} bpool_page_t;
+
+typedef struct bpool_queue_t
+{
+  bpool_page_t* head;			//!< most recent
+  bpool_page_t* tail;
+  size_t cnt;
+} bpool_queue_t;
+
+typedef struct bpool_shard_t
+{
+  pthread_mutex_t lock;
+  bpool_page_t* hash;
+  bpool_queue_t q[BPOOL_QUEUES];
+  size_t cap;				//!< resident pages
+  size_t kin;				//!< BPOOL_A1IN share of them
+  size_t kout;				//!< remembered evicted pages
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t ghost_hits;
+  uint64_t evictions;
+} __attribute__ ((aligned(64))) bpool_shard_t;
+
+struct bpool_t
+{
+  int fd;				//!< buffered
+  int dfd;				//!< O_DIRECT, -1 if filesystem refuses it
+  int direct;				//!< dfd is used, reset when reads through it fail
+  uint32_t page;
+  uint64_t budget;
+  bpool_shard_t shard[BPOOL_SHARDS];
+};
+
+
+static void bpool_unlink(bpool_shard_t* s,bpool_page_t* p)
+{
+  bpool_queue_t* q=s->q+p->queue;
+  if(p->prev)  p->prev->next=p->next;
+  else  q->head=p->next;
+  if(p->next)  p->next->prev=p->prev;
+  else  q->tail=p->prev;
+  p->prev=p->next=0;
+  q->cnt--;
+}
+
+static void bpool_push(bpool_shard_t* s,bpool_page_t* p,uint32_t queue)
+{
+  bpool_queue_t* q=s->q+queue;
+  p->queue=queue;
+  p->prev=0;
+  p->next=q->head;
+  if(q->head)  q->head->prev=p;
+  else  q->tail=p;
+  q->head=p;
+  q->cnt++;
+}
+
+//! evict one page: from FIFO while it holds more than its share, its number is remembered, otherwise from LRU
+static void bpool_evict(bpool_shard_t* s)
+{
+  bpool_queue_t* in=s->q+BPOOL_A1IN;
+  bpool_queue_t* am=s->q+BPOOL_AM;
+  bpool_page_t* p=in->cnt>s->kin || !am->cnt ? in->tail : am->tail;
+  if(!p)  return;
+
+  bpool_unlink(s,p);
+  free(p->data);
+  p->data=0;
+  s->evictions++;
+  if(p->queue==BPOOL_AM)
+  {
+    HASH_DEL(s->hash,p);
+    free(p);
+    return;
+  }
+  bpool_push(s,p,BPOOL_A1OUT);
+  bpool_queue_t* out=s->q+BPOOL_A1OUT;
+  if(out->cnt>s->kout)
+  {
+    bpool_page_t* g=out->tail;
+    bpool_unlink(s,g);
+    HASH_DEL(s->hash,g);
+    free(g);
+  }
+}
+
+bpool_t* bpool_init(const char* path,uint64_t budget,uint32_t page)
+{
+  if(!path)  return 0;
+  if(!page)  page=BPOOL_PAGE;
+  page=(page+BPOOL_ALIGN-1) & ~(BPOOL_ALIGN-1);
+
+  int fd=open(path,O_RDONLY);
+  if(fd<0)
+  {
+    log("can not open <%s>: %s",path,strerror(errno));
+    return 0;
+  }
+
+  bpool_t* p=md_new(p);
+  p->fd=fd;
+  p->dfd=open(path,O_RDONLY|O_DIRECT);
+  p->direct=p->dfd>=0;
+  p->page=page;
+
+  size_t cap=budget/page/BPOOL_SHARDS;
+  if(cap<2)  cap=2;
+  p->budget=(uint64_t)cap*page*BPOOL_SHARDS;
+  for(size_t i=0;i<BPOOL_SHARDS;i++)
+  {
+    bpool_shard_t* s=p->shard+i;
+    pthread_mutex_init(&s->lock,0);
+    s->cap=cap;
+    s->kin=cap/4 ? cap/4 : 1;
+    s->kout=cap/2 ? cap/2 : 1;
+  }
+  return p;
+}
+
+void bpool_free(bpool_t* p)
+{
+  if(!p)  return;
+  for(size_t i=0;i<BPOOL_SHARDS;i++)
+  {
+    bpool_shard_t* s=p->shard+i;
+    bpool_page_t *e,*tmp;
+    HASH_ITER(hh,s->hash,e,tmp)
+    {
+      HASH_DEL(s->hash,e);
+      free(e->data);
+      free(e);
+    }
+    pthread_mutex_destroy(&s->lock);
+  }
+  if(p->dfd>=0)  close(p->dfd);
+  close(p->fd);
+  free(p);
+}
+
+//! read page to new aligned buffer, length in *len. 0 on error
+static uint8_t* bpool_load(bpool_t* p,uint64_t id,uint32_t* len)
+{
+  uint8_t* buf=0;
+  if(posix_memalign((void**)&buf,BPOOL_ALIGN,p->page))  return 0;
+
+  int direct=__atomic_load_n(&p->direct,__ATOMIC_RELAXED);
+  ssize_t r=direct ? pread(p->dfd,buf,p->page,id*p->page) : -1;
+// some filesystems open O_DIRECT but refuse reads, stay buffered then
+  if(direct && r<0 && errno==EINVAL)
+    __atomic_store_n(&p->direct,0,__ATOMIC_RELAXED);
+  if(r<0)
+    r=pread(p->fd,buf,p->page,id*p->page);
+  if(r<0)
+  {
+    log("page %ju read error: %s",(uintmax_t)id,strerror(errno));
+    free(buf);
+    return 0;
+  }
+  *len=r;
+  return buf;
+}
+
+//! copy part of page, reading it on miss. return -1 on error or if page is shorter than part
+static int bpool_copy(bpool_t* p,uint64_t id,uint32_t from,uint32_t size,uint8_t* dst)
+{
+  bpool_shard_t* s=p->shard+id%BPOOL_SHARDS;
+  bpool_page_t* e=0;
+
+  pthread_mutex_lock(&s->lock);
+  HASH_FIND(hh,s->hash,&id,sizeof(id),e);
+  if(e && e->data)
+  {
+    s->hits++;
+    if(e->queue==BPOOL_AM)
+    {
+      bpool_unlink(s,e);
+      bpool_push(s,e,BPOOL_AM);
+    }
+    int rv=from+size<=e->len ? 0 : -1;
+    if(!rv)  memcpy(dst,e->data+from,size);
+    pthread_mutex_unlock(&s->lock);
+    return rv;
+  }
+  pthread_mutex_unlock(&s->lock);
+
+// read without lock, other threads may load the same page meanwhile
+  uint32_t len=0;
+  uint8_t* buf=bpool_load(p,id,&len);
+  if(!buf)  return -1;
+
+  pthread_mutex_lock(&s->lock);
+  HASH_FIND(hh,s->hash,&id,sizeof(id),e);
+  if(e && e->data)
+  {
+    free(buf);
+    buf=0;
+  }
+  else if(e)
+  {
+    s->misses++;
+    s->ghost_hits++;
+    bpool_unlink(s,e);
+    bpool_push(s,e,BPOOL_AM);
+  }
+  else
+  {
+    s->misses++;
+    e=md_new(e);
+    e->id=id;
+    HASH_ADD_KEYPTR(hh,s->hash,&e->id,sizeof(e->id),e);
+    bpool_push(s,e,BPOOL_A1IN);
+  }
+  if(buf)
+  {
+    e->data=buf;
+    e->len=len;
+  }
+
+  int rv=from+size<=e->len ? 0 : -1;
+  if(!rv)  memcpy(dst,e->data+from,size);
+  while(s->q[BPOOL_AM].cnt+s->q[BPOOL_A1IN].cnt>s->cap)
+    bpool_evict(s);
+  pthread_mutex_unlock(&s->lock);
+  return rv;
+}
+
+int bpool_read(bpool_t* p,uint64_t off,void* dst,uint64_t size)
+{
+  if(!p || (!dst && size))  return -1;
+  uint8_t* d=dst;
+  while(size)
+  {
+    uint64_t id=off/p->page;
+    uint32_t from=off%p->page;
+    uint32_t l=size<p->page-from ? size : p->page-from;
+    if(bpool_copy(p,id,from,l,d))  return -1;
+    d+=l;
+    off+=l;
+    size-=l;
+  }
+  return 0;
+}
+
+void bpool_stat(bpool_t* p,bpool_stat_t* st)
+{
+  if(!p || !st)  return;
+  memset(st,0,sizeof(*st));
+  st->budget=p->budget;
+  st->page=p->page;
+  st->direct=__atomic_load_n(&p->direct,__ATOMIC_RELAXED);
+  for(size_t i=0;i<BPOOL_SHARDS;i++)
+  {
+    bpool_shard_t* s=p->shard+i;
+    pthread_mutex_lock(&s->lock);
+    st->resident+=(uint64_t)(s->q[BPOOL_AM].cnt+s->q[BPOOL_A1IN].cnt)*p->page;
+    st->hits+=s->hits;
+    st->misses+=s->misses;
+    st->ghost_hits+=s->ghost_hits;
+    st->evictions+=s->evictions;
+    pthread_mutex_unlock(&s->lock);
+  }
+}
@@ -0,0 +1,33 @@
+//! \file
+//! \brief buffer pool over pread for files far larger than RAM: fixed size pages in user space under byte budget,
+//! 2Q eviction (pages read once wait in FIFO, only reuse promotes them to LRU, so scans do not flush hot pages).
+//! pages are read by O_DIRECT where filesystem allows it, so page cache does not grow beside the pool
+
+typedef struct bpool_t bpool_t;
+
+//! default page size
+#define BPOOL_PAGE		(32*1024)
+//! independently locked parts, page belongs to part by its number
+#define BPOOL_SHARDS		16
+
+//! counters
+typedef struct bpool_stat_t
+{
+  uint64_t budget;			//!< bytes
+  uint64_t resident;			//!< bytes of pages in memory
+  uint64_t hits;			//!< page lookups found in memory
+  uint64_t misses;			//!< page reads
+  uint64_t ghost_hits;			//!< misses of recently evicted pages, they go to LRU
+  uint64_t evictions;
+  uint32_t page;			//!< page size
+  int direct;				//!< pages are read by O_DIRECT
+} bpool_stat_t;
+
+//! ctr for file, page is 0 for default. budget smaller than two pages per shard is raised to it
+bpool_t* bpool_init(const char* path,uint64_t budget,uint32_t page);
+//! dtr
+void bpool_free(bpool_t*);
+//! copy size bytes at offset off to dst, thread safe. return 0 on success, -1 on read error or beyond end of file
+int bpool_read(bpool_t* p,uint64_t off,void* dst,uint64_t size);
+//! sum counters of all shards
+void bpool_stat(bpool_t* p,bpool_stat_t* st);
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "cdc.h"
+
+
+int cdc_init(cdc_t* c,uint32_t avg)
+{
+  if(!c || avg<CDC_AVG_MIN || avg>CDC_AVG_MAX)  return -1;
+
+  uint32_t bits=31-__builtin_clz(avg);
+  c->avg=1U<<bits;
+  c->min=c->avg/4;
+  c->max=c->avg*8;
+// gear shifts left, so high bits depend on the longest window
+  c->mask_s=~0ULL<<(64-bits-2);
+  c->mask_l=~0ULL<<(64-bits+2);
+
+// fixed seed, cut points must not change between builds
+  uint64_t x=0x9e3779b97f4a7c15ULL;
+  for(size_t i=0;i<256;i++)
+  {
+    uint64_t z=(x+=0x9e3779b97f4a7c15ULL);
+    z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+    z=(z^(z>>27))*0x94d049bb133111ebULL;
+    c->gear[i]=z^(z>>31);
+  }
+  return 0;
+}
+
+size_t cdc_cut(const cdc_t* c,const uint8_t* p,size_t n)
+{
+  if(n<=c->min)  return n;
+  size_t end=n<c->max ? n : c->max;
+  size_t mid=c->avg<end ? c->avg : end;
+  uint64_t fp=0;
+  size_t i=c->min;
+
+  for(;i<mid;i++)
+  {
+    fp=(fp<<1)+c->gear[p[i]];
+    if(!(fp & c->mask_s))  return i+1;
+  }
+  for(;i<end;i++)
+  {
+    fp=(fp<<1)+c->gear[p[i]];
+    if(!(fp & c->mask_l))  return i+1;
+  }
+  return end;
+}
@@ -0,0 +1,25 @@
+//! \file
+//! \brief content defined chunking, FastCDC like: gear rolling hash, normalized cut masks around average piece size
+
+//! default average piece size
+#define CDC_AVG			8192
+//! smallest average piece size
+#define CDC_AVG_MIN		1024
+//! biggest average piece size
+#define CDC_AVG_MAX		(1U<<20)
+
+//! chunker parameters, immutable after cdc_init so may be shared by threads
+typedef struct cdc_t
+{
+  uint32_t min;				//!< no cut before, avg/4
+  uint32_t avg;				//!< harder mask before, easier after
+  uint32_t max;				//!< forced cut, avg*8
+  uint64_t mask_s;			//!< mask before avg, 2 bits more than log2(avg)
+  uint64_t mask_l;			//!< mask after avg, 2 bits less
+  uint64_t gear[256];			//!< random value per byte
+} cdc_t;
+
+//! set parameters for average piece size, rounded down to power of two. return -1 if out of [CDC_AVG_MIN,CDC_AVG_MAX]
+int cdc_init(cdc_t* c,uint32_t avg);
+//! length of first piece of buffer, whole buffer if it is not longer than min
+size_t cdc_cut(const cdc_t* c,const uint8_t* p,size_t n);
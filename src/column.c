@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "common.h"
+#include "column.h"
+
+
+uint32_t column_type(const char* val)
+{
+  if(!val || !*val || strspn(val,"0123456789+-.eE")!=strlen(val))  return COLUMN_NONE;
+  char* e=0;
+  errno=0;
+  strtoll(val,&e,10);
+  if(e!=val && !*e && !errno)  return COLUMN_I64;
+  strtod(val,&e);
+  return e==val || *e ? COLUMN_NONE : COLUMN_F64;
+}
+
+uint32_t column_merge(uint32_t a,uint32_t b)
+{
+  if(a==COLUMN_NONE || b==COLUMN_NONE)  return COLUMN_NONE;
+  return a>b ? a : b;
+}
+
+const char* column_type_name(uint32_t type)
+{
+  switch(type)
+  {
+    case COLUMN_I64: return "int";
+    case COLUMN_F64: return "float";
+  }
+  return "none";
+}
+
+size_t column_op_parse(const char* s,uint32_t* op)
+{
+  static const struct { const char* s; uint32_t op; } ops[]=
+  {
+    {"==",COLUMN_EQ},{"!=",COLUMN_NE},{"<=",COLUMN_LE},{">=",COLUMN_GE},{"=",COLUMN_EQ},{"<",COLUMN_LT},{">",COLUMN_GT}
+  };
+  for(size_t i=0;i<sizeof(ops)/sizeof(ops[0]);i++)
+  {
+    size_t l=strlen(ops[i].s);
+    if(!strncmp(s,ops[i].s,l))
+    {
+      *op=ops[i].op;
+      return l;
+    }
+  }
+  return 0;
+}
+
+int column_range(uint32_t type,uint32_t op,const char* val,column_range_t* r)
+{
+  uint32_t vt=column_type(val);
+  if(vt==COLUMN_NONE || op>COLUMN_GE)  return -1;
+  r->negate=op==COLUMN_NE;
+
+  if(type==COLUMN_F64)
+  {
+    double v=strtod(val,0);
+    r->lo.f=-INFINITY;
+    r->hi.f=INFINITY;
+    switch(op)
+    {
+      case COLUMN_EQ:
+      case COLUMN_NE: r->lo.f=r->hi.f=v; break;
+      case COLUMN_LT: r->hi.f=nextafter(v,-INFINITY); break;
+      case COLUMN_LE: r->hi.f=v; break;
+      case COLUMN_GT: r->lo.f=nextafter(v,INFINITY); break;
+      case COLUMN_GE: r->lo.f=v; break;
+    }
+    return 0;
+  }
+  if(type!=COLUMN_I64)  return -1;
+
+// integer bounds of value, equal for integers
+  int64_t fl,ce;
+  if(vt==COLUMN_I64)
+    fl=ce=strtoll(val,0,10);
+  else
+  {
+    double v=strtod(val,0);
+    fl=v<-0x1p63 ? INT64_MIN : v>=0x1p63 ? INT64_MAX : (int64_t)floor(v);
+    ce=v<-0x1p63 ? INT64_MIN : v>=0x1p63 ? INT64_MAX : (int64_t)ceil(v);
+  }
+
+  r->lo.i=INT64_MIN+1;
+  r->hi.i=INT64_MAX;
+  switch(op)
+  {
+    case COLUMN_EQ:
+    case COLUMN_NE:
+      if(fl==ce)
+        r->lo.i=r->hi.i=fl;
+      else
+      {
+        r->lo.i=1;
+        r->hi.i=0;
+      }
+      break;
+    case COLUMN_LT: r->hi.i=fl!=ce ? fl : fl>INT64_MIN ? fl-1 : INT64_MIN; break;
+    case COLUMN_LE: r->hi.i=fl; break;
+    case COLUMN_GT:
+      if(fl==ce && ce==INT64_MAX)
+      {
+        r->lo.i=1;
+        r->hi.i=0;
+      }
+      else
+        r->lo.i=fl!=ce ? ce : ce+1;
+      break;
+    case COLUMN_GE: r->lo.i=ce; break;
+  }
+// absent values are never in range
+  if(r->lo.i<INT64_MIN+1)  r->lo.i=INT64_MIN+1;
+  return 0;
+}
+
+//! scalar evaluation of words from w0
+static void column_eval_words(uint32_t type,const void* data,size_t w0,size_t n,const column_range_t* r,uint64_t* out,int and)
+{
+  for(size_t w=w0;w<(n+63)/64;w++)
+  {
+    size_t e=n-w*64<64 ? n-w*64 : 64;
+    uint64_t m=0;
+    if(type==COLUMN_I64)
+    {
+      const int64_t* x=(const int64_t*)data+w*64;
+      for(size_t j=0;j<e;j++)
+      {
+        uint64_t in=x[j]>=r->lo.i && x[j]<=r->hi.i;
+        if(r->negate)  in=!in && x[j]!=COLUMN_I64_NULL;
+        m|=in<<j;
+      }
+    }
+    else
+    {
+      const double* x=(const double*)data+w*64;
+      for(size_t j=0;j<e;j++)
+      {
+        uint64_t in=x[j]>=r->lo.f && x[j]<=r->hi.f;
+        if(r->negate)  in=!in && x[j]==x[j];
+        m|=in<<j;
+      }
+    }
+    out[w]=and ? out[w]&m : m;
+  }
+}
+
+#if defined(__x86_64__)
+//! full words with AVX2, 4 values per compare. return count of words done
+__attribute__((target("avx2")))
+static size_t column_eval_avx2(uint32_t type,const void* data,size_t n,const column_range_t* r,uint64_t* out,int and)
+{
+  size_t words=n/64;
+  if(type==COLUMN_I64)
+  {
+    __m256i lo=_mm256_set1_epi64x(r->lo.i);
+    __m256i hi=_mm256_set1_epi64x(r->hi.i);
+    __m256i nul=_mm256_set1_epi64x(COLUMN_I64_NULL);
+    for(size_t w=0;w<words;w++)
+    {
+      const int64_t* x=(const int64_t*)data+w*64;
+      uint64_t m=0;
+      for(size_t k=0;k<16;k++)
+      {
+        __m256i v=_mm256_loadu_si256((const __m256i*)(x+4*k));
+        uint64_t o=_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_cmpgt_epi64(lo,v),_mm256_cmpgt_epi64(v,hi))));
+        uint64_t in=r->negate ? o & ~(uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v,nul))) : ~o&15;
+        m|=in<<(4*k);
+      }
+      out[w]=and ? out[w]&m : m;
+    }
+  }
+  else
+  {
+    __m256d lo=_mm256_set1_pd(r->lo.f);
+    __m256d hi=_mm256_set1_pd(r->hi.f);
+    for(size_t w=0;w<words;w++)
+    {
+      const double* x=(const double*)data+w*64;
+      uint64_t m=0;
+      for(size_t k=0;k<16;k++)
+      {
+        __m256d v=_mm256_loadu_pd(x+4*k);
+        uint64_t in=_mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(v,lo,_CMP_GE_OQ),_mm256_cmp_pd(v,hi,_CMP_LE_OQ)));
+        if(r->negate)  in=_mm256_movemask_pd(_mm256_cmp_pd(v,v,_CMP_ORD_Q)) & ~in;
+        m|=in<<(4*k);
+      }
+      out[w]=and ? out[w]&m : m;
+    }
+  }
+  return words;
+}
+#elif defined(__aarch64__)
+//! full words with NEON, 2 values per compare. return count of words done
+static size_t column_eval_neon(uint32_t type,const void* data,size_t n,const column_range_t* r,uint64_t* out,int and)
+{
+  size_t words=n/64;
+  uint64x2_t ones=vdupq_n_u64(~0ULL);
+  for(size_t w=0;w<words;w++)
+  {
+    uint64_t m=0;
+    for(size_t k=0;k<32;k++)
+    {
+      uint64x2_t in,absent;
+      if(type==COLUMN_I64)
+      {
+        int64x2_t v=vld1q_s64((const int64_t*)data+w*64+2*k);
+        in=vandq_u64(vcgeq_s64(v,vdupq_n_s64(r->lo.i)),vcleq_s64(v,vdupq_n_s64(r->hi.i)));
+        absent=vceqq_s64(v,vdupq_n_s64(COLUMN_I64_NULL));
+      }
+      else
+      {
+        float64x2_t v=vld1q_f64((const double*)data+w*64+2*k);
+        in=vandq_u64(vcgeq_f64(v,vdupq_n_f64(r->lo.f)),vcleq_f64(v,vdupq_n_f64(r->hi.f)));
+        absent=veorq_u64(vceqq_f64(v,v),ones);
+      }
+// negation: neither in range nor absent
+      uint64x2_t t=r->negate ? vorrq_u64(in,absent) : in;
+      uint64_t b=(vgetq_lane_u64(t,0)&1) | (vgetq_lane_u64(t,1)&1)<<1;
+      m|=(r->negate ? ~b&3 : b)<<(2*k);
+    }
+    out[w]=and ? out[w]&m : m;
+  }
+  return words;
+}
+#endif
+
+void column_eval(uint32_t type,const void* data,size_t n,const column_range_t* r,uint64_t* out,int and)
+{
+  size_t w=0;
+#if defined(__x86_64__)
+  if(__builtin_cpu_supports("avx2"))
+    w=column_eval_avx2(type,data,n,r,out,and);
+#elif defined(__aarch64__)
+  w=column_eval_neon(type,data,n,r,out,and);
+#endif
+  column_eval_words(type,data,w,n,r,out,and);
+}
+
+void column_eval_scalar(uint32_t type,const void* data,size_t n,const column_range_t* r,uint64_t* out,int and)
+{
+  column_eval_words(type,data,0,n,r,out,and);
+}
@@ -0,0 +1,47 @@
+//! \file
+//! \brief dense numeric property columns indexed by name index, range predicates over them evaluated to bitmap words
+
+//! not a number, no column
+#define COLUMN_NONE		0
+//! all values are integers, absent value is COLUMN_I64_NULL
+#define COLUMN_I64		1
+//! all values are numbers, absent value is NaN
+#define COLUMN_F64		2
+
+#define COLUMN_I64_NULL		INT64_MIN
+
+//! comparisons of predicate
+#define COLUMN_EQ		0
+#define COLUMN_NE		1
+#define COLUMN_LT		2
+#define COLUMN_LE		3
+#define COLUMN_GT		4
+#define COLUMN_GE		5
+
+//! predicate as inclusive range of column type, negate selects present values outside it
+typedef struct column_range_t
+{
+  union
+  {
+    int64_t i;
+    double f;
+  } lo,hi;
+  int negate;
+} column_range_t;
+
+//! type of single value, COLUMN_NONE for empty, hex, inf and nan strings
+uint32_t column_type(const char* val);
+//! type of column holding values of both types
+uint32_t column_merge(uint32_t a,uint32_t b);
+//! name of type
+const char* column_type_name(uint32_t type);
+
+//! parse comparison at s, return its length, 0 if there is no comparison
+size_t column_op_parse(const char* s,uint32_t* op);
+//! range of "value op val" for column of given type. return -1 if val is not a number
+int column_range(uint32_t type,uint32_t op,const char* val,column_range_t* r);
+
+//! evaluate range over n values, bit j of word w is set for value w*64+j. words of out are set or, if and, combined with result
+void column_eval(uint32_t type,const void* data,size_t n,const column_range_t* r,uint64_t* out,int and);
+//! the same without SIMD
+void column_eval_scalar(uint32_t type,const void* data,size_t n,const column_range_t* r,uint64_t* out,int and);
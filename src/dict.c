@@ -3,6 +3,10 @@
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <cmph.h>
 #include <uuid/uuid.h>
@@ -11,32 +15,217 @@
 
 #include "common.h"
 #include "dict.h"
+#include "mph.h"
 
 
-//! default algorithm
-#define DICT_ALGO	CMPH_BDZ
+//! attempts to build in-tree MPH with different seeds
+#define DICT_MPH_TRIES	4
+//! size of n packed 40 bit offsets
+#define DICT_OFF40_BYTES(n)	((uint64_t)(n)*5)
+//! transparent huge page size of DICT_LOAD_HUGEPAGES
+#define DICT_HUGEPAGE		(2U<<20)
 
 static const uint32_t magic=MAGIC;
+//! file with recorded algorithm
+static const uint32_t magic2=MAGIC | (2U<<24);
+//! file with recorded algorithm and DICT_FLAG_*
+static const uint32_t magic3=MAGIC | (3U<<24);
+
+static const struct
+{
+  const char* name;
+  CMPH_ALGO cmph;
+} dict_algos[DICT_ALGO_COUNT]=
+{
+  [DICT_ALGO_BDZ]={"bdz",CMPH_BDZ},
+  [DICT_ALGO_CHD]={"chd",CMPH_CHD},
+  [DICT_ALGO_PTHASH]={"pthash",CMPH_COUNT},
+};
 
 typedef struct dict_t
 {
   uint8_t uuid[UUID_SIZE];		//!< common uuid
-  uint8_t cmph;				//!< flag, if 1 then cmph used else simple uthash
-  void* hash;				//!< cmph hash
+  uint8_t algo;				//!< DICT_ALGO_*
+  uint32_t flags;			//!< DICT_FLAG_*
+  void* hash;				//!< cmph_t or mph_t
   uint32_t max;				//!< maximal key length
   uint32_t sz;				//!< count of items
   uint64_t msz;				//!< memory allocated for strings
   uint8_t* mem;				//!< storage
-  uint32_t* data;			//!< indices for strings
+  uint32_t* data;			//!< offsets of strings by slot, ranks for DICT_FLAG_FRONT
+  uint8_t* data40;			//!< offsets of strings by slot packed in 40 bits, DICT_FLAG_OFF40
+  uint16_t* fp;				//!< fingerprints of strings by slot, DICT_FLAG_FP16
+  uint64_t* fp64;			//!< fingerprints by slot instead of strings, DICT_FLAG_NONAMES
+  uint64_t* blk;			//!< offsets of front coding blocks in storage, DICT_FLAG_FRONT
+  int fd;				//!< file strings and indices are read from if they are not resident, -1 otherwise
+  uint64_t data_pos;			//!< position of indices in file
+  uint64_t mem_pos;			//!< position of storage in file
+  uint32_t load;			//!< DICT_LOAD_* flags
+  uint64_t locked;			//!< bytes locked by DICT_LOAD_MLOCK
 } dict_t;
 
+//! decoded front coded strings or strings read from disk, returned by dict_get_byidx and compared by lookups,
+//! separate so key taken from dict_get_byidx can be looked up
+static __thread char dict_front_buf[DICT_FRONT_MAXLEN+1];
+static __thread char dict_front_key[DICT_FRONT_MAXLEN+1];
 
-dict_t* dict_init_strings(const char* uuid,char** data,size_t sz)
+
+const char* dict_algo_name(uint32_t algo)
 {
-  if(!data || !sz)
-    return 0;
+  return algo<DICT_ALGO_COUNT ? dict_algos[algo].name : 0;
+}
+
+int dict_algo_parse(const char* name)
+{
+  for(int i=0;name && i<DICT_ALGO_COUNT;i++)
+    if(!strcmp(name,dict_algos[i].name))
+      return i;
+  return -1;
+}
+
+
+//! 64 bit fingerprint, 16 bit one is its top
+static inline uint64_t dict_fp(mph_hash_t h)
+{
+  return (h.h1+h.h2)*0x9e3779b97f4a7c15ULL;
+}
+
+static inline uint64_t dict_seed(const dict_t* ph)
+{
+  return ph->algo==DICT_ALGO_PTHASH ? mph_seed(ph->hash) : 0;
+}
+
+//! slot of key and its fingerprint if dict have them
+static inline ssize_t dict_slot(const dict_t* ph,const void* key,size_t l,uint64_t* fp)
+{
+  if(ph->algo==DICT_ALGO_PTHASH)
+  {
+    mph_hash_t h=mph_hash(key,l,mph_seed(ph->hash));
+    if(ph->fp || ph->fp64)  *fp=dict_fp(h);
+    return mph_search_hash(ph->hash,h);
+  }
+  if(ph->fp || ph->fp64)  *fp=dict_fp(mph_hash(key,l,0));
+  return cmph_search(ph->hash,key,l);
+}
+
+//! check fingerprint of slot, return 0 if key is surely absent
+static inline int dict_fp_match(const dict_t* ph,size_t slot,uint64_t fp)
+{
+  if(ph->fp64)  return ph->fp64[slot]==fp;
+  if(ph->fp)  return ph->fp[slot]==(uint16_t)(fp>>48);
+  return 1;
+}
+
+static inline size_t dict_front_blocks(const dict_t* ph)
+{
+  return (ph->sz+DICT_FRONT_BLOCK-1)/DICT_FRONT_BLOCK;
+}
+
+//! width of index entry
+static inline size_t dict_off_width(const dict_t* ph)
+{
+  return ph->flags & DICT_FLAG_OFF40 ? 5 : sizeof(uint32_t);
+}
+
+//! read from file of dict with not resident strings, return 0 on success
+static int dict_pread(const dict_t* ph,void* bf,size_t sz,uint64_t pos)
+{
+  if(pread(ph->fd,bf,sz,pos)==sz)  return 0;
+  log("names read error at %ju: %s",(uintmax_t)pos,strerror(errno));
+  return -1;
+}
+
+//! decode string of given sorted rank: first string of block is plain, others are varint common prefix length and suffix
+static const char* dict_front_get(const dict_t* ph,uint32_t rank,char* bf)
+{
+  size_t b=rank/DICT_FRONT_BLOCK;
+  uint8_t* tmp=0;
+  const uint8_t* p=ph->mem+ph->blk[b];
+  if(!ph->mem)
+  {
+    uint64_t end=b+1<dict_front_blocks(ph) ? ph->blk[b+1] : ph->msz;
+    p=tmp=malloc(end-ph->blk[b]);
+    if(dict_pread(ph,tmp,end-ph->blk[b],ph->mem_pos+ph->blk[b]))
+    {
+      free(tmp);
+      *bf=0;
+      return bf;
+    }
+  }
+
+  size_t l=strlen(p)+1;
+  memcpy(bf,p,l);
+  p+=l;
+
+  for(uint32_t k=rank%DICT_FRONT_BLOCK;k;k--)
+  {
+    size_t lcp=0;
+    for(int sh=0;;sh+=7)
+    {
+      uint8_t c=*p++;
+      lcp|=(size_t)(c&0x7f)<<sh;
+      if(!(c&0x80))  break;
+    }
+    l=strlen(p)+1;
+    memcpy(bf+lcp,p,l);
+    p+=l;
+  }
+  free(tmp);
+  return bf;
+}
+
+//! index entry of slot: offset of string in plain storage, little endian 40 bit one if packed, or rank for front coded storage
+static inline uint64_t dict_off(const dict_t* ph,size_t slot)
+{
+  if(ph->data)  return ph->data[slot];
+  uint64_t rv=0;
+  if(ph->data40)
+    memcpy(&rv,ph->data40+5*slot,5);
+  else
+    dict_pread(ph,&rv,dict_off_width(ph),ph->data_pos+dict_off_width(ph)*slot);
+  return rv;
+}
+
+//! string of slot, names must be kept. bf is used if string is decoded or read from disk
+static inline const char* dict_slot_str(const dict_t* ph,size_t slot,char* bf)
+{
+  uint64_t off=dict_off(ph,slot);
+  if(ph->blk)  return dict_front_get(ph,off,bf);
+  if(ph->mem)  return ph->mem+off;
+
+// string is not longer than max but may be last in file
+  ssize_t r=pread(ph->fd,bf,ph->max+1,ph->mem_pos+off);
+  if(r<=0)
+  {
+    log("names read error at %ju: %s",(uintmax_t)(ph->mem_pos+off),strerror(errno));
+    r=0;
+  }
+  bf[r]=0;
+  return bf;
+}
+
+static inline const char* dict_str(const dict_t* ph,size_t slot)
+{
+  return dict_slot_str(ph,slot,dict_front_buf);
+}
+
+//! string of slot to compare with key
+static inline const char* dict_key(const dict_t* ph,size_t slot)
+{
+  return dict_slot_str(ph,slot,dict_front_key);
+}
+
+static inline ssize_t dict_hash(const dict_t* ph,const void* key,size_t l)
+{
+  if(ph->algo==DICT_ALGO_PTHASH)
+    return mph_search(ph->hash,key,l);
+  return cmph_search(ph->hash,key,l);
+}
 
+static dict_t* dict_new(const char* uuid,const dict_opt_t* opt)
+{
   dict_t* rv=calloc(1,sizeof(*rv));
+  rv->fd=-1;
 
   if(!uuid)
   {
@@ -46,62 +235,242 @@ dict_t* dict_init_strings(const char* uuid,char** data,size_t sz)
   }
   else
     memcpy(rv->uuid,uuid,sizeof(rv->uuid));
+  rv->algo=opt->algo;
+  rv->flags=opt->flags;
+  if(rv->flags & DICT_FLAG_NONAMES)
+    rv->flags&=~(DICT_FLAG_FP16 | DICT_FLAG_FRONT);
+  rv->flags&=~DICT_FLAG_OFF40;
+  return rv;
+}
 
-  rv->sz=sz;
-  size_t bmem=sz;
-  for(size_t i=0;i<sz;i++)
+typedef struct dict_keys_t
+{
+  const dict_t* d;
+  const uint64_t* t;
+} dict_keys_t;
+
+static mph_hash_t dict_mph_key(void* arg,size_t i,uint64_t seed)
+{
+  dict_keys_t* k=arg;
+  const char* s=k->d->mem+k->t[i];
+  return mph_hash(s,strlen(s),seed);
+}
+
+//! in-tree MPH over strings already in storage, t holds their offsets
+static mph_t* dict_mph(const dict_t* rv,const uint64_t* t,const dict_opt_t* opt)
+{
+  dict_keys_t k={rv,t};
+  mph_opt_t o={opt->partition,opt->threads};
+  mph_t* m=0;
+
+  for(uint64_t seed=0;!m && seed<DICT_MPH_TRIES;seed++)
+    m=mph_init(rv->sz,dict_mph_key,&k,seed,&o);
+  return m;
+}
+
+static int dict_front_cmp(const void* a,const void* b,void* arg)
+{
+  const dict_keys_t* k=arg;
+  return strcmp(k->d->mem+k->t[*(const uint32_t*)a],k->d->mem+k->t[*(const uint32_t*)b]);
+}
+
+//! replace plain storage by sorted front coded one, indices become ranks of strings. t holds offsets by slot
+static int dict_front(dict_t* rv,const uint64_t* t)
+{
+  if(rv->max>DICT_FRONT_MAXLEN)
   {
-    size_t l=strlen(data[i]);
-    bmem+=l;
+    log("names longer than %d bytes, front coding disabled",DICT_FRONT_MAXLEN);
+    rv->flags&=~DICT_FLAG_FRONT;
+    return -1;
   }
 
-  rv->data=malloc(sizeof(uint32_t)*sz);
-  memset(rv->data,0xff,sz*sizeof(uint32_t));
+  dict_keys_t k={rv,t};
+  uint32_t* ord=malloc(sizeof(uint32_t)*rv->sz);
+  for(size_t i=0;i<rv->sz;i++)
+    ord[i]=i;
+  qsort_r(ord,rv->sz,sizeof(ord[0]),dict_front_cmp,&k);
 
-  cmph_io_adapter_t *source=cmph_io_vector_adapter(data,sz);
-  cmph_config_t *config = cmph_config_new(source);
-  cmph_config_set_algo(config,DICT_ALGO);
+  rv->blk=malloc(sizeof(uint64_t)*dict_front_blocks(rv));
+// prefix length below DICT_FRONT_MAXLEN takes 2 bytes at most
+  uint8_t* mem=malloc(rv->msz+2*rv->sz);
+  uint64_t off=0;
+  const char* prev=0;
 
-  rv->hash = cmph_new(config);
-  cmph_config_destroy(config);
-  cmph_io_vector_adapter_destroy(source);
-  if(!rv->hash)
+  for(size_t i=0;i<rv->sz;i++)
   {
-    log("hash generation failed, check uniquess");
-    free(rv->data);
-    free(rv);
-    return 0;
+    const char* s=rv->mem+t[ord[i]];
+    size_t lcp=0;
+    if(i%DICT_FRONT_BLOCK)
+    {
+      while(s[lcp] && s[lcp]==prev[lcp])  lcp++;
+      size_t v=lcp;
+      for(;v>=0x80;v>>=7)
+        mem[off++]=(v&0x7f)|0x80;
+      mem[off++]=v;
+    }
+    else
+      rv->blk[i/DICT_FRONT_BLOCK]=off;
+
+    size_t l=strlen(s+lcp)+1;
+    memcpy(mem+off,s+lcp,l);
+    off+=l;
+    prev=s;
   }
 
-  rv->mem=malloc(bmem);
-  rv->msz=bmem;
-  uint32_t* t=malloc(sizeof(uint32_t)*sz);
-  uint32_t c=0;
-  for(size_t i=0;i<sz;i++)
+  rv->data=malloc(sizeof(uint32_t)*rv->sz);
+  for(size_t i=0;i<rv->sz;i++)
+    rv->data[ord[i]]=i;
+  free(ord);
+  free(rv->mem);
+  rv->mem=realloc(mem,off);
+  rv->msz=off;
+  return 0;
+}
+
+//! keep offsets by slot in 32 bits, or in packed 40 bits if storage is bigger than 4GB
+static void dict_pack(dict_t* rv,const uint64_t* t)
+{
+  if(rv->msz<=UINT32_MAX)
   {
-    size_t u=strlen(data[i]);
-    t[i]=c;
-    memcpy(rv->mem+t[i],data[i],++u);
-    c+=u;
+    rv->data=malloc(sizeof(uint32_t)*rv->sz);
+    for(size_t i=0;i<rv->sz;i++)
+      rv->data[i]=t[i];
+    return;
   }
 
-  while(sz--)
+  rv->flags|=DICT_FLAG_OFF40;
+  rv->data40=malloc(DICT_OFF40_BYTES(rv->sz));
+  for(size_t i=0;i<rv->sz;i++)
+    memcpy(rv->data40+5*i,t+i,5);
+}
+
+//! fill indices by strings in storage, t holds their offsets and is reordered by slot
+static void dict_fill(dict_t* rv,uint64_t* t)
+{
+  uint32_t* sl=malloc(sizeof(uint32_t)*rv->sz);
+  uint8_t* seen=calloc((rv->sz+7)/8,1);
+
+  for(size_t i=0;i<rv->sz;i++)
   {
-    size_t l=strlen(data[sz]);
+    const char* s=rv->mem+t[i];
+    size_t l=strlen(s);
     if(l>rv->max) rv->max=l;
-    ssize_t q=cmph_search(rv->hash,data[sz],l);
-    if(q<0)
+    ssize_t q=dict_hash(rv,s,l);
+    if(q<0 || q>=rv->sz)
     {
       log("hash creation internal error");
       crash("integrity broken");
     }
-    if(rv->data[q]!=0xffffffff)
+    if(seen[q/8] & (1<<(q%8)))
     {
       log("hash creation internal error");
       crash("integrity broken");
     }
-    rv->data[q]=t[sz];
+    seen[q/8]|=1<<(q%8);
+    sl[i]=q;
+  }
+  free(seen);
+
+// permute offsets to slot order following cycles
+  for(size_t i=0;i<rv->sz;i++)
+    while(sl[i]!=i)
+    {
+      size_t j=sl[i];
+      uint64_t o=t[i];
+      t[i]=t[j];
+      t[j]=o;
+      sl[i]=sl[j];
+      sl[j]=j;
+    }
+  free(sl);
+
+  if(rv->flags & DICT_FLAG_FP16)
+  {
+    rv->fp=malloc(sizeof(uint16_t)*rv->sz);
+    for(size_t i=0;i<rv->sz;i++)
+    {
+      const char* s=rv->mem+t[i];
+      rv->fp[i]=dict_fp(mph_hash(s,strlen(s),dict_seed(rv)))>>48;
+    }
+  }
+
+// names are dropped, fingerprints are kept instead
+  if(rv->flags & DICT_FLAG_NONAMES)
+  {
+    rv->fp64=malloc(sizeof(uint64_t)*rv->sz);
+    for(size_t i=0;i<rv->sz;i++)
+    {
+      const char* s=rv->mem+t[i];
+      rv->fp64[i]=dict_fp(mph_hash(s,strlen(s),dict_seed(rv)));
+    }
+    free(rv->mem);
+    rv->mem=0;
+    rv->msz=0;
+    return;
+  }
+
+  if(!(rv->flags & DICT_FLAG_FRONT) || dict_front(rv,t))
+    dict_pack(rv,t);
+}
+
+
+dict_t* dict_init_strings(const char* uuid,char** data,size_t sz)
+{
+  return dict_init_strings_ex(uuid,data,sz,0);
+}
+
+dict_t* dict_init_strings_ex(const char* uuid,char** data,size_t sz,const dict_opt_t* opt)
+{
+  dict_opt_t noopt={DICT_ALGO_DEFAULT,};
+  if(!opt)  opt=&noopt;
+  uint32_t algo=opt->algo;
+  if(!data || !sz || algo>=DICT_ALGO_COUNT)
+    return 0;
+
+  dict_t* rv=dict_new(uuid,opt);
+
+  rv->sz=sz;
+  size_t bmem=sz;
+  for(size_t i=0;i<sz;i++)
+  {
+    size_t l=strlen(data[i]);
+    bmem+=l;
   }
+
+  rv->mem=malloc(bmem);
+  rv->msz=bmem;
+  uint64_t* t=malloc(sizeof(uint64_t)*sz);
+  uint64_t c=0;
+  for(size_t i=0;i<sz;i++)
+  {
+    size_t u=strlen(data[i]);
+    t[i]=c;
+    memcpy(rv->mem+t[i],data[i],++u);
+    c+=u;
+  }
+
+  if(algo==DICT_ALGO_PTHASH)
+    rv->hash=dict_mph(rv,t,opt);
+  else
+  {
+    cmph_io_adapter_t *source=cmph_io_vector_adapter(data,sz);
+    cmph_config_t *config = cmph_config_new(source);
+    cmph_config_set_algo(config,dict_algos[algo].cmph);
+
+    rv->hash = cmph_new(config);
+    cmph_config_destroy(config);
+    cmph_io_vector_adapter_destroy(source);
+  }
+
+  if(!rv->hash)
+  {
+    log("hash generation failed, check uniquess");
+    free(t);
+    dict_free(rv);
+    return 0;
+  }
+
+  dict_fill(rv,t);
   free(t);
 
   return rv;
@@ -112,9 +481,17 @@ void dict_free(dict_t* ph)
 {
   if(!ph)
     return;
-  cmph_destroy(ph->hash);
+  if(ph->hash && ph->algo==DICT_ALGO_PTHASH)
+    mph_free(ph->hash);
+  else if(ph->hash)
+    cmph_destroy(ph->hash);
   free(ph->data);
+  free(ph->data40);
+  free(ph->fp);
+  free(ph->fp64);
+  free(ph->blk);
   free(ph->mem);
+  if(ph->fd>=0)  close(ph->fd);
   free(ph);
 }
 
@@ -192,42 +569,41 @@ cmph_io_adapter_t *dict_tsvadapter(FILE* f)
 
 dict_t* dict_init_tsv(const char* uuid,const char* file)
 {
-  if(!file || !*file)
+  return dict_init_tsv_ex(uuid,file,0);
+}
+
+dict_t* dict_init_tsv_ex(const char* uuid,const char* file,const dict_opt_t* opt)
+{
+  dict_opt_t noopt={DICT_ALGO_DEFAULT,};
+  if(!opt)  opt=&noopt;
+  uint32_t algo=opt->algo;
+  if(!file || !*file || algo>=DICT_ALGO_COUNT)
     return 0;
 
   FILE* f=fopen(file,"r");
   if(!f)  return 0;
 
-
-  cmph_io_adapter_t *source = dict_tsvadapter(f);
-  cmph_config_t *config = cmph_config_new(source);
-  cmph_config_set_algo(config, DICT_ALGO);
-  cmph_t* hash = cmph_new(config);
-  cmph_config_destroy(config);
-  dict_tsvadapter_destroy(source);
-
-  if(!hash)
-  {
-    fclose(f);
-    log("creating MPH fro <%s> failed, check uniqueness",file);
-    return 0;
-  }
-
-  dict_t* rv=calloc(1,sizeof(*rv));
-
-  if(!uuid)
+  cmph_t* hash=0;
+  if(algo!=DICT_ALGO_PTHASH)
   {
-    uuid_t u;
-    uuid_generate_random(u);
-    uuid_unparse_lower(u,rv->uuid);
+    cmph_io_adapter_t *source = dict_tsvadapter(f);
+    cmph_config_t *config = cmph_config_new(source);
+    cmph_config_set_algo(config, dict_algos[algo].cmph);
+    hash = cmph_new(config);
+    cmph_config_destroy(config);
+    dict_tsvadapter_destroy(source);
+
+    if(!hash)
+    {
+      fclose(f);
+      log("creating MPH fro <%s> failed, check uniqueness",file);
+      return 0;
+    }
   }
-  else
-    memcpy(rv->uuid,uuid,sizeof(rv->uuid));
 
+  dict_t* rv=dict_new(uuid,opt);
   rv->hash=hash;
 
-//  rv->msz=rv->sz=dict_tsvadapter_count(f);
-
   char* bf=0;
   size_t z=0;
 
@@ -242,13 +618,11 @@ dict_t* dict_init_tsv(const char* uuid,const char* file)
   }
   rv->msz+=rv->sz;
   rv->mem=malloc(rv->msz);
-  rv->data=malloc(sizeof(uint32_t)*rv->sz);
-  memset(rv->data,0xff,rv->sz*sizeof(uint32_t));
 
   size_t cnt=0;
   size_t off=0;
 
-  uint32_t* t=malloc(sizeof(uint32_t)*rv->sz);
+  uint64_t* t=malloc(sizeof(uint64_t)*rv->sz);
   rewind(f);
 
   while(getline(&bf,&z,f)>=0)
@@ -263,35 +637,19 @@ dict_t* dict_init_tsv(const char* uuid,const char* file)
     cnt++;
   }
 
-  rewind(f);
-  cnt=0;
+  free(bf);
+  fclose(f);
 
-  while(getline(&bf,&z,f)>=0)
+  if(algo==DICT_ALGO_PTHASH && !(rv->hash=dict_mph(rv,t,opt)))
   {
-    if(!*bf || strchr(" \t\n\r\f",*bf))  continue;
-    bf=strsep(&bf,"\t\n\r\f");
-    size_t u=strlen(bf);
-
-    ssize_t q=cmph_search(rv->hash,bf,u);
-
-    if(q<0)
-    {
-      log("hash creation internal error");
-      crash("integrity broken");
-    }
-    if(rv->data[q]!=0xffffffff)
-    {
-      log("hash creation internal error");
-      crash("integrity broken");
-    }
-    if(u>rv->max) rv->max=u;
-    rv->data[q]=t[cnt++];
+    log("creating MPH fro <%s> failed, check uniqueness",file);
+    free(t);
+    dict_free(rv);
+    return 0;
   }
 
+  dict_fill(rv,t);
   free(t);
-  free(bf);
-
-  fclose(f);
   return rv;
 }
 
@@ -308,10 +666,14 @@ uint32_t dict_get_size(const dict_t* ph)
 
 uint32_t dict_get(const dict_t* ph,const void* key,size_t keylen)
 {
-  if(!ph || !key || !keylen)
+  if(!ph || !key || !keylen || keylen>ph->max+1)
     return -1;
-  ssize_t rv=cmph_search(ph->hash,key,keylen);
-  return (rv<0 || rv>=ph->sz) ? DICT_NOT_FOUND : (!memcmp(ph->mem+ph->data[rv],key,keylen) ? rv : -1);
+  uint64_t fp=0;
+  ssize_t rv=dict_slot(ph,key,keylen,&fp);
+  if(rv<0 || rv>=ph->sz || !dict_fp_match(ph,rv,fp))
+    return DICT_NOT_FOUND;
+  if(ph->flags & DICT_FLAG_NONAMES)  return rv;
+  return !memcmp(dict_key(ph,rv),key,keylen) ? rv : -1;
 }
 
 uint32_t dict_get_str(const dict_t* ph,const char* key)
@@ -319,21 +681,87 @@ uint32_t dict_get_str(const dict_t* ph,const char* key)
   if(!ph || !key)
     return -1;
   size_t l=strlen(key);
-  ssize_t rv=cmph_search(ph->hash,key,l);
-  return (rv<0 || rv>=ph->sz) ? DICT_NOT_FOUND : (!memcmp(ph->mem+ph->data[rv],key,l+1) ? rv : -1);
+  if(l>ph->max)
+    return DICT_NOT_FOUND;
+  uint64_t fp=0;
+  ssize_t rv=dict_slot(ph,key,l,&fp);
+  if(rv<0 || rv>=ph->sz || !dict_fp_match(ph,rv,fp))
+    return DICT_NOT_FOUND;
+  if(ph->flags & DICT_FLAG_NONAMES)  return rv;
+  return !memcmp(dict_key(ph,rv),key,l+1) ? rv : -1;
+}
+
+void dict_key_hash(const dict_t* ph,const void* key,size_t keylen,uint64_t hash[2])
+{
+  mph_hash_t h=mph_hash(key,keylen,ph ? dict_seed(ph) : 0);
+  hash[0]=h.h1;
+  hash[1]=h.h2;
+}
+
+uint32_t dict_get_hash(const dict_t* ph,const uint64_t hash[2])
+{
+  if(!ph || !hash || ph->algo!=DICT_ALGO_PTHASH)
+    return DICT_NOT_FOUND;
+  mph_hash_t h={hash[0],hash[1]};
+  uint32_t rv=mph_search_hash(ph->hash,h);
+  if(rv>=ph->sz || !dict_fp_match(ph,rv,dict_fp(h)))
+    return DICT_NOT_FOUND;
+  if(ph->flags & DICT_FLAG_NONAMES)  return rv;
+
+// no fingerprint to trust, compare with hash of stored name
+  const char* s=dict_key(ph,rv);
+  mph_hash_t q=mph_hash(s,strlen(s),mph_seed(ph->hash));
+  return q.h1==h.h1 && q.h2==h.h2 ? rv : DICT_NOT_FOUND;
 }
 
 const char* dict_get_byidx(const dict_t* ph,size_t idx)
 {
-  if(!ph || idx>=ph->sz)  return 0;
-  return ph->mem+ph->data[idx];
+  if(!ph || idx>=ph->sz || (ph->flags & DICT_FLAG_NONAMES))  return 0;
+  return dict_str(ph,idx);
+}
+
+const char* dict_get_pool(const dict_t* ph,uint64_t* size)
+{
+  if(!ph || !ph->mem || ph->blk || (ph->flags & DICT_FLAG_NONAMES))  return 0;
+  if(size)  *size=ph->msz;
+  return (const char*)ph->mem;
 }
 
 uint64_t dict_get_bytes(const dict_t* ph)
 {
   if(!ph)
     return 0;
-  return cmph_packed_size(ph->hash)+sizeof(*ph)+sizeof(ph->data[0])*ph->sz+ph->msz+1;
+  return dict_get_hash_bytes(ph)+sizeof(*ph)+(ph->data ? sizeof(ph->data[0])*ph->sz : 0)+
+         (ph->data40 ? DICT_OFF40_BYTES(ph->sz) : 0)+(ph->mem ? ph->msz+1 : 0)+
+         (ph->fp ? sizeof(ph->fp[0])*ph->sz : 0)+(ph->fp64 ? sizeof(ph->fp64[0])*ph->sz : 0)+
+         (ph->blk ? sizeof(ph->blk[0])*dict_front_blocks(ph) : 0);
+}
+
+uint64_t dict_get_locked(const dict_t* ph)
+{
+  return ph ? ph->locked : 0;
+}
+
+uint64_t dict_get_hash_bytes(const dict_t* ph)
+{
+  if(!ph)
+    return 0;
+  return ph->algo==DICT_ALGO_PTHASH ? mph_packed_size(ph->hash) : cmph_packed_size(ph->hash);
+}
+
+uint32_t dict_get_algo(const dict_t* ph)
+{
+  return ph ? ph->algo : DICT_ALGO_DEFAULT;
+}
+
+uint32_t dict_get_flags(const dict_t* ph)
+{
+  return ph ? ph->flags : 0;
+}
+
+int dict_str_resident(const dict_t* ph)
+{
+  return ph && ((ph->flags & DICT_FLAG_NONAMES) || (ph->mem && !ph->blk));
 }
 
 const char* dict_get_uuid(const dict_t* ph)
@@ -350,12 +778,58 @@ int dict_save(const dict_t* data,const char* fn)
   return rv;
 }
 
+static dict_t* dict_load_int(FILE* f,const char* fn,uint64_t budget,uint32_t flags);
+
+//! resident array of loaded hash, huge page aligned and advised for THP if it asks and array spans a huge page
+static void* dict_alloc(const dict_t* d,uint64_t size)
+{
+  if(!(d->load & DICT_LOAD_HUGEPAGES) || size<DICT_HUGEPAGE)  return malloc(size);
+  void* p=0;
+  if(posix_memalign(&p,DICT_HUGEPAGE,size))  return 0;
+  madvise(p,size & ~(uint64_t)(DICT_HUGEPAGE-1),MADV_HUGEPAGE);
+  return p;
+}
+
+//! lock resident arrays, hash internals stay pageable
+static void dict_mlock(dict_t* d)
+{
+  const struct { const void* p; uint64_t size; } a[]=
+  {
+    {d->mem,d->msz},
+    {d->data,(uint64_t)d->sz*sizeof(uint32_t)},
+    {d->data40,DICT_OFF40_BYTES(d->sz)},
+    {d->fp,(uint64_t)d->sz*sizeof(uint16_t)},
+    {d->fp64,(uint64_t)d->sz*sizeof(uint64_t)},
+    {d->blk,dict_front_blocks(d)*sizeof(uint64_t)},
+  };
+  for(size_t i=0;i<sizeof(a)/sizeof(a[0]);i++)
+  {
+    if(!a[i].p || !a[i].size)  continue;
+    if(mlock(a[i].p,a[i].size))
+    {
+      log("can not lock names hash in memory: %s",strerror(errno));
+      return;
+    }
+    d->locked+=a[i].size;
+  }
+}
+
 dict_t* dict_load(const char* fn)
+{
+  return dict_load_budget(fn,0);
+}
+
+dict_t* dict_load_budget(const char* fn,uint64_t budget)
+{
+  return dict_load_ex(fn,budget,0);
+}
+
+dict_t* dict_load_ex(const char* fn,uint64_t budget,uint32_t flags)
 {
   FILE *f=fopen(fn,"rb");
   if(!f)
     return 0;
-  dict_t* rv=dict_load_file(f);
+  dict_t* rv=dict_load_int(f,budget ? fn : 0,budget,flags);
   fclose(f);
   return rv;
 }
@@ -365,19 +839,82 @@ int dict_save_file(const dict_t* ph,FILE* f)
   if(!ph || !f)
     return 1;
 
-  if(fwrite(&magic,1,sizeof(magic),f)!=sizeof(magic)) return 1;
+  uint32_t algo=ph->algo;
+  if(fwrite(&magic3,1,sizeof(magic3),f)!=sizeof(magic3)) return 1;
+  if(fwrite(&algo,1,sizeof(algo),f)!=sizeof(algo)) return 1;
+  if(fwrite(&ph->flags,1,sizeof(ph->flags),f)!=sizeof(ph->flags)) return 1;
   if(fwrite(ph->uuid,1,sizeof(ph->uuid),f)!=sizeof(ph->uuid)) return 1;
   if(fwrite(&ph->sz,1,sizeof(ph->sz),f)!=sizeof(ph->sz)) return 1;
   if(fwrite(&ph->msz,1,sizeof(ph->msz),f)!=sizeof(ph->msz)) return 1;
   if(fwrite(&ph->max,1,sizeof(ph->max),f)!=sizeof(ph->max)) return 1;
-  if(fwrite(ph->data,1,(ph->sz*sizeof(uint32_t)),f)!=(ph->sz*sizeof(uint32_t))) return 1;
-  if(fwrite(ph->mem,1,ph->msz,f)!=ph->msz) return 1;
-
+  if(ph->data && fwrite(ph->data,1,(ph->sz*sizeof(uint32_t)),f)!=(ph->sz*sizeof(uint32_t))) return 1;
+  if(ph->data40 && fwrite(ph->data40,1,DICT_OFF40_BYTES(ph->sz),f)!=DICT_OFF40_BYTES(ph->sz)) return 1;
+  if(ph->mem && fwrite(ph->mem,1,ph->msz,f)!=ph->msz) return 1;
+  if(ph->blk && fwrite(ph->blk,1,dict_front_blocks(ph)*sizeof(uint64_t),f)!=dict_front_blocks(ph)*sizeof(uint64_t)) return 1;
+  if(ph->fp && fwrite(ph->fp,1,ph->sz*sizeof(uint16_t),f)!=ph->sz*sizeof(uint16_t)) return 1;
+  if(ph->fp64 && fwrite(ph->fp64,1,ph->sz*sizeof(uint64_t),f)!=ph->sz*sizeof(uint64_t)) return 1;
+
+  if(ph->algo==DICT_ALGO_PTHASH)
+    return mph_dump(ph->hash,f) ? 1 : 0;
   cmph_dump(ph->hash,f);
   return 0;
 }
 
+//! keep indices and then strings resident while they fit in budget, read the rest from file on access
+static int dict_resident(dict_t* rv,const char* fn,uint64_t budget)
+{
+  uint64_t need=dict_get_bytes(rv);
+  uint64_t idx=rv->sz*dict_off_width(rv);
+  if(need>budget)
+  {
+    log("names hash and fingerprints take %ju bytes, budget is %ju",(uintmax_t)need,(uintmax_t)budget);
+    return -1;
+  }
+
+  if((rv->fd=open(fn,O_RDONLY))<0)
+  {
+    log("can not open <%s>: %s",fn,strerror(errno));
+    return -1;
+  }
+
+  if(need+idx<=budget)
+  {
+    void* p=dict_alloc(rv,idx);
+    if(rv->flags & DICT_FLAG_OFF40)
+      rv->data40=p;
+    else
+      rv->data=p;
+    if(dict_pread(rv,p,idx,rv->data_pos))  return -1;
+    need+=idx;
+
+    if(need+rv->msz+1<=budget)
+    {
+      rv->mem=dict_alloc(rv,rv->msz);
+      if(dict_pread(rv,rv->mem,rv->msz,rv->mem_pos))  return -1;
+      close(rv->fd);
+      rv->fd=-1;
+      return 0;
+    }
+  }
+
+// strings are read to buffers of DICT_FRONT_MAXLEN
+  if(rv->max>=DICT_FRONT_MAXLEN)
+  {
+    log("names longer than %d bytes can not be kept on disk",DICT_FRONT_MAXLEN-1);
+    return -1;
+  }
+  if(!rv->fp)
+    log("names hash has no fingerprints, every miss reads disk, build with -O fingerprint=1 to avoid it");
+  return 0;
+}
+
 dict_t* dict_load_file(FILE* f)
+{
+  return dict_load_int(f,0,0,0);
+}
+
+//! load from stream, indices and strings are left in file fn if it is set and they exceed budget
+static dict_t* dict_load_int(FILE* f,const char* fn,uint64_t budget,uint32_t flags)
 {
   if(!f)
     return 0;
@@ -386,22 +923,75 @@ dict_t* dict_load_file(FILE* f)
 
   uint32_t m=0;
   if(fread(&m,1,sizeof(m),f)!=sizeof(m)) goto err;
-  if(m!=magic)  goto err;
+  if(m!=magic && m!=magic2 && m!=magic3)  goto err;
   rv=calloc(sizeof(dict_t),1);
+  rv->fd=-1;
+  rv->load=flags;
+
+  if(m!=magic)		// older files have no algorithm and are always cmph
+  {
+    uint32_t algo=0;
+    if(fread(&algo,1,sizeof(algo),f)!=sizeof(algo)) goto err;
+    if(algo>=DICT_ALGO_COUNT) goto err;
+    rv->algo=algo;
+  }
+  if(m==magic3)
+  {
+    if(fread(&rv->flags,1,sizeof(rv->flags),f)!=sizeof(rv->flags)) goto err;
+    if(rv->flags & ~DICT_FLAGS_KNOWN) goto err;
+    if((rv->flags & DICT_FLAG_FRONT) && (rv->flags & (DICT_FLAG_NONAMES | DICT_FLAG_OFF40))) goto err;
+  }
 
   if(fread(rv->uuid,1,sizeof(rv->uuid),f)!=sizeof(rv->uuid)) goto err;
   if(fread(&rv->sz,1,sizeof(rv->sz),f)!=sizeof(rv->sz)) goto err;
   if(fread(&rv->msz,1,sizeof(rv->msz),f)!=sizeof(rv->msz)) goto err;
   if(fread(&rv->max,1,sizeof(rv->max),f)!=sizeof(rv->max)) goto err;
 
-  rv->data=malloc(sizeof(uint32_t)*rv->sz);
-  if(fread(rv->data,1,rv->sz*sizeof(uint32_t),f)!=(rv->sz*sizeof(uint32_t))) goto err;
+  if(!(rv->flags & DICT_FLAG_NONAMES) && fn)
+  {
+    rv->data_pos=ftello(f);
+    rv->mem_pos=rv->data_pos+rv->sz*dict_off_width(rv);
+    if(fseeko(f,rv->mem_pos+rv->msz,SEEK_SET)) goto err;
+  }
+  else if(!(rv->flags & DICT_FLAG_NONAMES))
+  {
+    if(rv->flags & DICT_FLAG_OFF40)
+    {
+      rv->data40=dict_alloc(rv,DICT_OFF40_BYTES(rv->sz));
+      if(fread(rv->data40,1,DICT_OFF40_BYTES(rv->sz),f)!=DICT_OFF40_BYTES(rv->sz)) goto err;
+    }
+    else
+    {
+      rv->data=dict_alloc(rv,sizeof(uint32_t)*rv->sz);
+      if(fread(rv->data,1,rv->sz*sizeof(uint32_t),f)!=(rv->sz*sizeof(uint32_t))) goto err;
+    }
 
-  rv->mem=malloc(rv->msz);
-  if(fread(rv->mem,1,rv->msz,f)!=rv->msz) goto err;
+    rv->mem=dict_alloc(rv,rv->msz);
+    if(fread(rv->mem,1,rv->msz,f)!=rv->msz) goto err;
+  }
 
-  if(rv->hash=cmph_load(f))
-    return rv;
+  if(rv->flags & DICT_FLAG_FRONT)
+  {
+    if(rv->max>DICT_FRONT_MAXLEN) goto err;
+    rv->blk=dict_alloc(rv,sizeof(uint64_t)*dict_front_blocks(rv));
+    if(fread(rv->blk,1,dict_front_blocks(rv)*sizeof(uint64_t),f)!=dict_front_blocks(rv)*sizeof(uint64_t)) goto err;
+  }
+
+  if(rv->flags & DICT_FLAG_FP16)
+  {
+    rv->fp=dict_alloc(rv,sizeof(uint16_t)*rv->sz);
+    if(fread(rv->fp,1,rv->sz*sizeof(uint16_t),f)!=rv->sz*sizeof(uint16_t)) goto err;
+  }
+  if(rv->flags & DICT_FLAG_NONAMES)
+  {
+    rv->fp64=dict_alloc(rv,sizeof(uint64_t)*rv->sz);
+    if(fread(rv->fp64,1,rv->sz*sizeof(uint64_t),f)!=rv->sz*sizeof(uint64_t)) goto err;
+  }
+
+  if(!(rv->hash=(rv->algo==DICT_ALGO_PTHASH ? (void*)mph_load(f) : (void*)cmph_load(f)))) goto err;
+  if(fn && !(rv->flags & DICT_FLAG_NONAMES) && dict_resident(rv,fn,budget)) goto err;
+  if(flags & DICT_LOAD_MLOCK)  dict_mlock(rv);
+  return rv;
 err:
   dict_free(rv);
   return 0;
@@ -413,11 +1003,12 @@ void dict_dump(const dict_t* d,FILE *f)
   if(!d || !f)  return;
   fprintf(f,"uuid %s\n",d->uuid);
   fprintf(f,"size %u msz %ju\n",d->sz,d->msz);
+  if(d->flags & DICT_FLAG_NONAMES)  return;
   for(size_t i=0;i<d->sz;i++)
   {
-    const char* s=d->mem+d->data[i];
+    const char* s=dict_str(d,i);
     uint32_t h=dict_get_str(d,s);
-    fprintf(f,"%zd\t%u\t%u\t%s\t%s\n",i,h,d->data[h],s,d->mem+d->data[h]);
+    fprintf(f,"%zd\t%u\t%ju\t%s\t%s\n",i,h,dict_off(d,h),s,dict_key(d,h));
   }
 }
 
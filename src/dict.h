@@ -3,11 +3,53 @@
 
 typedef struct dict_t dict_t;
 
+//! cmph BDZ, about 3 bits per key, several random memory accesses per lookup
+#define DICT_ALGO_BDZ		0
+//! cmph CHD
+#define DICT_ALGO_CHD		1
+//! in-tree PTHash-like, one pilot read per lookup, see mph.h
+#define DICT_ALGO_PTHASH	2
+#define DICT_ALGO_COUNT		3
+#define DICT_ALGO_DEFAULT	DICT_ALGO_BDZ
+
+//! keep 16 bit fingerprint per slot, most misses are rejected without touching strings
+#define DICT_FLAG_FP16		1
+//! keep 64 bit fingerprint per slot and no strings, names can not be listed
+#define DICT_FLAG_NONAMES	2
+//! keep strings sorted and front coded in blocks, decoded on access. ignored with DICT_FLAG_NONAMES
+#define DICT_FLAG_FRONT		4
+//! string offsets are packed in 40 bits, set by construction when strings take more than 4GB
+#define DICT_FLAG_OFF40		8
+#define DICT_FLAGS_KNOWN	(DICT_FLAG_FP16 | DICT_FLAG_NONAMES | DICT_FLAG_FRONT | DICT_FLAG_OFF40)
+
+//! names in front coding block, first one is stored in full
+#define DICT_FRONT_BLOCK	16
+//! longest name allowed in front coded pool, longer ones keep pool plain
+#define DICT_FRONT_MAXLEN	4096
+
+//! construction options
+typedef struct dict_opt_t
+{
+  uint32_t algo;			//!< DICT_ALGO_*
+  uint32_t flags;			//!< DICT_FLAG_*
+  uint32_t threads;			//!< construction threads, 0 for count of cpus. pthash only
+  uint32_t partition;			//!< keys per partition, 0 for default. pthash only
+} dict_opt_t;
+
+//! algorithm name, 0 if unknown
+const char* dict_algo_name(uint32_t algo);
+//! algorithm by name, -1 if unknown
+int dict_algo_parse(const char* name);
+
 
 //! create from string array, keylen taken as strlen+1.
 dict_t* dict_init_strings(const char* uuid,char** data,size_t sz);
 //! create from 1st field of tsv file
 dict_t* dict_init_tsv(const char* uuid,const char* file);
+//! create from string array with options, opt may be 0
+dict_t* dict_init_strings_ex(const char* uuid,char** data,size_t sz,const dict_opt_t* opt);
+//! create from 1st field of tsv file with options, opt may be 0
+dict_t* dict_init_tsv_ex(const char* uuid,const char* file,const dict_opt_t* opt);
 
 //! destructor
 void dict_free(dict_t*);
@@ -16,12 +58,29 @@ void dict_free(dict_t*);
 uint32_t dict_get(const dict_t*,const void* key,size_t keylen);
 //! getter, return record number or (uint32_t)-1.
 uint32_t dict_get_str(const dict_t*,const char* key);
+//! 128 bit hash of key for dict_get_hash, precomputed hashes stay valid for dict while it is not rebuilt
+void dict_key_hash(const dict_t*,const void* key,size_t keylen,uint64_t hash[2]);
+//! getter by key hash, pthash only. return record number or (uint32_t)-1.
+uint32_t dict_get_hash(const dict_t*,const uint64_t hash[2]);
 //! return count of items
 uint32_t dict_get_size(const dict_t*);
 //! return amount of memory
 uint64_t dict_get_bytes(const dict_t*);
-//! get string by index
+//! bytes of resident arrays locked on load by DICT_LOAD_MLOCK
+uint64_t dict_get_locked(const dict_t*);
+//! return amount of memory taken by hash function alone
+uint64_t dict_get_hash_bytes(const dict_t*);
+//! return DICT_ALGO_*
+uint32_t dict_get_algo(const dict_t*);
+//! return DICT_FLAG_*
+uint32_t dict_get_flags(const dict_t*);
+//! 1 if strings of dict_get_byidx stay valid while dict is loaded: plain pool is resident or names are not kept
+int dict_str_resident(const dict_t*);
+//! get string by index, 0 if names are not kept.
+//! front coded or not resident string is decoded or read to thread local buffer valid until next call in the same thread
 const char* dict_get_byidx(const dict_t* ph,size_t idx);
+//! resident plain string pool: strings NUL terminated back to back, size in *size. 0 if strings are front coded, on disk or not kept
+const char* dict_get_pool(const dict_t* ph,uint64_t* size);
 //! get uuid
 const char* dict_get_uuid(const dict_t*);
 //! get maximal key length
@@ -36,5 +95,14 @@ int dict_save_file(const dict_t*,FILE* f);
 dict_t* dict_load(const char* fn);
 //! load from stream
 dict_t* dict_load_file(FILE* f);
+//! load keeping hash and fingerprints resident, then indices and strings while they fit in budget bytes.
+//! the rest is read from file on access, one read per hit for strings, two if indices are not resident. 0 budget for no limit
+dict_t* dict_load_budget(const char* fn,uint64_t budget);
+//! dict_load_ex flags: resident arrays of a huge page or more are aligned and advised for transparent huge pages
+#define DICT_LOAD_HUGEPAGES	1
+//! dict_load_ex flags: resident arrays are locked in memory, failure to lock is logged and ignored
+#define DICT_LOAD_MLOCK		2
+//! dict_load_budget with DICT_LOAD_* flags
+dict_t* dict_load_ex(const char* fn,uint64_t budget,uint32_t flags);
 
 void dict_dump(const dict_t* d,FILE *f);
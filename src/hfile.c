@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
@@ -11,8 +12,9 @@
 #include <unistd.h>
 #include <errno.h>
 #include <dirent.h>
-#include <fnmatch.h>
 #include <utime.h>
+#include <time.h>
+#include <math.h>
 
 #include <uuid/uuid.h>
 #include <uthash.h>
@@ -22,122 +24,17 @@
 #include "dict.h"
 #include "utils.h"
 #include "hfile.h"
-
-
-#define HFILE_FLAG_DELETED	1
-#define HFILE_FLAG_CORRUPTED	2
-
-#if HFILE_USE_HUGEPAGES
-#define HUGEPAGE	MAP_HUGETLB
-#else
-#define HUGEPAGE	0
-#endif
-
-//! dummy macros for point to on disk storage
-#define PERSISTENT
-
-//! common header for all files
-PERSISTENT typedef struct hfile_header_t
-{
-  uint32_t magic;			//!< common magic
-  uint32_t version;			//!< HFILE_VERSION
-  uint64_t size;			//!< size of entire file include header
-  uint32_t chunks;			//!< number of items
-  uint64_t tm;				//!< creation/last modification time
-  uint8_t uuid[UUID_SIZE];		//!< common uuid
-  uint8_t checksum[CHECKSUM_SIZE];	//!< checksum of entire file without header
-} __attribute__ ((packed)) hfile_header_t;
-
-
-//! single file pointer, one item of index file
-PERSISTENT typedef struct hfile_idx_item_t
-{
-  uint64_t content_offset;
-  uint64_t name_offset;
-//  uint32_t content_size;
-//  uint32_t name_size;
-} __attribute__ ((packed)) hfile_idx_item_t;
-
-
-//! index file
-typedef struct hfile_idx_t
-{
-  void* base;				//!< base mmaped ptr
-  uint64_t mmapsize;			//!< size of memory mapped region
-  int fd;				//!< index file descriptor
-  hfile_header_t header;		//!< copy of header
-  hfile_idx_item_t* data;		//!< pointer to hfile_idx_item_t
-} hfile_idx_t;
-
-
-//! chunk, header of single file in data file collection
-PERSISTENT typedef struct hfile_chunk_t
-{
-  uint32_t magic2;
-  uint32_t size;			//!< chunk total size include this header
-  uint8_t flags;			//!< HFILE_FILE_FLAG_*
-  uint8_t checksum[CHECKSUM_SIZE];	//!< hash of file content only
-} __attribute__ ((packed)) hfile_chunk_t;
-
-
-//! base data file
-typedef struct hfile_content_t
-{
-  void* base;			//!< base mmaped ptr
-  uint64_t mmapsize;		//!< size of memory mapped region
-  int fd;			//!< file descriptor
-  hfile_header_t header;
-  hfile_chunk_t* files;
-} hfile_content_t;
-
-
-//! metainfo chunk
-PERSISTENT typedef struct hfile_meta_t
-{
-//  uint16_t type;		//!< HFILE_META_TYPE_*
-  uint16_t idx;			//!< index of metainfo name
-  uint16_t size;		//!< chunk size
-// uint8_t metadata[.size]
-} __attribute__ ((packed)) hfile_meta_t;
-
-
-//! individual file with name, attributes and metainfo
-PERSISTENT typedef struct hfile_item_t
-{
-  uint32_t magic2;
-  uint32_t size;			//!< chunk total size include this header
-  uint8_t flags;			//!< HFILE_FILE_FLAG_*
-  uint64_t content;			//!< pointer to content file
-  uint32_t name_idx;			//!< name index in dict
-  uint16_t meta_cnt;			//!< count of metainfo
-//  uint32_t uid,gid,mode;
-//  uint64_t atime,mtime;
-
-/*
-  hfile_meta_t[.meta_cnt];
-*/
-} __attribute__ ((packed)) hfile_item_t;
-
-
-//! index file
-typedef struct hfile_names_t
-{
-  void* base;				//!< base mmaped ptr
-  uint64_t mmapsize;			//!< size of memory mapped region
-  int fd;				//!< index file descriptor
-  hfile_header_t header;		//!< copy of header
-  hfile_item_t* items;			//!< pointer to first hfile_item
-} hfile_names_t;
-
-
-typedef struct hfile_t
-{
-  hfile_idx_t idx;
-  hfile_names_t names;
-  hfile_content_t content;
-  dict_t* meta_dict;
-  dict_t* names_dict;
-} hfile_t;
+#include "hfile_int.h"
+#include "bitmap.h"
+#include "prewarm.h"
+#include "hotkey.h"
+#include "order.h"
+#include "metrics.h"
+#include "cdc.h"
+#include "column.h"
+#include "pattern.h"
+#include "alias.h"
+#include "bpool.h"
 
 
 //! fill system metainformation about file (name,mime,uid,gid,mode,atime,mtime)
@@ -147,10 +44,14 @@ static int fill_system_info(const char* name,const char* source,char** array);
 static int update_checksum(const char* file);
 
 //! set file attributes based on metainfo/properties
-static void export_attrs(const dict_t* meta_dict,const char* new_name,void* meta_ptr,size_t meta_cnt);
+static void export_attrs(const hfile_t* h,const char* new_name,const hfile_item_t* item);
 
 //! open and mmap file
-static void* hfile_mmap_int(const char* name,uint64_t* size,int* pfd,hfile_header_t* header)
+//! madvise advice of HFILE_ADVICE_*
+static const int hfile_advice[]={MADV_RANDOM,MADV_NORMAL,MADV_SEQUENTIAL,MADV_WILLNEED};
+
+//! map file of kind HFILE_FILE_* with options of opt
+static void* hfile_mmap_int(const char* name,uint64_t* size,int* pfd,hfile_header_t* header,const hfile_open_opt_t* opt,uint32_t file)
 {
   struct stat st;
 
@@ -170,9 +71,16 @@ static void* hfile_mmap_int(const char* name,uint64_t* size,int* pfd,hfile_heade
   }
   *size=st.st_size;
 
-  void* rv=mmap(0,st.st_size,PROT_READ,MAP_PRIVATE | HFILE_USE_HUGEPAGES,fd,0);
+  void* rv=mmap(0,st.st_size,PROT_READ,MAP_PRIVATE | HUGEPAGE | (opt->populate & (1U<<file) ? MAP_POPULATE : 0),fd,0);
   if(rv==(void*)-1) goto err;
-  madvise(rv, st.st_size, MADV_DONTDUMP | MADV_RANDOM);
+  madvise(rv,st.st_size,MADV_DONTDUMP);
+  if(opt->advice[file]<sizeof(hfile_advice)/sizeof(hfile_advice[0]))
+    madvise(rv,st.st_size,hfile_advice[opt->advice[file]]);
+// willneed reads ahead, lookups stay random
+  if(opt->advice[file]==HFILE_ADVICE_WILLNEED)
+    madvise(rv,st.st_size,MADV_RANDOM);
+  if((opt->lock & (1U<<file)) && mlock(rv,st.st_size))
+    log("can not lock %s in memory: %s",name,strerror(errno));
 
   memcpy(header,rv,sizeof(*header));
 
@@ -191,6 +99,7 @@ static void* hfile_mmap_int(const char* name,uint64_t* size,int* pfd,hfile_heade
   }
 
 #if HFILE_CHECKSUM_ONOPEN
+  if(!opt->noverify)
   {
     checksum_t* cs=checksum_init();
     uint8_t checksum[CHECKSUM_SIZE]; memset(checksum,0,CHECKSUM_SIZE);
@@ -224,6 +133,11 @@ typedef struct names_t
   char* idx_name;
   char* content_name;
   char* names_name;
+  char* hot_name;
+  char* pidx_name;
+  char* values_name;
+  char* cols_name;
+  char* alias_name;
 } names_t;
 
 
@@ -237,6 +151,11 @@ static names_t* names_init(const char* folder)
   asprintf(&rv->idx_name,"%s/data.idx",folder);
   asprintf(&rv->content_name,"%s/data.content",folder);
   asprintf(&rv->names_name,"%s/names.content",folder);
+  asprintf(&rv->hot_name,"%s/data.hot",folder);
+  asprintf(&rv->pidx_name,"%s/data.pidx",folder);
+  asprintf(&rv->values_name,"%s/values.content",folder);
+  asprintf(&rv->cols_name,"%s/data.cols",folder);
+  asprintf(&rv->alias_name,"%s/data.alias",folder);
 
   return rv;
 }
@@ -249,20 +168,131 @@ static void names_free(struct names_t* n)
   free(n->idx_name);
   free(n->content_name);
   free(n->names_name);
+  free(n->hot_name);
+  free(n->pidx_name);
+  free(n->values_name);
+  free(n->cols_name);
+  free(n->alias_name);
   free(n);
 }
 
 
 hfile_t* hfile_open(const char* base)
+{
+  return hfile_open_ex(base,0);
+}
+
+//! size with optional k/m/g suffix
+static uint64_t hfile_size_parse(const char* val)
+{
+  char* e=0;
+  double rv=strtod(val,&e);
+  switch(e ? tolower(*e) : 0)
+  {
+    case 'g': rv*=1024;	// fall through
+    case 'm': rv*=1024;	// fall through
+    case 'k': rv*=1024;
+  }
+  return rv>0 ? rv : 0;
+}
+
+//! HFILE_FILE_* of l bytes long name, -1 if unknown
+static int hfile_file_parse(const char* name,size_t l)
+{
+  static const char* files[HFILE_FILES]={"idx","names","content"};
+  for(int i=0;i<HFILE_FILES;i++)
+    if(l==strlen(files[i]) && !memcmp(name,files[i],l))  return i;
+  return -1;
+}
+
+//! HFILE_ADVICE_* by name, -1 if unknown
+static int hfile_advice_parse(const char* val)
+{
+  static const char* advices[]={"random","normal","sequential","willneed"};
+  for(int i=0;i<sizeof(advices)/sizeof(advices[0]);i++)
+    if(!strcmp(val,advices[i]))  return i;
+  return -1;
+}
+
+//! comma separated files, "dict" or "all" to bits. return 0 on success
+static int hfile_files_parse(const char* val,uint32_t* mask)
+{
+  *mask=0;
+  while(*val)
+  {
+    size_t l=strcspn(val,",");
+    int file=hfile_file_parse(val,l);
+    if(file>=0)
+      *mask|=1U<<file;
+    else if(l==4 && !memcmp(val,"dict",4))
+      *mask|=HFILE_LOCK_DICT;
+    else if(l==3 && !memcmp(val,"all",3))
+      *mask|=(1U<<HFILE_FILES)-1 | HFILE_LOCK_DICT;
+    else if(!(l==1 && *val=='0'))
+    {
+      log("unknown file <%.*s>, expected idx, names, content, dict or all",(int)l,val);
+      return -1;
+    }
+    val+=l+!!val[l];
+  }
+  return 0;
+}
+
+int hfile_open_opt_set(hfile_open_opt_t* opt,const char* option)
+{
+  if(!opt || !option)  return -1;
+  const char* val=strchr(option,'=');
+  size_t l=val ? val-option : strlen(option);
+  if(val)  val++;
+
+#define OPT_IS(x_)	(l==strlen(x_) && !memcmp(option,x_,l))
+  if(OPT_IS("names_budget") && val)
+    opt->names_budget=hfile_size_parse(val);
+  else if(OPT_IS("pool") && val)
+    opt->pool=hfile_size_parse(val);
+  else if(OPT_IS("pool_page") && val)
+    opt->pool_page=hfile_size_parse(val);
+  else if(l>7 && !memcmp(option+l-7,"_advice",7) && val)
+  {
+    int file=hfile_file_parse(option,l-7);
+    int advice=hfile_advice_parse(val);
+    if(file<0 || advice<0)
+    {
+      log("bad advice option <%s>",option);
+      return -1;
+    }
+    opt->advice[file]=advice;
+  }
+  else if(OPT_IS("populate") && val)
+    return hfile_files_parse(val,&opt->populate);
+  else if(OPT_IS("mlock") && val)
+    return hfile_files_parse(val,&opt->lock);
+  else if(OPT_IS("hugepages") && val)
+    opt->hugepages=atoi(val);
+  else if(OPT_IS("verify") && val)
+    opt->noverify=!atoi(val);
+  else
+  {
+    log("unknown open option <%s>",option);
+    return -1;
+  }
+#undef OPT_IS
+  return 0;
+}
+
+hfile_t* hfile_open_ex(const char* base,const hfile_open_opt_t* opt)
 {
   if(!base || !*base)  return 0;
+  hfile_open_opt_t noopt={0,};
+  if(!opt)  opt=&noopt;
 
   names_t* n=names_init(base);
   if(!n)  return 0;
 
   hfile_t* rv=0;
-  dict_t* meta_dict=dict_load(n->mhash_name);
-  dict_t* names_dict=dict_load(n->nhash_name);
+  uint32_t dflags=(opt->hugepages ? DICT_LOAD_HUGEPAGES : 0) | (opt->lock & HFILE_LOCK_DICT ? DICT_LOAD_MLOCK : 0);
+  dict_t* meta_dict=dict_load_ex(n->mhash_name,0,dflags);
+  dict_t* names_dict=dict_load_ex(n->nhash_name,opt->names_budget,dflags);
   if(!meta_dict || !names_dict)
   {
     log("hash load error");
@@ -273,10 +303,32 @@ hfile_t* hfile_open(const char* base)
   rv=calloc(1,sizeof(*rv));
   rv->meta_dict=meta_dict;
   rv->names_dict=names_dict;
-
-  rv->idx.base=hfile_mmap_int(n->idx_name,&rv->idx.mmapsize,&rv->idx.fd,&rv->idx.header);
-  rv->names.base=hfile_mmap_int(n->names_name,&rv->names.mmapsize,&rv->names.fd,&rv->names.header);
-  rv->content.base=hfile_mmap_int(n->content_name,&rv->content.mmapsize,&rv->content.fd,&rv->content.header);
+  rv->name_meta=dict_get_str(meta_dict,"_name");
+
+  rv->idx.base=hfile_mmap_int(n->idx_name,&rv->idx.mmapsize,&rv->idx.fd,&rv->idx.header,opt,HFILE_FILE_IDX);
+  rv->names.base=hfile_mmap_int(n->names_name,&rv->names.mmapsize,&rv->names.fd,&rv->names.header,opt,HFILE_FILE_NAMES);
+  rv->content.base=hfile_mmap_int(n->content_name,&rv->content.mmapsize,&rv->content.fd,&rv->content.header,opt,HFILE_FILE_CONTENT);
+  rv->hot.fd=-1;
+  if(!access(n->hot_name,F_OK))
+    rv->hot.base=hfile_mmap_int(n->hot_name,&rv->hot.mmapsize,&rv->hot.fd,&rv->hot.header,opt,HFILE_FILE_IDX);
+  rv->pidx.fd=-1;
+  if(!access(n->pidx_name,F_OK))
+    rv->pidx.base=hfile_mmap_int(n->pidx_name,&rv->pidx.mmapsize,&rv->pidx.fd,&rv->pidx.header,opt,HFILE_FILE_IDX);
+  rv->cols.fd=-1;
+  if(!access(n->cols_name,F_OK))
+    rv->cols.base=hfile_mmap_int(n->cols_name,&rv->cols.mmapsize,&rv->cols.fd,&rv->cols.header,opt,HFILE_FILE_IDX);
+  rv->alias.fd=-1;
+  if(!access(n->alias_name,F_OK))
+    rv->alias.base=hfile_mmap_int(n->alias_name,&rv->alias.mmapsize,&rv->alias.fd,&rv->alias.header,opt,HFILE_FILE_IDX);
+  rv->values.fd=-1;
+  if(rv->names.base && (rv->names.header.version & HFILE_VERSION_VALUES))
+    rv->values.base=hfile_mmap_int(n->values_name,&rv->values.mmapsize,&rv->values.fd,&rv->values.header,opt,HFILE_FILE_NAMES);
+// mapping stays for tools and zero copy accessors, lookups copy through the pool
+  if(opt->pool && rv->content.base && !(rv->content.pool=bpool_init(n->content_name,opt->pool,opt->pool_page)))
+  {
+    names_free(n);
+    goto err;
+  }
 
   names_free(n);
 
@@ -285,6 +337,13 @@ hfile_t* hfile_open(const char* base)
     log("can not mmap data files, exiting");
     goto err;
   }
+// properties can not be decoded without their values
+  if((rv->names.header.version & HFILE_VERSION_VALUES) &&
+     (!rv->values.base || rv->values.mmapsize<HFILE_VALUES_STR(rv->values.header.chunks)))
+  {
+    log("can not load property values");
+    goto err;
+  }
 // simple consistency check here
   const char* muuid=dict_get_uuid(rv->meta_dict);
   const char* nuuid=dict_get_uuid(rv->names_dict);
@@ -292,7 +351,8 @@ hfile_t* hfile_open(const char* base)
       memcmp(muuid,nuuid,UUID_SIZE) ||
       memcmp(muuid,rv->names.header.uuid,UUID_SIZE) ||
       memcmp(muuid,rv->idx.header.uuid,UUID_SIZE) ||
-      memcmp(muuid,rv->content.header.uuid,UUID_SIZE)
+      memcmp(muuid,rv->content.header.uuid,UUID_SIZE) ||
+      (rv->values.base && memcmp(muuid,rv->values.header.uuid,UUID_SIZE))
     )
   {
     log("uuids are differ");
@@ -300,9 +360,93 @@ hfile_t* hfile_open(const char* base)
   }
 //  log("UUID is %s",rv->idx.header.uuid);
 
+  if(rv->hot.base && (memcmp(muuid,rv->hot.header.uuid,UUID_SIZE) || rv->hot.header.chunks!=rv->idx.header.chunks ||
+                      rv->hot.mmapsize<HFILE_HOT_OFFSET+rv->hot.header.chunks*sizeof(hfile_hot_t)))
+  {
+    log("hot records do not match database, ignored");
+    munmap(rv->hot.base,rv->hot.mmapsize);
+    close(rv->hot.fd);
+    rv->hot.base=0;
+    rv->hot.fd=-1;
+  }
+  if(rv->hot.base)
+    rv->hot.data=rv->hot.base+HFILE_HOT_OFFSET;
+
+  if(rv->pidx.base)
+  {
+    const hfile_pidx_header_t* ph=rv->pidx.base+sizeof(hfile_header_t);
+    if(memcmp(muuid,rv->pidx.header.uuid,UUID_SIZE) || rv->pidx.header.chunks!=rv->idx.header.chunks ||
+       rv->pidx.mmapsize<HFILE_PIDX_OFFSET || !ph->content_bits || ph->content_bits>HFILE_PIDX_MAXBITS ||
+       !ph->name_bits || ph->name_bits>HFILE_PIDX_MAXBITS ||
+       rv->pidx.mmapsize<HFILE_PIDX_OFFSET+HFILE_PIDX_BYTES(rv->pidx.header.chunks,ph->content_bits+ph->name_bits))
+    {
+      log("packed index does not match database, ignored");
+      munmap(rv->pidx.base,rv->pidx.mmapsize);
+      close(rv->pidx.fd);
+      rv->pidx.base=0;
+      rv->pidx.fd=-1;
+    }
+    else
+    {
+      rv->pidx.content_bits=ph->content_bits;
+      rv->pidx.name_bits=ph->name_bits;
+      rv->pidx.data=rv->pidx.base+HFILE_PIDX_OFFSET;
+    }
+  }
+
+  if(rv->cols.base)
+  {
+    const hfile_cols_header_t* ch=rv->cols.base+sizeof(hfile_header_t);
+    const hfile_column_t* dir=(const void*)(ch+1);
+    int ok=!memcmp(muuid,rv->cols.header.uuid,UUID_SIZE) && rv->cols.header.chunks==rv->idx.header.chunks &&
+           rv->cols.mmapsize>=sizeof(hfile_header_t)+sizeof(*ch) &&
+           rv->cols.mmapsize>=sizeof(hfile_header_t)+sizeof(*ch)+(uint64_t)ch->count*sizeof(*dir);
+    for(uint32_t i=0;ok && i<ch->count;i++)
+      ok=(dir[i].type==COLUMN_I64 || dir[i].type==COLUMN_F64) && dir[i].offset%sizeof(uint64_t)==0 &&
+         dir[i].offset+(uint64_t)rv->cols.header.chunks*sizeof(uint64_t)<=rv->cols.mmapsize;
+    if(!ok)
+    {
+      log("numeric columns do not match database, ignored");
+      munmap(rv->cols.base,rv->cols.mmapsize);
+      close(rv->cols.fd);
+      rv->cols.base=0;
+      rv->cols.fd=-1;
+    }
+    else
+    {
+      rv->cols.count=ch->count;
+      rv->cols.dir=dir;
+    }
+  }
+
+  if(rv->alias.base)
+  {
+    const hfile_alias_header_t* info=rv->alias.base+sizeof(hfile_header_t);
+    if(memcmp(muuid,rv->alias.header.uuid,UUID_SIZE) || rv->alias.header.chunks!=rv->idx.header.chunks || !rv->alias.header.chunks ||
+       rv->alias.mmapsize<HFILE_ALIAS_OFFSET+(uint64_t)rv->alias.header.chunks*sizeof(alias_t) || !(info->total>0))
+    {
+      log("weighted sampler does not match database, ignored");
+      munmap(rv->alias.base,rv->alias.mmapsize);
+      close(rv->alias.fd);
+      rv->alias.base=0;
+      rv->alias.fd=-1;
+    }
+    else
+    {
+      rv->alias.info=info;
+      rv->alias.data=rv->alias.base+HFILE_ALIAS_OFFSET;
+    }
+  }
+
   rv->idx.data=rv->idx.base+sizeof(rv->idx.header);
   rv->names.items=rv->names.base+sizeof(rv->names.header);
   rv->content.files=rv->content.base+sizeof(rv->content.header);
+  if(rv->values.base)
+  {
+    rv->values.off=rv->values.base+HFILE_VALUES_OFFSET;
+    rv->values.sorted=(const void*)(rv->values.off+rv->values.header.chunks);
+    rv->values.str=rv->values.base+HFILE_VALUES_STR(rv->values.header.chunks);
+  }
 
 leave:
   return rv;
@@ -317,9 +461,12 @@ void hfile_free(hfile_t* h)
 {
   if(!h)  return;
 
+  prewarm_detach(h);
+  hotkey_detach(h);
   dict_free(h->meta_dict);
   dict_free(h->names_dict);
 
+  bpool_free(h->content.pool);
   if(h->content.base)  munmap(h->content.base,h->content.mmapsize);
   close(h->content.fd);
 
@@ -329,6 +476,21 @@ void hfile_free(hfile_t* h)
   if(h->names.base) munmap(h->names.base,h->names.mmapsize);
   close(h->names.fd);
 
+  if(h->hot.base) munmap(h->hot.base,h->hot.mmapsize);
+  if(h->hot.fd>=0)  close(h->hot.fd);
+
+  if(h->pidx.base) munmap(h->pidx.base,h->pidx.mmapsize);
+  if(h->pidx.fd>=0)  close(h->pidx.fd);
+
+  if(h->values.base) munmap(h->values.base,h->values.mmapsize);
+  if(h->values.fd>=0)  close(h->values.fd);
+
+  if(h->cols.base) munmap(h->cols.base,h->cols.mmapsize);
+  if(h->cols.fd>=0)  close(h->cols.fd);
+
+  if(h->alias.base) munmap(h->alias.base,h->alias.mmapsize);
+  if(h->alias.fd>=0)  close(h->alias.fd);
+
   free(h);
 }
 
@@ -345,6 +507,7 @@ typedef struct hfile_int_entry2_t
   uint8_t checksum[CHECKSUM_SIZE];
   uint64_t off;
   uint32_t sz;
+  uint8_t flags;			//!< hfile_chunk_t flags
 
   UT_hash_handle hh;
 } hfile_int_entry2_t;
@@ -364,7 +527,7 @@ static const char* meta_system[]=
 
 #define meta_system_count	(sizeof(meta_system)/sizeof(*meta_system))
 
-static dict_t* get_meta_dict(FILE *f,const char* uuid)
+static dict_t* get_meta_dict(FILE *f,const char* uuid,const dict_opt_t* dopt)
 {
   size_t meta_count=0;
   size_t z=0;
@@ -413,7 +576,7 @@ static dict_t* get_meta_dict(FILE *f,const char* uuid)
   for(r=root;r;r=r->hh.next)
     list[meta_count++]=r->name;
 
-  dict_t* ret=dict_init_strings(uuid,list,meta_count);
+  dict_t* ret=dict_init_strings_ex(uuid,list,meta_count,dopt);
   while(root)
   {
     r=root;
@@ -431,21 +594,506 @@ static dict_t* get_meta_dict(FILE *f,const char* uuid)
 
 
 int hfile_build(const char* result,const char* input,uint32_t flags)
+{
+  hfile_build_opt_t opt={flags,};
+  return hfile_build_ex(result,input,&opt);
+}
+
+
+int hfile_build_opt_set(hfile_build_opt_t* opt,const char* option)
+{
+  if(!opt || !option)  return -1;
+  const char* val=strchr(option,'=');
+  size_t l=val ? val-option : strlen(option);
+  if(val)  val++;
+
+#define OPT_IS(x_)	(l==strlen(x_) && !memcmp(option,x_,l))
+  if(OPT_IS("hot") && val)
+    opt->hot=val;
+  else if(OPT_IS("hotdb") && val)
+    opt->hot_db=val;
+  else if(OPT_IS("order") && val && !strcmp(val,"input"))
+    opt->order=HFILE_ORDER_INPUT;
+  else if(OPT_IS("order") && val && !strcmp(val,"hilbert"))
+    opt->order=HFILE_ORDER_HILBERT;
+  else if(OPT_IS("order") && val && !strcmp(val,"zorder"))
+    opt->order=HFILE_ORDER_ZORDER;
+  else if(OPT_IS("tiles") && val)
+    opt->tiles=val;
+  else if(OPT_IS("mph") && val && dict_algo_parse(val)>=0)
+    opt->mph=dict_algo_parse(val);
+  else if(OPT_IS("names") && val && !strcmp(val,"front"))
+    opt->dict_flags=(opt->dict_flags & ~DICT_FLAG_NONAMES) | DICT_FLAG_FRONT;
+  else if(OPT_IS("names") && val)
+    opt->dict_flags=atoi(val) ? opt->dict_flags & ~DICT_FLAG_NONAMES : opt->dict_flags | DICT_FLAG_NONAMES;
+  else if(OPT_IS("fingerprint") && val)
+    opt->dict_flags=atoi(val) ? opt->dict_flags | DICT_FLAG_FP16 : opt->dict_flags & ~DICT_FLAG_FP16;
+  else if(OPT_IS("records") && val)
+    opt->records=atoi(val);
+  else if(OPT_IS("packed_idx") && val)
+    opt->packed_idx=atoi(val);
+  else if(OPT_IS("values") && val)
+    opt->values=atoi(val);
+  else if(OPT_IS("columns") && val)
+    opt->columns=atoi(val);
+  else if(OPT_IS("sample") && val)
+    opt->sample=val;
+  else if(OPT_IS("cdc") && val)
+  {
+    uint64_t v=hfile_size_parse(val);
+    if(v>1 && (v<CDC_AVG_MIN || v>CDC_AVG_MAX))
+    {
+      log("average piece size must be in [%u,%u]",CDC_AVG_MIN,CDC_AVG_MAX);
+      return -1;
+    }
+    opt->cdc=v==1 ? CDC_AVG : v;
+  }
+  else if(OPT_IS("threads") && val)
+    opt->threads=atoi(val);
+  else if(OPT_IS("partition") && val)
+    opt->partition=strtod(val,0);
+  else if(OPT_IS("report") && val)
+    opt->report=val;
+  else if(OPT_IS("progress") && val)
+  {
+    int v=atoi(val);
+    opt->progress=v>0 ? v : -1;
+  }
+  else
+  {
+    log("unknown build option <%s>",option);
+    return -1;
+  }
+#undef OPT_IS
+  return 0;
+}
+
+
+//! bits to keep values up to v and all ones sentinel above them
+static uint32_t pidx_bits(uint64_t v)
+{
+  uint32_t rv=1;
+  while(rv<64 && (v+1)>>rv)  rv++;
+  return rv;
+}
+
+//! or value to bit position, counterpart of hfile_bits_get
+static void pidx_put(uint8_t* p,uint64_t pos,uint64_t v)
+{
+  uint64_t w;
+  memcpy(&w,p+pos/8,sizeof(w));
+  w|=v<<(pos%8);
+  memcpy(p+pos/8,&w,sizeof(w));
+}
+
+//! write packed copy of index
+static int build_pidx(const char* fn,const hfile_header_t* idx_header,const hfile_idx_item_t* idx)
+{
+  size_t cnt=idx_header->chunks;
+  uint64_t cmax=0,nmax=0;
+  for(size_t i=0;i<cnt;i++)
+  {
+    if(idx[i].content_offset!=HFILE_NOT_FOUND && idx[i].content_offset>cmax)  cmax=idx[i].content_offset;
+    if(idx[i].name_offset!=HFILE_NOT_FOUND && idx[i].name_offset>nmax)  nmax=idx[i].name_offset;
+  }
+
+  hfile_pidx_header_t ph={pidx_bits(cmax),pidx_bits(nmax),};
+  if(ph.content_bits>HFILE_PIDX_MAXBITS || ph.name_bits>HFILE_PIDX_MAXBITS)
+  {
+    log("offsets are too big for packed index");
+    return -1;
+  }
+
+  uint32_t bits=ph.content_bits+ph.name_bits;
+  uint64_t bytes=HFILE_PIDX_BYTES(cnt,bits);
+  uint8_t* data=calloc(1,bytes);
+  for(size_t i=0;i<cnt;i++)
+  {
+    uint64_t c=idx[i].content_offset==HFILE_NOT_FOUND ? (1ULL<<ph.content_bits)-1 : idx[i].content_offset;
+    uint64_t n=idx[i].name_offset==HFILE_NOT_FOUND ? (1ULL<<ph.name_bits)-1 : idx[i].name_offset;
+    pidx_put(data,i*bits,c);
+    pidx_put(data,i*bits+ph.content_bits,n);
+  }
+
+  hfile_header_t header=*idx_header;
+  header.size=HFILE_PIDX_OFFSET+bytes;
+  checksum_t* cs=checksum_init();
+  checksum_update(cs,(void*)&ph,sizeof(ph));
+  checksum_update(cs,data,bytes);
+  checksum_finalize(cs,header.checksum);
+
+  FILE* f=fopen(fn,"w");
+  int rv=!f || fwrite(&header,sizeof(header),1,f)!=1 || fwrite(&ph,sizeof(ph),1,f)!=1 || fwrite(data,1,bytes,f)!=bytes;
+  if(f && fclose(f))  rv=1;
+  if(rv)  log("can not write packed index <%s>: %s",fn,strerror(errno));
+  free(data);
+  return rv ? -1 : 0;
+}
+
+//! write content split to pieces, new pieces are added to root2 and followed by chunk list.
+//! return count of chunks written, offset of chunk list in off
+static size_t build_pieces(FILE* fcontent,hfile_int_entry2_t** root2,const cdc_t* cdc,const uint8_t* ptr,size_t size,
+                           const uint8_t* checksum,metrics_t* mt,uint64_t* off)
+{
+  size_t rv=0,cnt=0,max=0,hits=0;
+  uint64_t dup=0;
+  hfile_piece_t* list=0;
+  hfile_chunk_t chunk;
+  chunk.magic2=MAGIC2;
+
+  for(size_t pos=0;pos<size;)
+  {
+    size_t len=cdc_cut(cdc,ptr+pos,size-pos);
+    uint8_t cs[CHECKSUM_SIZE];
+    checksum_t* c=checksum_init();
+    checksum_update(c,(void*)ptr+pos,len);
+    checksum_finalize(c,cs);
+
+    hfile_int_entry2_t* r2=0;
+    HASH_FIND(hh,*root2,cs,sizeof(cs),r2);
+    if(!r2)
+    {
+      r2=md_new(r2);
+      r2->off=ftell(fcontent);
+      r2->sz=len;
+      memcpy(r2->checksum,cs,sizeof(r2->checksum));
+      HASH_ADD_KEYPTR(hh,*root2,r2->checksum,sizeof(r2->checksum),r2);
+
+      chunk.size=len;
+      chunk.flags=0;
+      memcpy(chunk.checksum,cs,sizeof(chunk.checksum));
+      fwrite(&chunk,sizeof(chunk),1,fcontent);
+      fwrite(ptr+pos,len,1,fcontent);
+      rv++;
+    }
+    else
+    {
+      hits++;
+      dup+=len;
+    }
+
+    if(cnt==max)
+    {
+      max=max ? 2*max : 64;
+      list=md_realloc(list,max*sizeof(*list));
+    }
+    list[cnt].offset=r2->off;
+    list[cnt++].size=len;
+    pos+=len;
+  }
+
+  *off=ftell(fcontent);
+  chunk.size=cnt*sizeof(*list);
+  chunk.flags=HFILE_CHUNK_LIST;
+  memcpy(chunk.checksum,checksum,sizeof(chunk.checksum));
+  fwrite(&chunk,sizeof(chunk),1,fcontent);
+  fwrite(list,sizeof(*list),cnt,fcontent);
+  free(list);
+
+  metrics_pieces(mt,cnt,hits,dup);
+  return rv+1;
+}
+
+//! property value of pool under construction
+typedef struct hfile_int_value_t
+{
+  const char* str;
+  uint32_t id;
+  UT_hash_handle hh;
+} hfile_int_value_t;
+
+//! property values pool under construction
+typedef struct values_build_t
+{
+  hfile_int_value_t* root;		//!< value to id
+  hfile_int_value_t** val;		//!< values by id
+  size_t cnt;
+  size_t max;
+  uint64_t bytes;			//!< sum of value sizes include NUL
+  uint64_t* seen;			//!< values seen by property index
+  uint64_t* added;			//!< values added to pool by property index
+  size_t metas;
+  uint32_t name_meta;			//!< _name is unique, always inline
+} values_build_t;
+
+//! values of property seen before high cardinality check
+#define HFILE_VALUES_PROBE	1024
+
+static values_build_t* values_build_init(size_t metas,uint32_t name_meta)
+{
+  values_build_t* rv=md_new(rv);
+  rv->metas=metas;
+  rv->name_meta=name_meta;
+  rv->seen=md_tcalloc(uint64_t,metas+1);
+  rv->added=md_tcalloc(uint64_t,metas+1);
+  return rv;
+}
+
+static void values_build_free(values_build_t* vb)
+{
+  if(!vb)  return;
+  for(size_t i=0;i<vb->cnt;i++)
+  {
+    HASH_DELETE(hh,vb->root,vb->val[i]);
+    free((char*)vb->val[i]->str);
+    free(vb->val[i]);
+  }
+  free(vb->val);
+  free(vb->seen);
+  free(vb->added);
+  free(vb);
+}
+
+//! id of value, new values are added to pool unless property turned out to be of high cardinality
+static uint32_t values_build_id(values_build_t* vb,uint32_t idx,const char* val)
+{
+  if(idx==vb->name_meta || idx>=vb->metas)  return HFILE_VALUE_INLINE;
+
+  hfile_int_value_t* v=0;
+  HASH_FIND(hh,vb->root,val,strlen(val),v);
+  vb->seen[idx]++;
+  if(v)  return v->id;
+  if(vb->seen[idx]>HFILE_VALUES_PROBE && 2*vb->added[idx]>vb->seen[idx])  return HFILE_VALUE_INLINE;
+
+  if(vb->cnt==vb->max)
+  {
+    vb->max=vb->max ? 2*vb->max : 1024;
+    vb->val=md_realloc(vb->val,vb->max*sizeof(vb->val[0]));
+  }
+  v=md_new(v);
+  v->str=md_strdup(val);
+  v->id=vb->cnt;
+  vb->val[vb->cnt++]=v;
+  vb->bytes+=strlen(val)+1;
+  vb->added[idx]++;
+  HASH_ADD_KEYPTR(hh,vb->root,v->str,strlen(v->str),v);
+  return v->id;
+}
+
+//! append LEB128 varint, return position after it
+static uint8_t* values_varint_put(uint8_t* p,uint64_t v)
+{
+  while(v>=0x80)
+  {
+    *p++=v|0x80;
+    v>>=7;
+  }
+  *p++=v;
+  return p;
+}
+
+//! append property as varint pair, return position after it
+static uint8_t* values_put(values_build_t* vb,uint8_t* p,uint32_t idx,const char* val)
+{
+  if(idx==DICT_NOT_FOUND)  abort();
+  uint32_t id=values_build_id(vb,idx,val);
+  if(id==HFILE_VALUE_INLINE)
+    return (uint8_t*)stpcpy((char*)values_varint_put(p,(uint64_t)idx<<1 | 1),val)+1;
+  return values_varint_put(values_varint_put(p,(uint64_t)idx<<1),id);
+}
+
+static int values_cmp(const void* a,const void* b,void* arg)
+{
+  hfile_int_value_t** val=arg;
+  return strcmp(val[*(const uint32_t*)a]->str,val[*(const uint32_t*)b]->str);
+}
+
+//! write pool: header, padding, offsets, ids sorted by value, values
+static int values_build_save(const values_build_t* vb,const char* fn,const hfile_header_t* names_header)
+{
+  hfile_header_t header=*names_header;
+  header.version=HFILE_VERSION;
+  header.chunks=vb->cnt;
+  header.size=HFILE_VALUES_STR(vb->cnt)+vb->bytes;
+
+  uint64_t* off=md_tmalloc(uint64_t,vb->cnt+1);
+  uint32_t* sorted=md_tmalloc(uint32_t,vb->cnt+1);
+  uint64_t pos=0;
+  for(size_t i=0;i<vb->cnt;i++)
+  {
+    off[i]=pos;
+    pos+=strlen(vb->val[i]->str)+1;
+    sorted[i]=i;
+  }
+  qsort_r(sorted,vb->cnt,sizeof(sorted[0]),values_cmp,vb->val);
+
+  uint8_t pad[HFILE_VALUES_OFFSET-sizeof(hfile_header_t)];
+  memset(pad,0,sizeof(pad));
+  checksum_t* cs=checksum_init();
+  checksum_update(cs,pad,sizeof(pad));
+  checksum_update(cs,(void*)off,vb->cnt*sizeof(off[0]));
+  checksum_update(cs,(void*)sorted,vb->cnt*sizeof(sorted[0]));
+  for(size_t i=0;i<vb->cnt;i++)
+    checksum_update(cs,(void*)vb->val[i]->str,strlen(vb->val[i]->str)+1);
+  checksum_finalize(cs,header.checksum);
+
+  FILE* f=fopen(fn,"w");
+  int rv=!f || fwrite(&header,sizeof(header),1,f)!=1 || fwrite(pad,sizeof(pad),1,f)!=1 ||
+         fwrite(off,sizeof(off[0]),vb->cnt,f)!=vb->cnt ||
+         fwrite(sorted,sizeof(sorted[0]),vb->cnt,f)!=vb->cnt;
+  for(size_t i=0;!rv && i<vb->cnt;i++)
+    rv=fputs(vb->val[i]->str,f)<0 || fputc(0,f)<0;
+  if(f && fclose(f))  rv=1;
+  if(rv)  log("can not write property values <%s>: %s",fn,strerror(errno));
+  free(off);
+  free(sorted);
+  return rv ? -1 : 0;
+}
+
+//! placement order of filelist lines, 0 if input order is kept
+static order_t* build_order(FILE* f,const dict_t* names_dict,const hfile_build_opt_t* opt,size_t* hot_items,size_t* tiles)
+{
+  *hot_items=*tiles=0;
+  if(!opt->hot && opt->order==HFILE_ORDER_INPUT)  return 0;
+
+  uint64_t* hot=0;
+  if(opt->hot && !(hot=order_hotness(names_dict,opt->hot,opt->hot_db)))
+    return 0;
+
+  order_t* rv=order_init();
+  size_t z=0;
+  char *bf=0;
+
+  rewind(f);
+  for(;;)
+  {
+    uint64_t pos=ftello(f);
+    if(getline(&bf,&z,f)<0)  break;
+    if(strchr("\t\n\r\f\b ",*bf) || !*bf)
+      continue;
+    utils_line_t* str=utils_line_parse(bf);
+    if(!str)  continue;
+    uint32_t idx=dict_get_str(names_dict,str->name);
+    uint64_t cnt=(!hot || idx==DICT_NOT_FOUND) ? 0 : hot[idx];
+    if(cnt)  (*hot_items)++;
+    uint32_t zoom;
+    uint64_t curve;
+    if(!order_spatial(opt->order,opt->tiles,str,&zoom,&curve))  (*tiles)++;
+    order_add(rv,pos,cnt,zoom,curve);
+    utils_line_free(str);
+  }
+
+  order_sort(rv);
+  free(bf);
+  free(hot);
+  return rv;
+}
+
+//! write weighted sampler: header, description, alias table by name index
+static int alias_save(const char* fn,const hfile_header_t* idx_header,const double* weight,uint32_t meta)
+{
+  size_t n=idx_header->chunks;
+  size_t size=HFILE_ALIAS_OFFSET+n*sizeof(alias_t);
+  void* bf=md_calloc(size);
+  hfile_header_t* header=bf;
+  hfile_alias_header_t* info=bf+sizeof(hfile_header_t);
+
+  *header=*idx_header;
+  header->size=size;
+  info->meta=meta;
+  info->total=alias_build(weight,n,bf+HFILE_ALIAS_OFFSET);
+  for(size_t i=0;i<n;i++)
+    if(isfinite(weight[i]) && weight[i]>0)  info->weighted++;
+  if(!(info->total>0))
+  {
+    log("no positive weights to sample by");
+    free(bf);
+    return -1;
+  }
+
+  checksum_t* cs=checksum_init();
+  checksum_update(cs,bf+sizeof(hfile_header_t),size-sizeof(hfile_header_t));
+  checksum_finalize(cs,header->checksum);
+
+  FILE* f=fopen(fn,"w");
+  int rv=!f || fwrite(bf,size,1,f)!=1;
+  if(f && fclose(f))  rv=1;
+  if(rv)  log("can not write weighted sampler <%s>: %s",fn,strerror(errno));
+  else  log("weighted sampler created, %u of %zu names weighted, total weight %g",info->weighted,n,info->total);
+  free(bf);
+  return rv ? -1 : 0;
+}
+
+//! column type by meta index of properties with numeric values in every line having them. return count of numeric properties
+static size_t build_column_types(FILE* f,const dict_t* meta_dict,uint32_t* type)
+{
+  size_t metas=dict_get_size(meta_dict);
+  uint8_t* seen=md_tcalloc(uint8_t,metas);
+  for(size_t i=0;i<metas;i++)
+    type[i]=COLUMN_I64;
+
+  size_t z=0;
+  char *bf=0;
+  rewind(f);
+  while(getline(&bf,&z,f)>=0)
+  {
+    if(strchr("\t\n\r\f\b ",*bf) || !*bf)
+      continue;
+    utils_line_t* str=utils_line_parse(bf);
+    if(!str)  continue;
+    for(size_t i=0;i<str->metas;i++)
+    {
+      uint32_t m=dict_get_str(meta_dict,str->keys[i]);
+      if(m>=metas)  continue;
+      seen[m]=1;
+      type[m]=column_merge(type[m],column_type(str->vals[i]));
+    }
+    utils_line_free(str);
+  }
+  free(bf);
+
+  size_t rv=0;
+  for(size_t i=0;i<metas;i++)
+  {
+    if(!seen[i])  type[i]=COLUMN_NONE;
+    if(type[i]!=COLUMN_NONE)  rv++;
+  }
+  free(seen);
+  return rv;
+}
+
+
+int hfile_build_ex(const char* result,const char* input,const hfile_build_opt_t* opt)
 {
   if(!result || !input)  return -1;
 
+  hfile_build_opt_t noopt={0,};
+  if(!opt)  opt=&noopt;
+
+  cdc_t cdc;
+  if(opt->cdc && cdc_init(&cdc,opt->cdc))
+  {
+    log("invalid average piece size %u",opt->cdc);
+    return -1;
+  }
+
   mkdir(result,0777);
   int ret=-1;
   time_t tm=time(0);
+  hfile_int_entry2_t* root2=0;
+  values_build_t* vb=0;
+  uint8_t* enc=0;
+  size_t enc_max=0;
+  order_t* order=0;
+  size_t z=0;
+  char *bf=0;
 
   names_t* n=names_init(result);
   if(!n) return -1;
 
+  metrics_t* mt=metrics_init(opt->progress<0 ? 0 : opt->progress ? opt->progress : METRICS_PROGRESS);
+  metrics_phase_t* ph=metrics_phase(mt,"names_mph");
+  struct stat input_st;
+  if(stat(input,&input_st))  input_st.st_size=0;
+
   tic;tic;
-  dict_t* names_dict=dict_init_tsv(0,input);
+  metrics_begin(ph);
+  dict_opt_t dopt={.algo=opt->mph,.flags=opt->dict_flags,.threads=opt->threads,.partition=opt->partition};
+  dict_t* names_dict=dict_init_tsv_ex(0,input,&dopt);
 
   if(!names_dict)
   {
+    metrics_free(mt);
     names_free(n);
     log("something wrong with <%s>",input);
     utils_time_pop();
@@ -457,14 +1105,17 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
   {
     utils_time_pop();
     utils_time_pop();
-    names_free(n);
     log("can not save hash in <%s>",n->nhash_name);
+    names_free(n);
     dict_free(names_dict);
+    metrics_free(mt);
     return ret;
   }
 
   size_t total_items=dict_get_size(names_dict);
-  log("names hash created <%s>, total items %zu, time taken %s",n->nhash_name,total_items,toc);
+  metrics_end(ph,total_items,input_st.st_size);
+  log("names hash created <%s>, algorithm %s, total items %zu, %ju bytes, time taken %s",n->nhash_name,
+      dict_algo_name(opt->mph),total_items,(uintmax_t)dict_get_hash_bytes(names_dict),toc);
 
   FILE *f=fopen(input,"r");
 
@@ -472,22 +1123,46 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
   {
     log("cant open file <%s>",input);
     utils_time_pop();
+    metrics_free(mt);
     return ret;
   }
 
   tic;
-  dict_t* meta_dict=get_meta_dict(f,dict_get_uuid(names_dict));
+  metrics_begin(ph=metrics_phase(mt,"meta_dict"));
+  dict_t* meta_dict=get_meta_dict(f,dict_get_uuid(names_dict),&(dict_opt_t){.algo=opt->mph});
   if(!meta_dict)
   {
     log("cant generate perfect hash for metainfo/properties");
     utils_time_pop();
     utils_time_pop();
+    metrics_free(mt);
     return ret;
   }
 
   dict_save(meta_dict,n->mhash_name);
   size_t meta_count=dict_get_size(meta_dict);
+  metrics_end(ph,meta_count,input_st.st_size);
   log("props/meta names hash created <%s>, total items %zu, time taken %s",n->mhash_name,meta_count,toc);
+  if(opt->values)
+    vb=values_build_init(meta_count,dict_get_str(meta_dict,"_name"));
+
+  tic;
+  size_t hot_items=0,tiles=0;
+  if(opt->hot || opt->order!=HFILE_ORDER_INPUT)
+    metrics_begin(ph=metrics_phase(mt,"order"));
+  order=build_order(f,names_dict,opt,&hot_items,&tiles);
+  if(opt->hot || opt->order!=HFILE_ORDER_INPUT)
+    metrics_end(ph,order ? order->cnt : 0,0);
+  if(opt->hot && !order)
+  {
+    log("can not load access counts <%s>",opt->hot);
+    utils_time_pop();
+    goto err;
+  }
+  if(order)
+    log("placement order created, %zu hot items and %zu tiles of %zu, time taken %s",hot_items,tiles,order->cnt,toc);
+  else
+    utils_time_pop();
 
   tic;
   rewind(f);
@@ -503,6 +1178,90 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
     goto err;
   }
 
+// filled after hot records
+  size_t cols_size=0,cols_count=0;
+  void* cols_mem=MAP_FAILED;
+  int cols_fd=-1;
+  uint32_t* col_type=0;
+  void** col=0;
+  double* weight=0;
+  uint32_t sample_meta=DICT_NOT_FOUND;
+
+// hot records are laid out like index
+  size_t hot_size=opt->records ? HFILE_HOT_OFFSET+total_items*sizeof(hfile_hot_t) : 0;
+  void* hot_mem=MAP_FAILED;
+  int hot_fd=-1;
+  hfile_hot_t* hot=0;
+  if(opt->records)
+  {
+    hot_fd=open(n->hot_name,O_RDWR | O_CREAT | O_TRUNC,0644);
+    if(hot_fd<0 || posix_fallocate(hot_fd,0,hot_size) || (hot_mem=mmap(0,hot_size,PROT_READ | PROT_WRITE,MAP_SHARED,hot_fd,0)) == MAP_FAILED)
+    {
+      log("file creation error %s: %s",n->hot_name,strerror(errno));
+      goto err2;
+    }
+    hot=hot_mem+HFILE_HOT_OFFSET;
+    memset(hot,0,total_items*sizeof(hfile_hot_t));
+    for(size_t i=0;i<total_items;i++)
+      hot[i].content=HFILE_NOT_FOUND;
+  }
+  else
+    unlink(n->hot_name);
+
+// numeric columns, one cache line aligned array per property
+  if(opt->columns)
+  {
+    col_type=md_tcalloc(uint32_t,meta_count);
+    col=md_tcalloc(void*,meta_count);
+    cols_count=build_column_types(f,meta_dict,col_type);
+    rewind(f);
+    size_t col_size=(total_items*sizeof(uint64_t)+63) & ~(size_t)63;
+    size_t dir_end=sizeof(hfile_header_t)+sizeof(hfile_cols_header_t)+cols_count*sizeof(hfile_column_t);
+    cols_size=((dir_end+63) & ~(size_t)63)+cols_count*col_size;
+    cols_fd=open(n->cols_name,O_RDWR | O_CREAT | O_TRUNC,0644);
+    if(cols_fd<0 || posix_fallocate(cols_fd,0,cols_size) || (cols_mem=mmap(0,cols_size,PROT_READ | PROT_WRITE,MAP_SHARED,cols_fd,0)) == MAP_FAILED)
+    {
+      log("file creation error %s: %s",n->cols_name,strerror(errno));
+      goto err2;
+    }
+    hfile_cols_header_t* ch=cols_mem+sizeof(hfile_header_t);
+    hfile_column_t* dir=(void*)(ch+1);
+    ch->count=cols_count;
+    ch->reserved=0;
+    uint64_t off=(dir_end+63) & ~(size_t)63;
+    for(size_t i=0,c=0;i<meta_count;i++)
+    {
+      if(col_type[i]==COLUMN_NONE)  continue;
+      dir[c].meta=i;
+      dir[c].type=col_type[i];
+      dir[c].offset=off;
+      col[i]=cols_mem+off;
+// names without property keep absent value
+      for(size_t j=0;j<total_items;j++)
+        if(col_type[i]==COLUMN_I64)
+          ((int64_t*)col[i])[j]=COLUMN_I64_NULL;
+        else
+          ((double*)col[i])[j]=NAN;
+      off+=col_size;
+      c++;
+    }
+    log("%zu numeric property columns",cols_count);
+  }
+  else
+    unlink(n->cols_name);
+
+  if(opt->sample)
+  {
+    if((sample_meta=dict_get_str(meta_dict,opt->sample))==DICT_NOT_FOUND)
+    {
+      log("no property <%s> to sample by",opt->sample);
+      goto err2;
+    }
+    weight=md_tcalloc(double,total_items);
+  }
+  else
+    unlink(n->alias_name);
+
   hfile_header_t header_content,header_names;
   memset(&header_content,0,sizeof(header_content));
   memset(&header_names,0,sizeof(header_names));
@@ -513,12 +1272,23 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
 
   header_content.magic=header_names.magic=idx_header->magic=MAGIC;
   header_content.version=header_names.version=idx_header->version=HFILE_VERSION;
+  if(vb)  header_names.version|=HFILE_VERSION_VALUES;
   header_content.tm=header_names.tm=idx_header->tm=tm;
   memcpy(idx_header->uuid,dict_get_uuid(meta_dict),sizeof(idx_header->uuid));
   memcpy(header_names.uuid,dict_get_uuid(meta_dict),sizeof(header_names.uuid));
   memcpy(header_content.uuid,dict_get_uuid(meta_dict),sizeof(header_content.uuid));
   idx_header->size=idx_size;
   idx_header->chunks=total_items;
+  if(hot)
+  {
+    memcpy(hot_mem,idx_header,sizeof(hfile_header_t));
+    ((hfile_header_t*)hot_mem)->size=hot_size;
+  }
+  if(cols_mem!=MAP_FAILED)
+  {
+    memcpy(cols_mem,idx_header,sizeof(hfile_header_t));
+    ((hfile_header_t*)cols_mem)->size=cols_size;
+  }
 
   FILE* fname=fopen(n->names_name,"w");
   FILE* fcontent=fopen(n->content_name,"w");
@@ -533,17 +1303,28 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
   fwrite(&header_names,sizeof(header_names),1,fname);
   fwrite(&header_content,sizeof(header_content),1,fcontent);
 
-  hfile_int_entry2_t file,*r2,*root2=0;
+  hfile_int_entry2_t file,*r2;
   size_t name_count=0;
   size_t content_count=0;
+  size_t next=0;
+  uint64_t hot_content=0,hot_names=0;
+  metrics_phase_t* ph_stat=metrics_phase(mt,"stat");
+  metrics_phase_t* ph_sha1=metrics_phase(mt,"sha1");
+  metrics_phase_t* ph_write=metrics_phase(mt,"write");
 
 // calculate size and create memory mapped files
 
-  size_t z=0;
-  char *bf=0;
-
-  while(getline(&bf,&z,f)>=0)
+  metrics_begin(ph=metrics_phase(mt,"content"));
+  for(;;)
   {
+    metrics_progress(mt,mt->sources+mt->missing+mt->skipped,total_items,mt->bytes_in);
+
+    if(order)
+    {
+      if(next>=order->cnt)  break;
+      fseeko(f,order->data[next++].pos,SEEK_SET);
+    }
+    if(getline(&bf,&z,f)<0)  break;
     if(strchr("\t\n\r\f\b ",*bf) || !*bf)
       continue;
     utils_line_t* str=utils_line_parse(bf);
@@ -552,15 +1333,19 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
     void* fptr=0;
     int mfd=-1;
     file.sz=(uint32_t)-1;
+    uint64_t mark=metrics_now();
 
     {
       memset(&file,0,sizeof(file));
       struct stat st;
-      if(!stat(str->source,&st))
+      int found=!stat(str->source,&st);
+      if(found)
         mfd=open(str->source,O_RDONLY);
       if(mfd<0)
       {
-        log("skipping non existent file %s",str->source);
+        log("skipping %s file %s",found ? "unreadable" : "non existent",str->source);
+        if(found)  mt->skipped++;
+        else  mt->missing++;
         utils_line_free(str);
         continue;
       }
@@ -586,15 +1371,20 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
 
     if(file.sz==(uint32_t)-1)
     {
+      mt->skipped++;
       utils_line_free(str);
       continue;
     }
+    metrics_add(ph_stat,mark,1,0);
 
+    mark=metrics_now();
     {
       checksum_t* cs=checksum_init();
       checksum_update(cs,fptr,file.sz);
       checksum_finalize(cs,file.checksum);
     }
+    metrics_add(ph_sha1,mark,1,file.sz);
+    mark=metrics_now();
 
     uint64_t content_off=ftell(fcontent);
     uint64_t name_off=ftell(fname);
@@ -610,16 +1400,28 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
       r2->sz=file.sz;
       memcpy(r2->checksum,file.checksum,sizeof(r2->checksum));
       HASH_ADD_KEYPTR(hh,root2,r2->checksum,sizeof(r2->checksum),r2);
- 
-      hfile_chunk_t chunk;
-      chunk.magic2=MAGIC2;
-      chunk.size=r2->sz;
-      chunk.flags=0;
-      memcpy(chunk.checksum,file.checksum,sizeof(chunk.checksum));
-      fwrite(&chunk,sizeof(chunk),1,fcontent);
-      fwrite(fptr,r2->sz,1,fcontent);
-      content_count++;
+      metrics_source(mt,file.sz,1);
+
+// whole content is not known, look for known pieces of big file
+      if(opt->cdc && file.sz>cdc.max)
+      {
+        r2->flags=HFILE_CHUNK_LIST;
+        content_count+=build_pieces(fcontent,&root2,&cdc,fptr,file.sz,file.checksum,mt,&r2->off);
+      }
+      else
+      {
+        hfile_chunk_t chunk;
+        chunk.magic2=MAGIC2;
+        chunk.size=r2->sz;
+        chunk.flags=0;
+        memcpy(chunk.checksum,file.checksum,sizeof(chunk.checksum));
+        fwrite(&chunk,sizeof(chunk),1,fcontent);
+        fwrite(fptr,r2->sz,1,fcontent);
+        content_count++;
+      }
     }
+    else
+      metrics_source(mt,file.sz,0);
 
     if(file.sz)  munmap(fptr,file.sz);
     close(mfd);
@@ -627,6 +1429,30 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
     idx[name_idx].content_offset=r2->off;
     idx[name_idx].name_offset=name_off;
 
+    if(hot)
+    {
+      hfile_hot_t* rec=hot+name_idx;
+      rec->content=r2->off+sizeof(hfile_chunk_t);
+      rec->size=r2->sz;
+      rec->flags=r2->flags & HFILE_CHUNK_LIST ? HFILE_FILE_FLAG_CHUNKED : 0;
+      rec->metas=str->metas>255 ? 255 : str->metas;
+      for(size_t i=0;i<str->metas && i<HFILE_HOT_METAS;i++)
+        rec->meta[i]=dict_get_str(meta_dict,str->keys[i]);
+    }
+
+    for(size_t i=0;col && i<str->metas;i++)
+    {
+      uint32_t m=dict_get_str(meta_dict,str->keys[i]);
+      if(m>=meta_count || !col[m])  continue;
+      if(col_type[m]==COLUMN_I64)
+        ((int64_t*)col[m])[name_idx]=strtoll(str->vals[i],0,10);
+      else
+        ((double*)col[m])[name_idx]=strtod(str->vals[i],0);
+    }
+    for(size_t i=0;weight && i<str->metas;i++)
+      if(!strcmp(str->keys[i],opt->sample))
+        weight[name_idx]=strtod(str->vals[i],0);
+
 // populate system info
     char* sysinfo[meta_system_count]={0,};
 
@@ -649,10 +1475,28 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
     for(size_t i=0;i<meta_system_count;i++)
       chunk.size+=sizeof(hfile_meta_t)+strlen(sysinfo[i])+1;
 
-    fwrite(&chunk,sizeof(chunk),1,fname);
+    if(vb)
+    {
+// varint pairs in the same order, pair takes at most twice of plain record
+      if(2*chunk.size>enc_max)
+        enc=md_realloc(enc,enc_max=2*chunk.size);
+      uint8_t* p=enc;
+      for(size_t i=0;i<meta_system_count;i++)
+      {
+        p=values_put(vb,p,dict_get_str(meta_dict,meta_system[i]),sysinfo[i]);
+        free(sysinfo[i]);
+      }
+      for(size_t i=0;i<str->metas;i++)
+        p=values_put(vb,p,dict_get_str(meta_dict,str->keys[i]),str->vals[i]);
+      chunk.size=p-enc;
+      fwrite(&chunk,sizeof(chunk),1,fname);
+      fwrite(enc,1,chunk.size,fname);
+    }
+    else
+      fwrite(&chunk,sizeof(chunk),1,fname);
 
     hfile_meta_t meta;
-    for(size_t i=0;i<meta_system_count;i++)
+    for(size_t i=0;!vb && i<meta_system_count;i++)
     {
       meta.idx=dict_get_str(meta_dict,meta_system[i]);
       if(meta.idx==DICT_NOT_FOUND)  abort();
@@ -663,7 +1507,7 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
       free(sysinfo[i]);
     }
 
-    for(size_t i=0;i<str->metas;i++)
+    for(size_t i=0;!vb && i<str->metas;i++)
     {
       meta.idx=dict_get_str(meta_dict,str->keys[i]);
       if(meta.idx==DICT_NOT_FOUND)  abort();
@@ -673,8 +1517,18 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
     }
     name_count++;
     utils_line_free(str);
+    metrics_add(ph_write,mark,1,ftell(fcontent)-content_off+ftell(fname)-name_off);
+
+    if(order && order->data[next-1].hot)
+    {
+      hot_content=ftell(fcontent);
+      hot_names=ftell(fname);
+    }
   }
 
+  if(order && hot_items)
+    log("hot set placed at the front: %ju bytes of content, %ju bytes of names",(uintmax_t)hot_content,(uintmax_t)hot_names);
+
   header_names.chunks=name_count;
   header_content.chunks=content_count;
 
@@ -685,9 +1539,11 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
 
   fclose(fname);
   fclose(fcontent);
+  metrics_end(ph,name_count,mt->bytes_in);
 
 
 //*************** update checksums
+  metrics_begin(ph=metrics_phase(mt,"checksum"));
   {
     checksum_t* cs=checksum_init();
     uint8_t checksum[CHECKSUM_SIZE]; 
@@ -697,14 +1553,58 @@ int hfile_build(const char* result,const char* input,uint32_t flags)
     memcpy(&idx_header->checksum,checksum,sizeof(idx_header->checksum));
     msync(idx_mem,idx_size,MS_SYNC);
   }
+  if(hot)
+  {
+    checksum_t* cs=checksum_init();
+    hfile_header_t* hot_header=hot_mem;
+    checksum_update(cs,hot_mem+sizeof(hfile_header_t),hot_size-sizeof(hfile_header_t));
+    checksum_finalize(cs,hot_header->checksum);
+    msync(hot_mem,hot_size,MS_SYNC);
+  }
+  if(cols_mem!=MAP_FAILED)
+  {
+    checksum_t* cs=checksum_init();
+    hfile_header_t* cols_header=cols_mem;
+    checksum_update(cs,cols_mem+sizeof(hfile_header_t),cols_size-sizeof(hfile_header_t));
+    checksum_finalize(cs,cols_header->checksum);
+    msync(cols_mem,cols_size,MS_SYNC);
+  }
+
+  if(opt->packed_idx && build_pidx(n->pidx_name,idx_header,idx))
+    goto err2;
+  if(!opt->packed_idx)
+    unlink(n->pidx_name);
+  if(vb && values_build_save(vb,n->values_name,&header_names))
+    goto err2;
+  if(!vb)
+    unlink(n->values_name);
+  if(weight && alias_save(n->alias_name,idx_header,weight,sample_meta))
+    goto err2;
 
   update_checksum(n->content_name);
   update_checksum(n->names_name);
+  {
+    struct stat st;
+    uint64_t sz=idx_size+hot_size+cols_size;
+    if(opt->packed_idx && !stat(n->pidx_name,&st))  sz+=st.st_size;
+    if(vb && !stat(n->values_name,&st))  sz+=st.st_size;
+    if(weight && !stat(n->alias_name,&st))  sz+=st.st_size;
+    if(!stat(n->content_name,&st))  sz+=st.st_size;
+    if(!stat(n->names_name,&st))  sz+=st.st_size;
+    metrics_end(ph,3,sz);
+  }
 
   ret=0;
 
 err2:
 
+  if(hot_mem!=MAP_FAILED)  munmap(hot_mem,hot_size);
+  if(hot_fd>=0)  close(hot_fd);
+  if(cols_mem!=MAP_FAILED)  munmap(cols_mem,cols_size);
+  if(cols_fd>=0)  close(cols_fd);
+  free(col_type);
+  free(col);
+  free(weight);
   munmap(idx_mem,idx_size);
   close(idx_fd);
 
@@ -716,8 +1616,17 @@ err:
     HASH_DELETE(hh,root2,r2);
     free(r2);
   }
+  if(vb)
+    log("property values pool: %zu values, %ju bytes",vb->cnt,(uintmax_t)vb->bytes);
+  values_build_free(vb);
+  free(enc);
   log("hfile archive creation %s, time taken %s",ret ? "failed" : "successfull", toc);
+  if(!ret)  metrics_print(mt);
+  if(opt->report && !metrics_save(mt,opt->report))
+    log("build report saved to <%s>",opt->report);
+  metrics_free(mt);
 
+  order_free(order);
   dict_free(names_dict);
   dict_free(meta_dict);
 
@@ -733,7 +1642,44 @@ ssize_t hfile_maxlen(const hfile_t* hf)
 }
 
 
+//! name of record, from names hash or from _name property if names are not kept
+static const char* hfile_item_name(const hfile_t* h,const hfile_item_t* item)
+{
+  const char* rv=dict_get_byidx(h->names_dict,item->name_idx);
+  if(rv || h->name_meta==DICT_NOT_FOUND)  return rv;
+
+  const void* meta_ptr=item+1;
+  hfile_prop_t prop;
+  for(size_t m=0;m<item->meta_cnt;m++)
+  {
+    meta_ptr=hfile_prop_next(h,meta_ptr,&prop);
+    if(prop.idx==h->name_meta)  return prop.val;
+  }
+  return 0;
+}
+
+
+//! write content of chunk, pieces of chunk list in order
+static int hfile_chunk_write(const hfile_t* h,const hfile_chunk_t* chunk,FILE* f)
+{
+  if(!(chunk->flags & HFILE_CHUNK_LIST))
+    return chunk->size && fwrite(chunk+1,1,chunk->size,f)!=chunk->size ? -1 : 0;
+
+  const hfile_piece_t* p=(const void*)(chunk+1);
+  for(size_t i=0;i<chunk->size/sizeof(*p);i++)
+  {
+    const hfile_chunk_t* piece=h->content.base+p[i].offset;
+    if(piece->magic2!=MAGIC2 || piece->size!=p[i].size || fwrite(piece+1,1,p[i].size,f)!=p[i].size)  return -1;
+  }
+  return 0;
+}
+
 int hfile_extract(hfile_t* h,const char* prefix,const char* regex,mode_t mode)
+{
+  return hfile_extract_ex(h,prefix,regex,0,mode);
+}
+
+int hfile_extract_ex(hfile_t* h,const char* prefix,const char* regex,const bitmap_t* filter,mode_t mode)
 {
   if(!h)  return -1;
   if(!mode) mode=0777;
@@ -757,17 +1703,23 @@ int hfile_extract(hfile_t* h,const char* prefix,const char* regex,mode_t mode)
 
 //  if(!list)  perror("creating source list");
 
-  hfile_idx_item_t* data=h->idx.data;
+  bitmap_t* sel=0;
+  if(regex && *regex)
+  {
+    sel=bitmap_init(h->idx.header.chunks);
+    log("%zd names match <%s>",hfile_glob(h,regex,sel),regex);
+  }
 
   for(size_t i=0;i<h->idx.header.chunks;i++)
   {
-    uint64_t name_offset=data[i].name_offset;
-    uint64_t content_offset=data[i].content_offset;
+    if(filter && !bitmap_test(filter,i) || sel && !bitmap_test(sel,i))  continue;
+    uint64_t name_offset=hfile_idx_name(h,i);
+    uint64_t content_offset=hfile_idx_content(h,i);
 
     if(name_offset==(uint64_t)(-1LL) || content_offset==(uint64_t)(-1LL))  continue;
     hfile_item_t* name=h->names.base+name_offset;
     if(name->flags)  continue;
-    const char* filename=dict_get_byidx(h->names_dict,name->name_idx);
+    const char* filename=hfile_item_name(h,name);
     uint32_t* magic2=(void*)name;
 
     if(!filename || *magic2!=MAGIC2 || i!=name->name_idx)
@@ -776,8 +1728,6 @@ int hfile_extract(hfile_t* h,const char* prefix,const char* regex,mode_t mode)
       continue;
     }
 
-    if(regex && *regex && fnmatch(regex,filename,FNM_EXTMATCH)==FNM_NOMATCH)  continue;
-
     hfile_chunk_t* chunk=h->content.base+content_offset;
     magic2=(void*)chunk;
     if(*magic2!=MAGIC2)
@@ -803,10 +1753,7 @@ int hfile_extract(hfile_t* h,const char* prefix,const char* regex,mode_t mode)
       continue;
     }
 
-    void* content=chunk+1;
-    size_t content_size=chunk->size;
-
-    if(content_size && fwrite(content,1,content_size,f)!=content_size)
+    if(hfile_chunk_write(h,chunk,f))
     {
       log("Can not write content for file %s",new_name);
       fclose(f);
@@ -816,23 +1763,23 @@ int hfile_extract(hfile_t* h,const char* prefix,const char* regex,mode_t mode)
     }
     fclose(f);
 
-    void* meta_ptr=name+1;
-    export_attrs(h->meta_dict,new_name,meta_ptr,name->meta_cnt);
+    export_attrs(h,new_name,name);
 
     fprintf(list,"%s\t:%s",filename,new_name);
+    const void* meta_ptr=name+1;
+    hfile_prop_t prop;
     for(size_t m=0;m<name->meta_cnt;m++)
     {
-      hfile_meta_t* meta=meta_ptr;
-      void* meta_val=meta+1;
-      const char* meta_name=dict_get_byidx(h->meta_dict,meta->idx);
-      meta_ptr=meta_val+meta->size;
+      meta_ptr=hfile_prop_next(h,meta_ptr,&prop);
+      const char* meta_name=dict_get_byidx(h->meta_dict,prop.idx);
       if(!meta_name || *meta_name=='_')  continue;
-      fprintf(list,"\t%s:%s",meta_name,(char*)meta_val);
+      fprintf(list,"\t%s:%s",meta_name,prop.val);
     }
     fprintf(list,"\n");
     free(new_name);
   }
 
+  bitmap_free(sel);
   fclose(list);
   return 0;
 }
@@ -850,8 +1797,113 @@ int hfile_integrity_check(const char* base)
   return !h;
 }
 
+//! counters of buffer pool, -1 without it
+int hfile_pool_stat(const hfile_t* h,bpool_stat_t* st)
+{
+  if(!h || !h->content.pool || !st)  return -1;
+  bpool_stat(h->content.pool,st);
+  return 0;
+}
+
+//! estimate of resident bytes of mapping, pages at stride are checked
+static uint64_t hfile_resident(const void* base,uint64_t size,uint64_t stride)
+{
+  if(!base || !size)  return 0;
+  size_t page=sysconf(_SC_PAGESIZE);
+  uint8_t vec[4096];
+  uint64_t hit=0,cnt=0;
+  if(stride<=page)
+  {
+    for(uint64_t off=0;off<size;off+=sizeof(vec)*page)
+    {
+      uint64_t len=size-off<sizeof(vec)*page ? size-off : sizeof(vec)*page;
+      if(mincore((void*)base+off,len,vec))  return 0;
+      for(size_t i=0;i<(len+page-1)/page;i++)
+        hit+=vec[i] & 1;
+      cnt+=(len+page-1)/page;
+    }
+  }
+  else
+  {
+    stride-=stride%page;
+    for(uint64_t off=0;off<size;off+=stride,cnt++)
+      if(!mincore((void*)base+off,1,vec))
+        hit+=vec[0] & 1;
+  }
+  uint64_t rv=cnt ? (double)size*hit/cnt : 0;
+  return rv>size ? size : rv;
+}
+
+//! set locked bytes of entries with mapped base from /proc/self/smaps
+static void hfile_locked(hfile_mem_t* m,const void** base,size_t cnt)
+{
+  FILE* f=fopen("/proc/self/smaps","r");
+  if(!f)  return;
+  char* line=0;
+  size_t z=0;
+  ssize_t cur=-1;
+  while(getline(&line,&z,f)>0)
+  {
+    uintptr_t from,to;
+    uint64_t kb;
+    if(sscanf(line,"%jx-%jx ",&from,&to)==2)
+    {
+      cur=-1;
+      for(size_t i=0;i<cnt;i++)
+        if(base[i] && (uintptr_t)base[i]==from)  cur=i;
+    }
+    else if(cur>=0 && sscanf(line,"Locked: %ju kB",&kb)==1)
+      m[cur].locked=kb*1024<m[cur].mapped ? kb*1024 : m[cur].mapped;
+  }
+  free(line);
+  fclose(f);
+}
+
+ssize_t hfile_mem(const hfile_t* h,uint64_t stride,hfile_mem_t* out,size_t max)
+{
+  if(!h || !out)  return -1;
+  const struct { const char* name; const void* base; uint64_t size; } files[]=
+  {
+    {"data.idx",h->idx.base,h->idx.mmapsize},
+    {"data.pidx",h->pidx.base,h->pidx.mmapsize},
+    {"data.hot",h->hot.base,h->hot.mmapsize},
+    {"names.content",h->names.base,h->names.mmapsize},
+    {"values.content",h->values.base,h->values.mmapsize},
+    {"data.cols",h->cols.base,h->cols.mmapsize},
+    {"data.alias",h->alias.base,h->alias.mmapsize},
+    {"data.content",h->content.base,h->content.mmapsize},
+  };
+  const void* base[HFILE_MEM_MAX];
+  size_t rv=0;
+  for(size_t i=0;i<sizeof(files)/sizeof(files[0]) && rv<max;i++)
+  {
+    if(!files[i].base)  continue;
+    out[rv]=(hfile_mem_t){.name=files[i].name,.mapped=files[i].size,.resident=hfile_resident(files[i].base,files[i].size,stride)};
+    base[rv++]=files[i].base;
+  }
+  if(h->content.pool)
+    for(size_t i=0;i<rv;i++)
+      if(base[i]==h->content.base)
+      {
+        bpool_stat_t ps;
+        bpool_stat(h->content.pool,&ps);
+        out[i].heap=ps.resident;
+      }
+  hfile_locked(out,base,rv);
+
+  const struct { const char* name; const dict_t* d; } dicts[]={{"names.hash",h->names_dict},{"meta.hash",h->meta_dict}};
+  for(size_t i=0;i<sizeof(dicts)/sizeof(dicts[0]) && rv<max;i++)
+    out[rv++]=(hfile_mem_t){.name=dicts[i].name,.locked=dict_get_locked(dicts[i].d),.heap=dict_get_bytes(dicts[i].d)};
+  return rv;
+}
+
 //! print base stat
 int hfile_stat(const hfile_t* h)
+{
+  return hfile_stat_ex(h,HFILE_MEM_STRIDE);
+}
+
+int hfile_stat_ex(const hfile_t* h,uint64_t stride)
 {
   if(!h)
   {
@@ -863,9 +1915,56 @@ int hfile_stat(const hfile_t* h)
   printf("Resident size: %lu\n",dict_get_bytes(h->names_dict)+dict_get_bytes(h->meta_dict));
   printf("Disk size: %lu\n",dict_get_bytes(h->names_dict)+dict_get_bytes(h->meta_dict)+h->idx.header.size+h->names.header.size+h->content.header.size);
   printf("Total names: %u\n",dict_get_size(h->names_dict));
+  printf("Names kept: %s\n",dict_get_flags(h->names_dict) & DICT_FLAG_NONAMES ? "no, fingerprints only" :
+         dict_get_flags(h->names_dict) & DICT_FLAG_FRONT ? "yes, front coded" : "yes");
+  printf("Names hash: %s, %.2f bits per name\n",dict_algo_name(dict_get_algo(h->names_dict)),
+         dict_get_size(h->names_dict) ? 8.0*dict_get_hash_bytes(h->names_dict)/dict_get_size(h->names_dict) : 0.0);
   printf("Valid names: %u\n",h->names.header.chunks);
+  printf("Hot records: %s\n",h->hot.base ? "yes" : "no");
+  if(h->pidx.base)
+    printf("Packed index: %u bits per name\n",h->pidx.content_bits+h->pidx.name_bits);
+  else
+    printf("Packed index: no\n");
+  if(h->values.base)
+    printf("Property values pool: %u values, %ju bytes\n",h->values.header.chunks,(uintmax_t)h->values.header.size);
+  else
+    printf("Property values pool: no\n");
+  printf("Numeric columns:");
+  for(uint32_t i=0;i<h->cols.count;i++)
+    printf(" %s(%s)",dict_get_byidx(h->meta_dict,h->cols.dir[i].meta),column_type_name(h->cols.dir[i].type));
+  printf("%s\n",h->cols.count ? "" : " no");
+  if(h->alias.info)
+    printf("Weighted sampler: by %s, %u names weighted, total weight %g\n",dict_get_byidx(h->meta_dict,h->alias.info->meta),
+           h->alias.info->weighted,h->alias.info->total);
+  else
+    printf("Weighted sampler: no\n");
+  if(h->content.pool)
+  {
+    bpool_stat_t ps;
+    bpool_stat(h->content.pool,&ps);
+    printf("Buffer pool: %ju bytes of %u byte pages, %s reads, %ju resident\n",(uintmax_t)ps.budget,ps.page,
+           ps.direct ? "direct" : "buffered",(uintmax_t)ps.resident);
+  }
   printf("Unique files: %u\n",h->content.header.chunks);
   printf("Distinct properties: %u\n",dict_get_size(h->meta_dict));
+
+  hfile_mem_t mem[HFILE_MEM_MAX];
+  ssize_t cnt=hfile_mem(h,stride,mem,HFILE_MEM_MAX);
+  hfile_mem_t sum={.name="total"};
+  if(stride<=(uint64_t)sysconf(_SC_PAGESIZE))
+    printf("Memory, resident counted per page:\n");
+  else
+    printf("Memory, resident sampled every %ju bytes:\n",(uintmax_t)stride);
+  printf("  %-16s%16s%16s%16s%16s\n","file","mapped","resident","locked","heap");
+  for(ssize_t i=0;i<=cnt;i++)
+  {
+    const hfile_mem_t* m=i<cnt ? mem+i : &sum;
+    printf("  %-16s%16ju%16ju%16ju%16ju\n",m->name,(uintmax_t)m->mapped,(uintmax_t)m->resident,(uintmax_t)m->locked,(uintmax_t)m->heap);
+    sum.mapped+=m->mapped;
+    sum.resident+=m->resident;
+    sum.locked+=m->locked;
+    sum.heap+=m->heap;
+  }
   printf("\n");
 
   return 0;
@@ -886,7 +1985,11 @@ ssize_t hfile_file_count(const hfile_t* h)
 
 const char* hfile_name_by_idx(const hfile_t* h,size_t idx)
 {
-  return h ? dict_get_byidx(h->names_dict,idx) : 0;
+  if(!h || idx>=h->idx.header.chunks)  return 0;
+  const char* rv=dict_get_byidx(h->names_dict,idx);
+  uint64_t off=hfile_idx_name(h,idx);
+  if(rv || off==HFILE_NOT_FOUND)  return rv;
+  return hfile_item_name(h,h->names.base+off);
 }
 
 ssize_t hfile_idx_by_name(const hfile_t* h,const char* name)
@@ -902,12 +2005,15 @@ const void* hfile_file_by_name(const hfile_t* h,const char* name,size_t* size)
   if(!h || !name || !*name)  return 0;
   ssize_t n=dict_get_str(h->names_dict,name);
   if(n<0 || n==DICT_NOT_FOUND)  return 0;
+  if(h->rec)  prewarm_mark(h->rec,n);
+  if(h->keys)  hotkey_mark(h->keys,n);
 
-  uint64_t off=h->idx.data[n].content_offset;
+  uint64_t off=hfile_idx_content(h,n);
   if(off==HFILE_NOT_FOUND)  return 0;
 
   void* ptr=h->content.base+off;
   hfile_chunk_t* chunk=ptr;
+  if(chunk->flags & HFILE_CHUNK_LIST)  return 0;
 
   *size=chunk->size-sizeof(hfile_chunk_t);
   return chunk+1;
@@ -965,23 +2071,24 @@ static int update_checksum(const char* file)
 }
 
 
-static void export_attrs(const dict_t* meta_dict,const char* new_name,void* meta_ptr,size_t meta_cnt)
+static void export_attrs(const hfile_t* h,const char* new_name,const hfile_item_t* item)
 {
   mode_t mode=0;
   struct utimbuf utm={0,0};
   uid_t uid=getuid();
   uid_t gid=getgid();
 
-  for(size_t i=0;i<meta_cnt;i++)
+  const void* meta_ptr=item+1;
+  hfile_prop_t prop;
+  for(size_t i=0;i<item->meta_cnt;i++)
   {
-    hfile_meta_t* meta=meta_ptr;
-    void* meta_val=meta+1;
-    const char* meta_name=dict_get_byidx(meta_dict,meta->idx);
-    meta_ptr=meta_val+meta->size;
+    meta_ptr=hfile_prop_next(h,meta_ptr,&prop);
+    const char* meta_name=dict_get_byidx(h->meta_dict,prop.idx);
+    const char* meta_val=prop.val;
 
     if(!meta_name)
     {
-      log("Invalid property %hd for %s",meta->idx,new_name);
+      log("Invalid property %u for %s",prop.idx,new_name);
       continue;
     }
 
@@ -1012,52 +2119,340 @@ void hfile_ret_free(hfile_ret_t* r)
   free(r);
 }
 
-static hfile_ret_t* hfile_get_int(const hfile_t* h,size_t n);
+static hfile_ret_t* hfile_get_int(const hfile_t* h,size_t n,int view);
 
 hfile_ret_t* hfile_get(const hfile_t* h,const char* name)
 {
   if(!h || !name || !*name)  return 0;
   ssize_t n=dict_get_str(h->names_dict,name);
   if(n<0 || n==DICT_NOT_FOUND)  return 0;
-  return hfile_get_int(h,n);
+  if(h->rec)  prewarm_mark(h->rec,n);
+  if(h->keys)  hotkey_mark(h->keys,n);
+  return hfile_get_int(h,n,0);
+}
+
+hfile_ret_t* hfile_get_view(const hfile_t* h,const char* name)
+{
+  if(!h || !name || !*name)  return 0;
+  ssize_t n=dict_get_str(h->names_dict,name);
+  if(n<0 || n==DICT_NOT_FOUND)  return 0;
+  if(h->rec)  prewarm_mark(h->rec,n);
+  if(h->keys)  hotkey_mark(h->keys,n);
+  return hfile_get_int(h,n,1);
+}
+
+int hfile_get_hot(const hfile_t* h,const char* name,hfile_hot_ret_t* ret)
+{
+  if(!h || !name || !*name || !ret)  return -1;
+  uint32_t n=dict_get_str(h->names_dict,name);
+  if(n==DICT_NOT_FOUND || n>=h->idx.header.chunks)  return -1;
+  if(h->rec)  prewarm_mark(h->rec,n);
+  if(h->keys)  hotkey_mark(h->keys,n);
+
+  if(h->hot.data)
+  {
+    const hfile_hot_t* rec=h->hot.data+n;
+    if(rec->content==HFILE_NOT_FOUND)  return -1;
+    ret->content=rec->flags & HFILE_FILE_FLAG_CHUNKED ? 0 : h->content.base+rec->content;
+    ret->size=rec->size;
+    ret->flags=rec->flags;
+    ret->metas=rec->metas;
+    memcpy(ret->meta,rec->meta,sizeof(ret->meta));
+    return 0;
+  }
+
+// no hot records, collect the same from index and item headers
+  uint64_t off=hfile_idx_content(h,n);
+  uint64_t off_name=hfile_idx_name(h,n);
+  if(off==HFILE_NOT_FOUND || off_name==HFILE_NOT_FOUND)  return -1;
+  const hfile_chunk_t* chunk=h->content.base+off;
+  const hfile_item_t* item=h->names.base+off_name;
+  if(item->magic2!=MAGIC2 || chunk->magic2!=MAGIC2)  return -1;
+
+  ret->content=chunk->flags & HFILE_CHUNK_LIST ? 0 : chunk+1;
+  ret->size=hfile_chunk_total(chunk);
+  ret->flags=item->flags | (chunk->flags & HFILE_CHUNK_LIST ? HFILE_FILE_FLAG_CHUNKED : 0);
+  ret->metas=0;
+// system properties are written first
+  const void* meta_ptr=item+1;
+  hfile_prop_t prop;
+  for(size_t m=0;m<item->meta_cnt;m++)
+  {
+    meta_ptr=hfile_prop_next(h,meta_ptr,&prop);
+    if(m>=meta_system_count)
+    {
+      if(ret->metas<HFILE_HOT_METAS)  ret->meta[ret->metas]=prop.idx;
+      if(ret->metas<255)  ret->metas++;
+    }
+  }
+  return 0;
+}
+
+const char* hfile_property_name(const hfile_t* h,uint32_t id)
+{
+  return h ? dict_get_byidx(h->meta_dict,id) : 0;
+}
+
+ssize_t hfile_value_count(const hfile_t* h)
+{
+  return h ? h->values.header.chunks : -1;
+}
+
+const char* hfile_value_by_idx(const hfile_t* h,uint32_t id)
+{
+  if(!h || id>=h->values.header.chunks)  return 0;
+  return h->values.str+h->values.off[id];
+}
+
+ssize_t hfile_idx_by_value(const hfile_t* h,const char* value)
+{
+  if(!h || !value)  return -1;
+  size_t lo=0,hi=h->values.header.chunks;
+  while(lo<hi)
+  {
+    size_t mid=(lo+hi)/2;
+    uint32_t id=h->values.sorted[mid];
+    int c=strcmp(h->values.str+h->values.off[id],value);
+    if(!c)  return id;
+    if(c<0)  lo=mid+1;
+    else  hi=mid;
+  }
+  return -1;
+}
+
+ssize_t hfile_column_count(const hfile_t* h)
+{
+  return h ? h->cols.count : -1;
+}
+
+int hfile_filter(const hfile_t* h,const char* expr,bitmap_t* out)
+{
+  if(!h || !expr || !out || out->bits<h->idx.header.chunks)  return -1;
+
+  size_t rows=h->cols.header.chunks;
+  char* bf=md_strdup(expr);
+  char* term=bf;
+  int rv=0,first=1;
+  while(term && !rv)
+  {
+    char* next=strstr(term,"&&");
+    if(next)
+    {
+      *next=0;
+      next+=2;
+    }
+    while(isspace(*term))  term++;
+    char* op=strpbrk(term,"=!<>");
+    uint32_t cmp=0;
+    size_t l=op ? column_op_parse(op,&cmp) : 0;
+    if(!l || op==term)
+    {
+      log("invalid predicate <%s>",term);
+      rv=-1;
+      break;
+    }
+    char* val=op+l;
+    for(char* e=op;e>term && isspace(e[-1]);)  *--e=0;
+    *op=0;
+    while(isspace(*val))  val++;
+    for(char* e=val+strlen(val);e>val && isspace(e[-1]);)  *--e=0;
+
+    uint32_t m=dict_get_str(h->meta_dict,term);
+    const hfile_column_t* c=0;
+    for(uint32_t i=0;m!=DICT_NOT_FOUND && i<h->cols.count;i++)
+      if(h->cols.dir[i].meta==m)  c=h->cols.dir+i;
+    column_range_t r;
+    if(!c || column_range(c->type,cmp,val,&r))
+    {
+      if(c)  log("invalid number <%s>",val);
+      else  log("no numeric column for property <%s>",term);
+      rv=-1;
+      break;
+    }
+    column_eval(c->type,h->cols.base+c->offset,rows,&r,out->data,!first);
+    first=0;
+    term=next;
+  }
+  free(bf);
+  if(rv)  return -1;
+
+// empty expression matches nothing, bits beyond columns are never set
+  size_t words=bitmap_words(out->bits);
+  if(first)  rows=0;
+  for(size_t w=rows/64;w<words;w++)
+    out->data[w]&=w==rows/64 ? (1ULL<<(rows%64))-1 : 0;
+  return 0;
+}
+
+//! glob scan target
+typedef struct hfile_glob_t
+{
+  const hfile_t* h;
+  bitmap_t* out;
+} hfile_glob_t;
+
+//! names pool string is its own key
+static void hfile_glob_pool(void* arg,const char* s,size_t len)
+{
+  hfile_glob_t* g=arg;
+  uint32_t n=dict_get_str(g->h->names_dict,s);
+  if(n!=DICT_NOT_FOUND)  bitmap_set(g->out,n);
+}
+
+static const char* hfile_glob_name(void* arg,size_t idx)
+{
+  return hfile_name_by_idx(((hfile_glob_t*)arg)->h,idx);
+}
+
+static void hfile_glob_idx(void* arg,size_t idx)
+{
+  bitmap_set(((hfile_glob_t*)arg)->out,idx);
 }
 
-static hfile_ret_t* hfile_get_int(const hfile_t* h,size_t n)
+ssize_t hfile_glob(const hfile_t* h,const char* glob,bitmap_t* out)
+{
+  if(!h || !out || out->bits<h->idx.header.chunks)  return -1;
+  pattern_t* p=pattern_init(glob);
+  if(!p)  return -1;
+
+  hfile_glob_t g={h,out};
+  ssize_t rv=0;
+  uint64_t size=0;
+  const char* pool=dict_get_pool(h->names_dict,&size);
+  if(pattern_exact(p))
+  {
+// plain name, hash lookup. names may be only fingerprints, compare
+    uint32_t n=dict_get_str(h->names_dict,p->lit[0]);
+    const char* name=n!=DICT_NOT_FOUND ? hfile_name_by_idx(h,n) : 0;
+    if((rv=name && !strcmp(name,p->lit[0])))
+      bitmap_set(out,n);
+  }
+  else if(pool)
+    rv=pattern_scan(p,pool,size,0,hfile_glob_pool,&g);
+  else
+    rv=pattern_scan_idx(p,h->idx.header.chunks,hfile_glob_name,0,hfile_glob_idx,&g);
+  pattern_free(p);
+  return rv;
+}
+
+int hfile_hash(const hfile_t* h,const char* name,uint64_t hash[2])
+{
+  if(!h || !name || !hash)  return -1;
+  dict_key_hash(h->names_dict,name,strlen(name),hash);
+  return 0;
+}
+
+hfile_ret_t* hfile_get_hash(const hfile_t* h,const uint64_t hash[2])
+{
+  if(!h || !hash)  return 0;
+  uint32_t n=dict_get_hash(h->names_dict,hash);
+  if(n==DICT_NOT_FOUND)  return 0;
+  if(h->rec)  prewarm_mark(h->rec,n);
+  if(h->keys)  hotkey_mark(h->keys,n);
+  return hfile_get_int(h,n,0);
+}
+
+//! result of name index, chunked content is assembled or, if view is set, returned as pieces
+static hfile_ret_t* hfile_get_int(const hfile_t* h,size_t n,int view)
 {
   if(!h || n>=h->idx.header.chunks)  return 0;
 
-  uint64_t off=h->idx.data[n].content_offset;
+  uint64_t off=hfile_idx_content(h,n);
   if(off==HFILE_NOT_FOUND)  return 0;
-  uint64_t off_name=h->idx.data[n].name_offset;
+  uint64_t off_name=hfile_idx_name(h,n);
   if(off_name==HFILE_NOT_FOUND)  return 0;
 
   void* ptr=h->content.base+off;
   hfile_chunk_t* chunk=ptr;
+  bpool_t* pool=h->content.pool;
+  hfile_chunk_t* head=0;
+// buffer pool: header with piece list is read to heap, content and checksum are copied to result
+  if(pool)
+  {
+    hfile_chunk_t c;
+    if(bpool_read(pool,off,&c,sizeof(c)) || c.magic2!=MAGIC2)  return 0;
+    size_t list=c.flags & HFILE_CHUNK_LIST ? c.size : 0;
+    head=malloc(sizeof(c)+list);
+    *head=c;
+    if(list && bpool_read(pool,off+sizeof(c),head+1,list))
+    {
+      free(head);
+      return 0;
+    }
+    chunk=head;
+    view=0;
+  }
 
   ptr=h->names.base+off_name;
   hfile_item_t* item=ptr;
-  if(item->magic2!=MAGIC2 || chunk->magic2!=MAGIC2)  return 0;
+  if(item->magic2!=MAGIC2 || chunk->magic2!=MAGIC2)
+  {
+    free(head);
+    return 0;
+  }
 
-  hfile_ret_t* ret=calloc(1,sizeof(*ret));
-  ret->name=dict_get_byidx(h->names_dict,n);
+  const char* name=hfile_item_name(h,item);
+  size_t pieces=chunk->flags & HFILE_CHUNK_LIST ? chunk->size/sizeof(hfile_piece_t) : 0;
+  size_t size=hfile_chunk_total(chunk);
+// pieces or assembled content and name living in thread local buffer of dict (front coded or on disk) are kept with result
+  size_t extra=pool ? size+CHECKSUM_SIZE : !pieces ? 0 : view ? pieces*sizeof(hfile_iov_t) : size;
+  size_t l=name && !dict_str_resident(h->names_dict) ? strlen(name)+1 : 0;
+  hfile_ret_t* ret=calloc(1,sizeof(*ret)+extra+l);
+  ret->name=l ? memcpy((void*)(ret+1)+extra,name,l) : name;
 
-  ret->size=chunk->size;
+  ret->size=size;
   ret->content=chunk+1;
   ret->checksum=chunk->checksum;
+  if(pool)
+  {
+    ret->content=ret+1;
+    ret->checksum=memcpy((void*)(ret+1)+size,chunk->checksum,CHECKSUM_SIZE);
+  }
+  int err=pool && !pieces && bpool_read(pool,off+sizeof(*chunk),ret+1,size);
+  if(pieces)
+  {
+    const hfile_piece_t* p=(const void*)(chunk+1);
+    hfile_iov_t* iov=(void*)(ret+1);
+    void* dst=ret+1;
+    for(size_t i=0;!err && i<pieces;i++)
+    {
+      const void* src=h->content.base+p[i].offset+sizeof(hfile_chunk_t);
+      if(view)
+      {
+        iov[i].base=src;
+        iov[i].len=p[i].size;
+      }
+      else if(pool)
+      {
+        err=bpool_read(pool,p[i].offset+sizeof(hfile_chunk_t),dst,p[i].size);
+        dst+=p[i].size;
+      }
+      else
+        dst=mempcpy(dst,src,p[i].size);
+    }
+    ret->content=view ? 0 : ret+1;
+    ret->pieces=view ? pieces : 0;
+    ret->piece=view ? iov : 0;
+  }
+  free(head);
+  if(err)
+  {
+    log("content read error of name index %zu",n);
+    free(ret);
+    return 0;
+  }
 
   ret->metas=item->meta_cnt;
   ret->keys=calloc(ret->metas,sizeof(char*));
   ret->vals=calloc(ret->metas,sizeof(char*));
 
-  void* meta=item+1;
-
+  const void* meta=item+1;
+  hfile_prop_t prop;
   for(size_t i=0;i<ret->metas;i++)
   {
-    hfile_meta_t* m=meta;
-    meta=m+1;
-    ret->keys[i]=dict_get_byidx(h->meta_dict,m->idx) ?: "--";
-    ret->vals[i]=meta;
-    meta+=m->size;
+    meta=hfile_prop_next(h,meta,&prop);
+    ret->keys[i]=dict_get_byidx(h->meta_dict,prop.idx) ?: "--";
+    ret->vals[i]=prop.val;
   }
 
   return ret;
@@ -1065,11 +2460,17 @@ static hfile_ret_t* hfile_get_int(const hfile_t* h,size_t n)
 
 
 hfile_it_t* hfile_it_init(const hfile_t* hf)
+{
+  return hfile_it_init_ex(hf,0);
+}
+
+hfile_it_t* hfile_it_init_ex(const hfile_t* hf,const bitmap_t* filter)
 {
   if(!hf)  return 0;
   hfile_it_t* rv=malloc(sizeof(*rv));
   rv->cur=0;
   rv->hf=hf;
+  rv->filter=filter;
   return rv;
 }
 
@@ -1091,25 +2492,115 @@ int hfile_it_rewind(hfile_it_t* it)
 hfile_ret_t* hfile_it_get(hfile_it_t* h)
 {
   if(!h)  return 0;
-  while(h->cur>=h->hf->idx.header.chunks)
+  while(h->cur<h->hf->idx.header.chunks)
   {
-    hfile_ret_t* ret=hfile_get_int(h->hf,h->cur++);
+    if(h->filter && !bitmap_test(h->filter,h->cur))
+    {
+      h->cur++;
+      continue;
+    }
+    hfile_ret_t* ret=hfile_get_int(h->hf,h->cur++,0);
     if(ret)  return ret;
   }
   return 0;
 }
 
 
+//! generator of thread for calls without one, seeded by time and its address
+static __thread hfile_rng_t hfile_rng_tls;
+static __thread int hfile_rng_tls_set;
+
+static hfile_rng_t* hfile_rng_default(void)
+{
+  if(!hfile_rng_tls_set)
+  {
+    struct timespec tm;
+    clock_gettime(CLOCK_MONOTONIC,&tm);
+    hfile_rng_seed(&hfile_rng_tls,(tm.tv_sec*1000000000ULL+tm.tv_nsec) ^ (uintptr_t)&hfile_rng_tls);
+    hfile_rng_tls_set=1;
+  }
+  return &hfile_rng_tls;
+}
+
 hfile_ret_t* hfile_get_rand_name(const hfile_t* h)
 {
-  if(!h)  return 0;
+  if(!h || !h->idx.header.chunks)  return 0;
+  hfile_rng_t* rng=hfile_rng_default();
   for(;;)
   {
-    hfile_ret_t* ret=hfile_get_int(h,rand()%h->idx.header.chunks);
+    uint32_t n=((unsigned __int128)alias_rng_next(rng->s)*h->idx.header.chunks)>>64;
+    hfile_ret_t* ret=hfile_get_int(h,n,0);
     if(ret)  return ret;
   }
 }
 
+void hfile_rng_seed(hfile_rng_t* rng,uint64_t seed)
+{
+  if(rng)  alias_rng_seed(rng->s,seed);
+}
+
+ssize_t hfile_sample_idx(const hfile_t* h,hfile_rng_t* rng)
+{
+  if(!h || !h->alias.data)  return -1;
+  if(!rng)  rng=hfile_rng_default();
+  return alias_draw(h->alias.data,h->alias.header.chunks,alias_rng_next(rng->s));
+}
+
+ssize_t hfile_sample_batch(const hfile_t* h,hfile_rng_t* rng,uint32_t* out,size_t cnt)
+{
+  if(!h || !h->alias.data || !out)  return -1;
+  if(!rng)  rng=hfile_rng_default();
+  const alias_t* t=h->alias.data;
+  uint32_t n=h->alias.header.chunks;
+  for(size_t i=0;i<cnt;i++)
+    out[i]=alias_draw(t,n,alias_rng_next(rng->s));
+  return cnt;
+}
+
+hfile_ret_t* hfile_sample(const hfile_t* h,hfile_rng_t* rng)
+{
+  ssize_t n=hfile_sample_idx(h,rng);
+  if(n<0)  return 0;
+  if(h->rec)  prewarm_mark(h->rec,n);
+  return hfile_get_int(h,n,0);
+}
+
+double hfile_sample_total(const hfile_t* h)
+{
+  return h && h->alias.info ? h->alias.info->total : 0;
+}
+
+
+//! read mapped region into page cache, touch every page to be sure
+static void prewarm_region(const void* base,uint64_t size)
+{
+  if(!base || !size)  return;
+  madvise((void*)base,size,MADV_WILLNEED);
+
+  size_t page=sysconf(_SC_PAGESIZE);
+  volatile uint8_t sum=0;
+  for(uint64_t i=0;i<size;i+=page)
+    sum+=((const uint8_t*)base)[i];
+}
+
+int hfile_prewarm(const hfile_t* h,uint32_t what)
+{
+  if(!h)  return -1;
+
+  tic;
+  if((what&HFILE_PREWARM_IDX) && h->pidx.base)
+    prewarm_region(h->pidx.base,h->pidx.mmapsize);
+  else if(what&HFILE_PREWARM_IDX)
+    prewarm_region(h->idx.base,h->idx.mmapsize);
+  if(what&HFILE_PREWARM_NAMES)
+    prewarm_region(h->names.base,h->names.mmapsize);
+  if(what&HFILE_PREWARM_CONTENT)
+    prewarm_region(h->content.base,h->content.mmapsize);
+  log("prewarm done, time taken %s",toc);
+
+  return 0;
+}
+
 
 static void dump_header(const hfile_header_t* h,FILE *f)
 {
@@ -1189,11 +2680,15 @@ int hfile_dump(const hfile_t* hf,const char* out)
       fprintf(f,"%zd\t[%zu]\t%08x\t%d\t%02hhx\t%ld\t%d\t%hu\t:",i,((void*)item)-(void*)hf->names.items,
                 item->magic2,item->size,item->flags,item->content,item->name_idx,item->meta_cnt);
 
-      hfile_meta_t* meta=(void*)(item+1);
+      const void* meta=item+1;
+      hfile_prop_t prop;
       for(size_t j=0;j<item->meta_cnt;j++)
       {
-        fprintf(f,"\t%hu[%hu]\t%s",meta->idx,meta->size,(char*)(meta+1));
-        meta=((void*)(meta+1))+meta->size;
+        meta=hfile_prop_next(hf,meta,&prop);
+        if(prop.id==HFILE_VALUE_INLINE)
+          fprintf(f,"\t%u[%zu]\t%s",prop.idx,strlen(prop.val)+1,prop.val);
+        else
+          fprintf(f,"\t%u[#%u]\t%s",prop.idx,prop.id,prop.val);
       }
       fprintf(f,"\n");
       item=((void*)(item+1))+item->size;
@@ -1243,6 +2738,11 @@ int hfile_dump(const hfile_t* hf,const char* out)
 }
 
 int hfile_genlist(const hfile_t* h,const char* out)
+{
+  return hfile_genlist_ex(h,out,0);
+}
+
+int hfile_genlist_ex(const hfile_t* h,const char* out,const bitmap_t* filter)
 {
   if(!h || !out || !*out)  return -1;
 
@@ -1250,17 +2750,16 @@ int hfile_genlist(const hfile_t* h,const char* out)
   if(!list)
     crash("can not create filelist");
 
-  hfile_idx_item_t* data=h->idx.data;
-
   for(size_t i=0;i<h->idx.header.chunks;i++)
   {
-    uint64_t name_offset=data[i].name_offset;
-    uint64_t content_offset=data[i].content_offset;
+    if(filter && !bitmap_test(filter,i))  continue;
+    uint64_t name_offset=hfile_idx_name(h,i);
+    uint64_t content_offset=hfile_idx_content(h,i);
 
     if(name_offset==(uint64_t)(-1LL) || content_offset==(uint64_t)(-1LL))  continue;
     hfile_item_t* name=h->names.base+name_offset;
     if(name->flags)  continue;
-    const char* filename=dict_get_byidx(h->names_dict,name->name_idx);
+    const char* filename=hfile_item_name(h,name);
     uint32_t* magic2=(void*)name;
 
     if(!filename || *magic2!=MAGIC2 || i!=name->name_idx)
@@ -1269,17 +2768,16 @@ int hfile_genlist(const hfile_t* h,const char* out)
       continue;
     }
 
-    void* meta_ptr=name+1;
+    const void* meta_ptr=name+1;
+    hfile_prop_t prop;
 
     fprintf(list,"%s",filename);
     for(size_t m=0;m<name->meta_cnt;m++)
     {
-      hfile_meta_t* meta=meta_ptr;
-      void* meta_val=meta+1;
-      const char* meta_name=dict_get_byidx(h->meta_dict,meta->idx);
-      meta_ptr=meta_val+meta->size;
+      meta_ptr=hfile_prop_next(h,meta_ptr,&prop);
+      const char* meta_name=dict_get_byidx(h->meta_dict,prop.idx);
       if(!meta_name /*|| *meta_name=='_'*/)  continue;
-      fprintf(list,"\t%s:%s",meta_name,(char*)meta_val);
+      fprintf(list,"\t%s:%s",meta_name,prop.val);
     }
     fprintf(list,"\n");
   }
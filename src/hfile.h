@@ -1,7 +1,7 @@
 //! \file
 //! \brief hugefile API
 
-#define HFILE_FORMAT_VERSION		1
+#define HFILE_FORMAT_VERSION		2
 
 //! need gzip data
 //#define HFILE_FLAG_GZIP
@@ -13,32 +13,129 @@
 #define HFILE_FILE_FLAG_CORRUPTED	2
 //! set if file is compressed
 //#define HFILE_FILE_FLAG_GZIP		4
+//! set in lookup results if content is stored as pieces, see hfile_get_view
+#define HFILE_FILE_FLAG_CHUNKED		8
 
 
 typedef struct hfile_t hfile_t;
+struct bitmap_t;
+struct bpool_stat_t;
 
 
+//! piece of content, layout compatible with struct iovec
+typedef struct hfile_iov_t
+{
+  const void* base;
+  size_t len;
+} hfile_iov_t;
+
 typedef struct hfile_ret_t
 {
   const char* name;
   size_t size;
-  void* content;
+  void* content;			//!< 0 for chunked content returned by hfile_get_view
   const uint8_t* checksum;
   size_t metas;
   const char** keys;
   const char** vals;
   size_t dups;
+  size_t pieces;			//!< count of pieces of chunked content returned by hfile_get_view, 0 otherwise
+  const hfile_iov_t* piece;		//!< pieces in mmaped data, valid until hfile_ret_free
 } hfile_ret_t;
 
+//! property ids kept in hot record
+#define HFILE_HOT_METAS		9
+
+//! lookup result served from hot records, points to mmaped data
+typedef struct hfile_hot_ret_t
+{
+  const void* content;
+  size_t size;
+  uint32_t flags;			//!< HFILE_FLAG_*
+  uint32_t metas;			//!< count of user properties, 255 if more
+  uint16_t meta[HFILE_HOT_METAS];	//!< ids of first user properties, see hfile_property_name
+} hfile_hot_ret_t;
+
+//! mapped files of hfile_open_opt_t: index with hot records, packed index, columns and sampler
+#define HFILE_FILE_IDX		0
+//! name records and property values
+#define HFILE_FILE_NAMES	1
+//! content
+#define HFILE_FILE_CONTENT	2
+#define HFILE_FILES		3
+//! hfile_open_opt_t.lock bit of names and properties hashes
+#define HFILE_LOCK_DICT		(1U<<HFILE_FILES)
+
+//! hfile_open_opt_t.advice: no readahead, default
+#define HFILE_ADVICE_RANDOM	0
+//! kernel default readahead
+#define HFILE_ADVICE_NORMAL	1
+//! aggressive readahead, pages behind are dropped early
+#define HFILE_ADVICE_SEQUENTIAL	2
+//! random, and whole file is read ahead on open
+#define HFILE_ADVICE_WILLNEED	3
+
+//! open options
+typedef struct hfile_open_opt_t
+{
+  uint64_t names_budget;		//!< resident bytes of names hash, strings beyond it are read from disk on hit. 0 for no limit
+  uint64_t pool;			//!< content lookups read by pread into buffer pool of this many bytes instead of mapping. 0 for mapping
+  uint32_t pool_page;			//!< page size of buffer pool, 0 for default
+  uint8_t advice[HFILE_FILES];		//!< HFILE_ADVICE_* by HFILE_FILE_*
+  uint32_t populate;			//!< bits 1<<HFILE_FILE_* of files prefaulted by MAP_POPULATE
+  uint32_t lock;			//!< bits 1<<HFILE_FILE_* of files and HFILE_LOCK_DICT locked in memory
+  int hugepages;			//!< back resident arrays of hashes by transparent huge pages
+  int noverify;				//!< skip checksums of files on open
+} hfile_open_opt_t;
+
 //! open with main hash in memory
 hfile_t* hfile_open(const char* base);
+//! open with options, opt may be 0
+hfile_t* hfile_open_ex(const char* base,const hfile_open_opt_t* opt);
+//! set open option from "name=value" string. return 0 on success
+int hfile_open_opt_set(hfile_open_opt_t* opt,const char* option);
 //! destructor
 void hfile_free(hfile_t*);
 
+//! keep filelist order
+#define HFILE_ORDER_INPUT	0
+//! order tiles by Hilbert curve inside zoom level
+#define HFILE_ORDER_HILBERT	1
+//! order tiles by Z-order (Morton) curve inside zoom level
+#define HFILE_ORDER_ZORDER	2
+
+//! build options
+typedef struct hfile_build_opt_t
+{
+  uint32_t flags;			//!< reserved
+  const char* hot;			//!< access counts, TSV name<TAB>count or access map, hot items placed first
+  const char* hot_db;			//!< database access map was recorded on
+  uint32_t order;			//!< HFILE_ORDER_*, applied after hotness
+  const char* tiles;			//!< tile name pattern with {z},{x},{y}, zoom/x/y properties used if 0 or not matched
+  const char* report;			//!< JSON build report with per phase rates, dedup ratio and size histogram, may be 0
+  int32_t progress;			//!< progress interval in seconds, 0 for default, negative disables
+  uint32_t mph;				//!< DICT_ALGO_* of names and properties hashes
+  uint32_t threads;			//!< names hash construction threads, 0 for count of cpus
+  uint32_t partition;			//!< keys per names hash partition, 0 for default
+  uint32_t dict_flags;			//!< DICT_FLAG_* of names hash
+  uint32_t records;			//!< write data.hot with packed hot record per name
+  uint32_t packed_idx;			//!< write data.pidx, index with offsets packed to their bit width
+  uint32_t cdc;				//!< average piece size of content defined chunking of big files, 0 store files whole
+  uint32_t values;			//!< keep repeated property values once in values.content, items refer to them by id
+  uint32_t columns;			//!< write data.cols, dense column by name index per numeric property
+  const char* sample;			//!< numeric property data.alias weighted sampler is built from, 0 for none
+} hfile_build_opt_t;
+
 //! build new index file from text with filenames
 int hfile_build(const char* result,const char* input,uint32_t flags);
+//! build new index file with options, opt may be 0
+int hfile_build_ex(const char* result,const char* input,const hfile_build_opt_t* opt);
+//! set build option from "name=value" string, value is not copied. return 0 on success
+int hfile_build_opt_set(hfile_build_opt_t* opt,const char* option);
 //! extract files to given folder
 int hfile_extract(hfile_t*,const char* folder_to,const char* regex,mode_t dirmode);
+//! extract files matching glob and, if filter is not 0, having bit of name index set
+int hfile_extract_ex(hfile_t*,const char* folder_to,const char* regex,const struct bitmap_t* filter,mode_t dirmode);
 
 #if 0
 //! repair data file
@@ -57,27 +154,79 @@ int hfile_stat(const hfile_t*);
 int hfile_dump(const hfile_t*,const char* outfolder);
 //! dump list of files suitable for import
 int hfile_genlist(const hfile_t*,const char* outfile);
+//! generate filelist of names having bit of name index set in filter, all if filter is 0
+int hfile_genlist_ex(const hfile_t*,const char* outfile,const struct bitmap_t* filter);
 
 //accessors:
 
 //! get names count
 ssize_t hfile_name_count(const hfile_t*);
-//! get name by index
+//! get name by index. for front coded names valid until next call in the same thread
 const char* hfile_name_by_idx(const hfile_t*,size_t idx);
 //! get index by name
 ssize_t hfile_idx_by_name(const hfile_t*,const char* name);
 
 //! get files count
 ssize_t hfile_file_count(const hfile_t*);
-//! get file content by index
+//! get file content by index, 0 for chunked content. reads the mapping even if database is opened with buffer pool
 const void* hfile_file_by_name(const hfile_t*,const char* name,size_t* size);
 
 //! get maximal filename length
 ssize_t hfile_maxlen(const hfile_t*);
 
 
+//! get file, chunked content is assembled into buffer owned by result
 hfile_ret_t* hfile_get(const hfile_t* h,const char* name);
+//! get file without copy, chunked content is returned as list of pieces. with buffer pool content is copied like by hfile_get
+hfile_ret_t* hfile_get_view(const hfile_t* h,const char* name);
+//! 128 bit hash of name for hfile_get_hash, valid while database is not rebuilt
+int hfile_hash(const hfile_t* h,const char* name,uint64_t hash[2]);
+//! get by precomputed name hash, works for databases built with mph=pthash only
+hfile_ret_t* hfile_get_hash(const hfile_t* h,const uint64_t hash[2]);
 void hfile_ret_free(hfile_ret_t*);
+//! get payload, size and property ids by name touching names hash and single hot record. without data.hot falls back to index.
+//! content is 0 for chunked content (HFILE_FILE_FLAG_CHUNKED), it points to the mapping even with buffer pool. return 0 if found
+int hfile_get_hot(const hfile_t* h,const char* name,hfile_hot_ret_t* ret);
+//! memory of one database file or hash
+typedef struct hfile_mem_t
+{
+  const char* name;			//!< file name in database folder
+  uint64_t mapped;			//!< mapped bytes, 0 for loaded hashes
+  uint64_t resident;			//!< mapped bytes in page cache, estimated from pages sampled at stride
+  uint64_t locked;			//!< bytes locked in memory
+  uint64_t heap;			//!< allocated bytes: loaded hashes, buffer pool pages
+} hfile_mem_t;
+
+//! upper bound of hfile_mem entries
+#define HFILE_MEM_MAX		12
+//! default sampling stride of hfile_stat
+#define HFILE_MEM_STRIDE	(256*1024)
+
+//! memory accounting of mapped files and loaded hashes: mincore of one page every stride bytes (0 for all pages),
+//! locked bytes from /proc/self/smaps. fills at most max entries, return their count or -1
+ssize_t hfile_mem(const hfile_t* h,uint64_t stride,hfile_mem_t* out,size_t max);
+//! hfile_stat with per file memory table sampled at stride
+int hfile_stat_ex(const hfile_t* h,uint64_t stride);
+//! counters of buffer pool (bpool.h), -1 if database is opened without it
+int hfile_pool_stat(const hfile_t* h,struct bpool_stat_t* st);
+//! property name by id
+const char* hfile_property_name(const hfile_t* h,uint32_t id);
+
+//! count of pooled property values, 0 if database keeps values in items
+ssize_t hfile_value_count(const hfile_t*);
+//! pooled property value by id. vals of lookup results with equal pooled value share pointer
+const char* hfile_value_by_idx(const hfile_t*,uint32_t id);
+//! id of pooled property value, -1 if value is not pooled
+ssize_t hfile_idx_by_value(const hfile_t*,const char* value);
+
+//! count of numeric property columns
+ssize_t hfile_column_count(const hfile_t*);
+//! evaluate predicates "property op number" joined by &&, op is one of == != < <= > >=, over numeric columns.
+//! out of at least hfile_name_count bits gets bits of matching name indices. return 0 on success, -1 on syntax error or property without column
+int hfile_filter(const hfile_t* h,const char* expr,struct bitmap_t* out);
+//! set bits of names matching glob (fnmatch with FNM_EXTMATCH) in out of at least hfile_name_count bits, other bits are kept.
+//! literals of glob are searched in parallel over resident plain names pool, fnmatch runs on candidates only. return count of matches, -1 on error
+ssize_t hfile_glob(const hfile_t* h,const char* glob,struct bitmap_t* out);
 
 // scanning
 
@@ -86,10 +235,13 @@ typedef struct hfile_it_t
 {
   const hfile_t* hf;
   size_t cur;
+  const struct bitmap_t* filter;	//!< skip names without bit set, 0 for all
 } hfile_it_t;
 
 //! ctr, is
 hfile_it_t* hfile_it_init(const hfile_t*);
+//! ctr of iterator over names having bit set in filter, filter must outlive iterator
+hfile_it_t* hfile_it_init_ex(const hfile_t*,const struct bitmap_t* filter);
 //! dtr
 void hfile_it_free(hfile_it_t*);
 //! get file
@@ -97,6 +249,38 @@ hfile_ret_t* hfile_it_get(hfile_it_t* h);
 //! restart iterator
 int hfile_it_rewind(hfile_it_t*);
 
-//! get random name
+//! get random name, uniform
 hfile_ret_t* hfile_get_rand_name(const hfile_t* h);
 
+// weighted sampling
+
+//! random generator state of one thread
+typedef struct hfile_rng_t
+{
+  uint64_t s[4];
+} hfile_rng_t;
+
+//! seed generator
+void hfile_rng_seed(hfile_rng_t* rng,uint64_t seed);
+//! name index drawn with probability proportional to property given at build by sample=property, -1 if database has no sampler.
+//! O(1) and allocation free, thread safe with rng owned by calling thread or 0 for internal per-thread one
+ssize_t hfile_sample_idx(const hfile_t* h,hfile_rng_t* rng);
+//! draw cnt name indices to out. return cnt, -1 if database has no sampler
+ssize_t hfile_sample_batch(const hfile_t* h,hfile_rng_t* rng,uint32_t* out,size_t cnt);
+//! get drawn name like hfile_get
+hfile_ret_t* hfile_sample(const hfile_t* h,hfile_rng_t* rng);
+//! sum of weights, 0 if database has no sampler
+double hfile_sample_total(const hfile_t* h);
+
+// page cache
+
+//! prewarm index file
+#define HFILE_PREWARM_IDX	1
+//! prewarm names/properties file
+#define HFILE_PREWARM_NAMES	2
+//! prewarm content file, use with care for big collections
+#define HFILE_PREWARM_CONTENT	4
+
+//! ask kernel to read selected (HFILE_PREWARM_*) files into page cache, blocks until done
+int hfile_prewarm(const hfile_t* h,uint32_t what);
+
@@ -0,0 +1,347 @@
+//! \file
+//! \brief hugefile internal structures, on disk layout and handle shared by library modules
+
+#define HFILE_FLAG_DELETED	1
+#define HFILE_FLAG_CORRUPTED	2
+
+#if HFILE_USE_HUGEPAGES
+#define HUGEPAGE	MAP_HUGETLB
+#else
+#define HUGEPAGE	0
+#endif
+
+//! dummy macros for point to on disk storage
+#define PERSISTENT
+
+//! common header for all files
+PERSISTENT typedef struct hfile_header_t
+{
+  uint32_t magic;			//!< common magic
+  uint32_t version;			//!< HFILE_VERSION
+  uint64_t size;			//!< size of entire file include header
+  uint32_t chunks;			//!< number of items
+  uint64_t tm;				//!< creation/last modification time
+  uint8_t uuid[UUID_SIZE];		//!< common uuid
+  uint8_t checksum[CHECKSUM_SIZE];	//!< checksum of entire file without header
+} __attribute__ ((packed)) hfile_header_t;
+
+
+//! single file pointer, one item of index file
+PERSISTENT typedef struct hfile_idx_item_t
+{
+  uint64_t content_offset;
+  uint64_t name_offset;
+//  uint32_t content_size;
+//  uint32_t name_size;
+} __attribute__ ((packed)) hfile_idx_item_t;
+
+
+//! packed index: after header records of content_bits+name_bits bits, bit stream is little endian.
+//! field of all ones is HFILE_NOT_FOUND
+PERSISTENT typedef struct hfile_pidx_header_t
+{
+  uint8_t content_bits;			//!< width of content offset
+  uint8_t name_bits;			//!< width of names record offset
+  uint8_t reserved[6];
+} __attribute__ ((packed)) hfile_pidx_header_t;
+
+//! widest packed field, so any field is read by single unaligned 8 byte load
+#define HFILE_PIDX_MAXBITS	56
+//! offset of packed records in file
+#define HFILE_PIDX_OFFSET	(sizeof(hfile_header_t)+sizeof(hfile_pidx_header_t))
+//! size of packed records of n items, padded for 8 byte loads
+#define HFILE_PIDX_BYTES(n_,bits_)	(((uint64_t)(n_)*(bits_)+7)/8+sizeof(uint64_t))
+
+//! optional packed index file
+typedef struct hfile_pidx_t
+{
+  void* base;				//!< base mmaped ptr, 0 if database has no packed index
+  uint64_t mmapsize;			//!< size of memory mapped region
+  int fd;				//!< file descriptor
+  hfile_header_t header;		//!< copy of header
+  const uint8_t* data;			//!< packed records
+  uint32_t content_bits;
+  uint32_t name_bits;
+} hfile_pidx_t;
+
+//! index file
+typedef struct hfile_idx_t
+{
+  void* base;				//!< base mmaped ptr
+  uint64_t mmapsize;			//!< size of memory mapped region
+  int fd;				//!< index file descriptor
+  hfile_header_t header;		//!< copy of header
+  hfile_idx_item_t* data;		//!< pointer to hfile_idx_item_t
+} hfile_idx_t;
+
+
+//! chunk, header of single file in data file collection
+PERSISTENT typedef struct hfile_chunk_t
+{
+  uint32_t magic2;
+  uint32_t size;			//!< chunk total size include this header
+  uint8_t flags;			//!< HFILE_FILE_FLAG_*
+  uint8_t checksum[CHECKSUM_SIZE];	//!< hash of file content only
+} __attribute__ ((packed)) hfile_chunk_t;
+
+//! hfile_chunk_t.flags of chunk list: payload is hfile_piece_t array, checksum is of whole content
+#define HFILE_CHUNK_LIST	1
+
+//! piece of content split by content defined chunking, piece is ordinary chunk shared by any lists
+PERSISTENT typedef struct hfile_piece_t
+{
+  uint64_t offset;			//!< offset of piece chunk in data.content
+  uint32_t size;			//!< piece payload size
+} __attribute__ ((packed)) hfile_piece_t;
+
+//! content size of chunk, sum of pieces for chunk list
+static inline uint64_t hfile_chunk_total(const hfile_chunk_t* chunk)
+{
+  if(!(chunk->flags & HFILE_CHUNK_LIST))  return chunk->size;
+  const hfile_piece_t* p=(const void*)(chunk+1);
+  uint64_t rv=0;
+  for(size_t i=0;i<chunk->size/sizeof(*p);i++)
+    rv+=p[i].size;
+  return rv;
+}
+
+
+//! base data file
+typedef struct hfile_content_t
+{
+  void* base;			//!< base mmaped ptr
+  uint64_t mmapsize;		//!< size of memory mapped region
+  int fd;			//!< file descriptor
+  hfile_header_t header;
+  hfile_chunk_t* files;
+  struct bpool_t* pool;		//!< buffer pool of lookups, 0 if they read the mapping
+} hfile_content_t;
+
+
+//! metainfo chunk
+PERSISTENT typedef struct hfile_meta_t
+{
+//  uint16_t type;		//!< HFILE_META_TYPE_*
+  uint16_t idx;			//!< index of metainfo name
+  uint16_t size;		//!< chunk size
+// uint8_t metadata[.size]
+} __attribute__ ((packed)) hfile_meta_t;
+
+
+//! names.content header version bit: properties of items are varint pairs of property id and value id in values.content.
+//! pair is varint(idx<<1 | inline) followed by varint(value id) or, if inline, by NUL terminated value
+#define HFILE_VERSION_VALUES	0x00010000U
+
+//! pooled property values file: value offsets at HFILE_VALUES_OFFSET, ids sorted by value, NUL terminated values
+typedef struct hfile_values_t
+{
+  void* base;				//!< base mmaped ptr, 0 if properties are kept in items
+  uint64_t mmapsize;			//!< size of memory mapped region
+  int fd;				//!< file descriptor
+  hfile_header_t header;		//!< copy of header, chunks is count of values
+  const uint64_t* off;			//!< offsets of values in str
+  const uint32_t* sorted;		//!< ids in value order
+  const char* str;			//!< values
+} hfile_values_t;
+
+//! offset of value offsets in pool file, tables start at cache line boundary
+#define HFILE_VALUES_OFFSET	((sizeof(hfile_header_t)+63) & ~(size_t)63)
+//! offset of values in pool file of cnt values
+#define HFILE_VALUES_STR(cnt_)	(HFILE_VALUES_OFFSET+(uint64_t)(cnt_)*(sizeof(uint64_t)+sizeof(uint32_t)))
+
+
+//! individual file with name, attributes and metainfo
+PERSISTENT typedef struct hfile_item_t
+{
+  uint32_t magic2;
+  uint32_t size;			//!< chunk total size include this header
+  uint8_t flags;			//!< HFILE_FILE_FLAG_*
+  uint64_t content;			//!< pointer to content file
+  uint32_t name_idx;			//!< name index in dict
+  uint16_t meta_cnt;			//!< count of metainfo
+//  uint32_t uid,gid,mode;
+//  uint64_t atime,mtime;
+
+/*
+  hfile_meta_t[.meta_cnt]; or varint pairs if names.content version has HFILE_VERSION_VALUES
+*/
+} __attribute__ ((packed)) hfile_item_t;
+
+
+//! index file
+typedef struct hfile_names_t
+{
+  void* base;				//!< base mmaped ptr
+  uint64_t mmapsize;			//!< size of memory mapped region
+  int fd;				//!< index file descriptor
+  hfile_header_t header;		//!< copy of header
+  hfile_item_t* items;			//!< pointer to first hfile_item
+} hfile_names_t;
+
+
+//! hot record of name slot, lookup touches it instead of index item, names.content item and content chunk header
+PERSISTENT typedef struct hfile_hot_t
+{
+  uint64_t content;			//!< offset of payload (piece list if chunked) in data.content, HFILE_NOT_FOUND if slot is not used
+  uint32_t size;			//!< content size
+  uint8_t flags;			//!< HFILE_FLAG_* of item, HFILE_FILE_FLAG_CHUNKED
+  uint8_t metas;			//!< count of user properties, 255 if more
+  uint16_t meta[HFILE_HOT_METAS];	//!< ids of first user properties
+} __attribute__ ((packed)) hfile_hot_t;
+
+//! records start at cache line boundary, two records per line
+#define HFILE_HOT_OFFSET	((sizeof(hfile_header_t)+63) & ~(size_t)63)
+
+//! numeric column of data.cols, values are COLUMN_I64 or COLUMN_F64 by name index
+PERSISTENT typedef struct hfile_column_t
+{
+  uint32_t meta;			//!< property index in meta_dict
+  uint32_t type;			//!< COLUMN_*
+  uint64_t offset;			//!< offset of header.chunks values in file, cache line aligned
+} __attribute__ ((packed)) hfile_column_t;
+
+//! data.cols: after header count of columns and their directory
+PERSISTENT typedef struct hfile_cols_header_t
+{
+  uint32_t count;
+  uint32_t reserved;
+} __attribute__ ((packed)) hfile_cols_header_t;
+
+//! optional numeric columns file
+typedef struct hfile_cols_t
+{
+  void* base;				//!< base mmaped ptr, 0 if database has no columns
+  uint64_t mmapsize;			//!< size of memory mapped region
+  int fd;				//!< file descriptor
+  hfile_header_t header;		//!< copy of header, chunks is count of values per column
+  uint32_t count;			//!< count of columns
+  const hfile_column_t* dir;		//!< columns
+} hfile_cols_t;
+
+//! data.alias: after header sampler description, alias table of header.chunks buckets by name index at HFILE_ALIAS_OFFSET
+PERSISTENT typedef struct hfile_alias_header_t
+{
+  uint32_t meta;			//!< property index in meta_dict weights are taken from
+  uint32_t weighted;			//!< count of names with positive weight
+  double total;				//!< sum of weights
+} __attribute__ ((packed)) hfile_alias_header_t;
+
+#define HFILE_ALIAS_OFFSET	((sizeof(hfile_header_t)+sizeof(hfile_alias_header_t)+63) & ~(size_t)63)
+
+//! optional weighted sampler file
+typedef struct hfile_alias_file_t
+{
+  void* base;				//!< base mmaped ptr, 0 if database has no sampler
+  uint64_t mmapsize;			//!< size of memory mapped region
+  int fd;				//!< file descriptor
+  hfile_header_t header;		//!< copy of header, chunks is count of buckets
+  const hfile_alias_header_t* info;	//!< sampler description
+  const struct alias_t* data;		//!< buckets
+} hfile_alias_file_t;
+
+//! optional hot records file
+typedef struct hfile_hot_file_t
+{
+  void* base;				//!< base mmaped ptr, 0 if database has no hot records
+  uint64_t mmapsize;			//!< size of memory mapped region
+  int fd;				//!< file descriptor
+  hfile_header_t header;		//!< copy of header
+  hfile_hot_t* data;			//!< records by name index
+} hfile_hot_file_t;
+
+
+typedef struct hfile_t
+{
+  hfile_idx_t idx;
+  hfile_names_t names;
+  hfile_content_t content;
+  hfile_hot_file_t hot;
+  hfile_pidx_t pidx;
+  hfile_values_t values;
+  hfile_cols_t cols;
+  hfile_alias_file_t alias;
+  dict_t* meta_dict;
+  dict_t* names_dict;
+  struct prewarm_t* rec;		//!< access recorder, may be 0
+  struct hotkey_t* keys;		//!< hot names tracker, may be 0
+  uint32_t name_meta;			//!< index of _name property, names of names-free database are taken from it
+} hfile_t;
+
+
+//! read bits wide field at bit position pos
+static inline uint64_t hfile_bits_get(const uint8_t* p,uint64_t pos,uint32_t bits)
+{
+  uint64_t w;
+  memcpy(&w,p+pos/8,sizeof(w));
+  return (w>>(pos%8)) & ((1ULL<<bits)-1);
+}
+
+//! content chunk offset of name index, HFILE_NOT_FOUND if absent. packed index is used if database has one
+static inline uint64_t hfile_idx_content(const hfile_t* h,size_t n)
+{
+  if(!h->pidx.data)  return h->idx.data[n].content_offset;
+  uint32_t bits=h->pidx.content_bits;
+  uint64_t v=hfile_bits_get(h->pidx.data,n*(bits+h->pidx.name_bits),bits);
+  return v==(1ULL<<bits)-1 ? HFILE_NOT_FOUND : v;
+}
+
+//! names record offset of name index, HFILE_NOT_FOUND if absent
+static inline uint64_t hfile_idx_name(const hfile_t* h,size_t n)
+{
+  if(!h->pidx.data)  return h->idx.data[n].name_offset;
+  uint32_t bits=h->pidx.name_bits;
+  uint64_t v=hfile_bits_get(h->pidx.data,n*(bits+h->pidx.content_bits)+h->pidx.content_bits,bits);
+  return v==(1ULL<<bits)-1 ? HFILE_NOT_FOUND : v;
+}
+
+//! read LEB128 varint, return position after it
+static inline const uint8_t* hfile_varint_get(const uint8_t* p,uint64_t* v)
+{
+  uint64_t rv=0;
+  for(uint32_t sh=0;;sh+=7)
+  {
+    uint8_t b=*p++;
+    rv|=(uint64_t)(b&0x7f)<<sh;
+    if(!(b&0x80) || sh>=63)  break;
+  }
+  *v=rv;
+  return p;
+}
+
+//! value id of property stored in item
+#define HFILE_VALUE_INLINE	((uint32_t)-1)
+
+//! decoded property of names record
+typedef struct hfile_prop_t
+{
+  uint32_t idx;				//!< property name index in meta_dict
+  uint32_t id;				//!< value id in values.content or HFILE_VALUE_INLINE
+  const char* val;
+} hfile_prop_t;
+
+//! decode property of item at p, return position of next one
+static inline const void* hfile_prop_next(const hfile_t* h,const void* p,hfile_prop_t* prop)
+{
+  if(!h->values.base)
+  {
+    const hfile_meta_t* meta=p;
+    prop->idx=meta->idx;
+    prop->id=HFILE_VALUE_INLINE;
+    prop->val=(const char*)(meta+1);
+    return (const void*)(meta+1)+meta->size;
+  }
+
+  uint64_t k,v;
+  p=hfile_varint_get(p,&k);
+  prop->idx=k>>1;
+  if(k&1)
+  {
+    prop->id=HFILE_VALUE_INLINE;
+    prop->val=p;
+    return p+strlen(p)+1;
+  }
+  p=hfile_varint_get(p,&v);
+  prop->id=v<h->values.header.chunks ? v : HFILE_VALUE_INLINE;
+  prop->val=v<h->values.header.chunks ? h->values.str+h->values.off[v] : "";
+  return p;
+}
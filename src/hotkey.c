@@ -0,0 +1,413 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "checksum.h"
+#include "dict.h"
+#include "hfile.h"
+#include "hfile_int.h"
+#include "hotkey.h"
+
+//! slot of threads beyond HOTKEY_SLOTS, updated under lock
+#define HOTKEY_SHARED		HOTKEY_SLOTS
+
+typedef struct hotkey_slot_t
+{
+  uint32_t owner;			//!< claimed by live thread
+  uint32_t seq;				//!< odd while decay is applied
+  uint64_t applied;			//!< sum of decay shifts applied to counts
+  uint32_t* cnt;			//!< HOTKEY_DEPTH rows of width counters, 0 until slot is first claimed
+  uint32_t* top;			//!< heavy hitters candidates
+  uint32_t* top_cnt;			//!< their counts at last update
+  uint32_t tops;			//!< count of candidates
+  uint32_t min;				//!< position of candidate with smallest count
+} __attribute__ ((aligned(64))) hotkey_slot_t;
+
+struct hotkey_t
+{
+  uint8_t uuid[UUID_SIZE];		//!< database uuid
+  uint32_t items;			//!< names in database
+  uint32_t topk;
+  uint32_t width;			//!< power of two
+  uint64_t shift;			//!< sum of decay shifts requested
+  pthread_key_t key;			//!< slot of thread
+  pthread_mutex_t lock;			//!< HOTKEY_SHARED slot
+  hfile_t* hf;				//!< database tracker is attached to
+  hotkey_slot_t slot[HOTKEY_SLOTS+1];
+};
+
+
+//! thread exit, slot keeps counts and waits for next thread
+static void hotkey_release(void* arg)
+{
+  hotkey_slot_t* s=arg;
+  __atomic_store_n(&s->owner,0,__ATOMIC_RELEASE);
+}
+
+hotkey_t* hotkey_init(const hfile_t* hf,uint32_t topk,uint32_t width)
+{
+  if(!hf)  return 0;
+  if(!topk)  topk=HOTKEY_TOPK;
+  if(!width)  width=HOTKEY_WIDTH;
+  uint32_t w=64;
+  while(w<width && w<(1u<<30))  w<<=1;
+
+  hotkey_t* rv=md_new(rv);
+  if(pthread_key_create(&rv->key,hotkey_release))
+  {
+    log("can not create thread key");
+    free(rv);
+    return 0;
+  }
+  memcpy(rv->uuid,hf->idx.header.uuid,sizeof(rv->uuid));
+  rv->items=hf->idx.header.chunks;
+  rv->topk=topk;
+  rv->width=w;
+  pthread_mutex_init(&rv->lock,0);
+  return rv;
+}
+
+void hotkey_free(hotkey_t* k)
+{
+  if(!k)  return;
+  if(k->hf)  hotkey_detach(k->hf);
+  pthread_key_delete(k->key);
+  pthread_mutex_destroy(&k->lock);
+  for(size_t i=0;i<=HOTKEY_SLOTS;i++)
+  {
+    free(k->slot[i].cnt);
+    free(k->slot[i].top);
+    free(k->slot[i].top_cnt);
+  }
+  free(k);
+}
+
+int hotkey_attach(hfile_t* hf,hotkey_t* k)
+{
+  if(!hf || !k)  return -1;
+  if(memcmp(k->uuid,hf->idx.header.uuid,UUID_SIZE) || k->items!=hf->idx.header.chunks)
+  {
+    log("tracker belongs to another database");
+    return -1;
+  }
+  hotkey_detach(hf);
+  k->hf=hf;
+  hf->keys=k;
+  return 0;
+}
+
+hotkey_t* hotkey_detach(hfile_t* hf)
+{
+  if(!hf || !hf->keys)  return 0;
+  hotkey_t* rv=hf->keys;
+  hf->keys=0;
+  rv->hf=0;
+  return rv;
+}
+
+
+//! counter positions of item, one per row
+static inline void hotkey_hash(const hotkey_t* k,size_t idx,uint32_t* pos)
+{
+// splitmix64 finalizer, rows by double hashing
+  uint64_t x=idx+0x9e3779b97f4a7c15ULL;
+  x=(x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+  x=(x^(x>>27))*0x94d049bb133111ebULL;
+  x^=x>>31;
+  uint32_t h1=x;
+  uint32_t h2=(x>>32) | 1;
+  for(uint32_t i=0;i<HOTKEY_DEPTH;i++)
+    pos[i]=i*k->width+((h1+i*h2) & (k->width-1));
+}
+
+static void hotkey_alloc(const hotkey_t* k,hotkey_slot_t* s)
+{
+  if(s->cnt)  return;
+  s->top=md_tcalloc(uint32_t,k->topk);
+  s->top_cnt=md_tcalloc(uint32_t,k->topk);
+  __atomic_store_n(&s->cnt,md_tcalloc(uint32_t,(size_t)HOTKEY_DEPTH*k->width),__ATOMIC_RELEASE);
+}
+
+//! bind free slot to calling thread, shared slot if there is none
+static hotkey_slot_t* hotkey_claim(hotkey_t* k)
+{
+  hotkey_slot_t* s=0;
+  for(size_t i=0;i<HOTKEY_SLOTS && !s;i++)
+  {
+    uint32_t o=0;
+    if(!__atomic_load_n(&k->slot[i].owner,__ATOMIC_RELAXED) &&
+       __atomic_compare_exchange_n(&k->slot[i].owner,&o,1,0,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+      s=k->slot+i;
+  }
+  if(s)
+    hotkey_alloc(k,s);
+  else
+  {
+    s=k->slot+HOTKEY_SHARED;
+    pthread_mutex_lock(&k->lock);
+    hotkey_alloc(k,s);
+    pthread_mutex_unlock(&k->lock);
+  }
+  pthread_setspecific(k->key,s);
+  return s;
+}
+
+static inline uint32_t hotkey_shr(uint32_t v,uint64_t shift)
+{
+  return shift>=HOTKEY_RESET ? 0 : v>>shift;
+}
+
+//! recompute position of smallest candidate
+static void hotkey_min(hotkey_slot_t* s)
+{
+  uint32_t m=0;
+  for(uint32_t i=1;i<s->tops;i++)
+    if(s->top_cnt[i]<s->top_cnt[m])  m=i;
+  s->min=m;
+}
+
+//! apply pending decay to slot, readers see odd sequence meanwhile
+static void hotkey_apply(const hotkey_t* k,hotkey_slot_t* s,uint64_t shift)
+{
+  uint64_t d=shift-s->applied;
+  __atomic_store_n(&s->seq,s->seq+1,__ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  size_t n=(size_t)HOTKEY_DEPTH*k->width;
+  for(size_t i=0;i<n;i++)
+    __atomic_store_n(s->cnt+i,hotkey_shr(s->cnt[i],d),__ATOMIC_RELAXED);
+  uint32_t tops=0;
+  for(uint32_t i=0;i<s->tops;i++)
+  {
+    uint32_t c=hotkey_shr(s->top_cnt[i],d);
+    if(!c)  continue;
+    __atomic_store_n(s->top+tops,s->top[i],__ATOMIC_RELAXED);
+    __atomic_store_n(s->top_cnt+tops,c,__ATOMIC_RELAXED);
+    tops++;
+  }
+  __atomic_store_n(&s->tops,tops,__ATOMIC_RELAXED);
+  hotkey_min(s);
+  __atomic_store_n(&s->applied,shift,__ATOMIC_RELAXED);
+
+  __atomic_store_n(&s->seq,s->seq+1,__ATOMIC_RELEASE);
+}
+
+//! count item in slot owned by caller, keep it among candidates if it beats the smallest one
+static void hotkey_add(const hotkey_t* k,hotkey_slot_t* s,size_t idx)
+{
+  uint64_t shift=__atomic_load_n(&k->shift,__ATOMIC_ACQUIRE);
+  if(s->applied!=shift)  hotkey_apply(k,s,shift);
+
+  uint32_t pos[HOTKEY_DEPTH];
+  hotkey_hash(k,idx,pos);
+  uint32_t est=UINT32_MAX;
+  for(uint32_t i=0;i<HOTKEY_DEPTH;i++)
+  {
+    uint32_t v=s->cnt[pos[i]];
+    if(v!=UINT32_MAX)  __atomic_store_n(s->cnt+pos[i],++v,__ATOMIC_RELAXED);
+    if(v<est)  est=v;
+  }
+
+  if(s->tops==k->topk && est<=s->top_cnt[s->min])  return;
+  for(uint32_t i=0;i<s->tops;i++)
+    if(s->top[i]==idx)
+    {
+      __atomic_store_n(s->top_cnt+i,est,__ATOMIC_RELAXED);
+      if(i==s->min)  hotkey_min(s);
+      return;
+    }
+
+  uint32_t i=s->tops<k->topk ? s->tops : s->min;
+  __atomic_store_n(s->top+i,idx,__ATOMIC_RELAXED);
+  __atomic_store_n(s->top_cnt+i,est,__ATOMIC_RELAXED);
+  if(i==s->tops)
+  {
+    __atomic_store_n(&s->tops,s->tops+1,__ATOMIC_RELEASE);
+    if(est<s->top_cnt[s->min])  s->min=i;
+  }
+  else
+    hotkey_min(s);
+}
+
+void hotkey_mark(hotkey_t* k,size_t idx)
+{
+  if(!k || idx>=k->items)  return;
+  hotkey_slot_t* s=pthread_getspecific(k->key);
+  if(!s)  s=hotkey_claim(k);
+  if(s!=k->slot+HOTKEY_SHARED)
+  {
+    hotkey_add(k,s,idx);
+    return;
+  }
+  pthread_mutex_lock(&k->lock);
+  hotkey_add(k,s,idx);
+  pthread_mutex_unlock(&k->lock);
+}
+
+
+//! wait for even sequence of slot
+static uint32_t hotkey_read_begin(const hotkey_slot_t* s)
+{
+  uint32_t seq;
+  while((seq=__atomic_load_n(&s->seq,__ATOMIC_ACQUIRE)) & 1)
+    sched_yield();
+  return seq;
+}
+
+//! 1 if slot was not decayed since hotkey_read_begin
+static int hotkey_read_end(const hotkey_slot_t* s,uint32_t seq)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&s->seq,__ATOMIC_RELAXED)==seq;
+}
+
+//! estimate of item from all slots as of decay shift
+static uint64_t hotkey_est(const hotkey_t* k,size_t idx,uint64_t shift)
+{
+  uint32_t pos[HOTKEY_DEPTH];
+  hotkey_hash(k,idx,pos);
+  uint64_t sum[HOTKEY_DEPTH]={0,};
+  for(size_t i=0;i<=HOTKEY_SLOTS;i++)
+  {
+    const hotkey_slot_t* s=k->slot+i;
+    const uint32_t* cnt=__atomic_load_n(&s->cnt,__ATOMIC_ACQUIRE);
+    if(!cnt)  continue;
+
+    uint32_t v[HOTKEY_DEPTH];
+    uint64_t applied;
+    uint32_t seq;
+    do
+    {
+      seq=hotkey_read_begin(s);
+      applied=__atomic_load_n(&s->applied,__ATOMIC_RELAXED);
+      for(uint32_t j=0;j<HOTKEY_DEPTH;j++)
+        v[j]=__atomic_load_n(cnt+pos[j],__ATOMIC_RELAXED);
+    } while(!hotkey_read_end(s,seq));
+
+// slot may be ahead if decay was requested after shift was read
+    uint64_t d=shift>applied ? shift-applied : 0;
+    for(uint32_t j=0;j<HOTKEY_DEPTH;j++)
+      sum[j]+=hotkey_shr(v[j],d);
+  }
+
+  uint64_t rv=sum[0];
+  for(uint32_t j=1;j<HOTKEY_DEPTH;j++)
+    if(sum[j]<rv)  rv=sum[j];
+  return rv;
+}
+
+uint64_t hotkey_count(hotkey_t* k,size_t idx)
+{
+  if(!k || idx>=k->items)  return 0;
+  return hotkey_est(k,idx,__atomic_load_n(&k->shift,__ATOMIC_ACQUIRE));
+}
+
+static int hotkey_cmp_idx(const void* a,const void* b)
+{
+  uint32_t x=*(const uint32_t*)a;
+  uint32_t y=*(const uint32_t*)b;
+  return x<y ? -1 : x>y;
+}
+
+static int hotkey_cmp_count(const void* a,const void* b)
+{
+  const hotkey_item_t* x=a;
+  const hotkey_item_t* y=b;
+  if(x->count!=y->count)  return x->count>y->count ? -1 : 1;
+  return x->idx<y->idx ? -1 : x->idx>y->idx;
+}
+
+size_t hotkey_top(hotkey_t* k,hotkey_item_t* out,size_t max)
+{
+  if(!k || !out || !max)  return 0;
+  uint64_t shift=__atomic_load_n(&k->shift,__ATOMIC_ACQUIRE);
+
+// union of candidates of all slots, estimated from all of them
+  uint32_t* cand=md_tmalloc(uint32_t,(size_t)(HOTKEY_SLOTS+1)*k->topk);
+  size_t cnt=0;
+  for(size_t i=0;i<=HOTKEY_SLOTS;i++)
+  {
+    const hotkey_slot_t* s=k->slot+i;
+    if(!__atomic_load_n(&s->cnt,__ATOMIC_ACQUIRE))  continue;
+    size_t from=cnt;
+    uint32_t seq;
+    do
+    {
+      cnt=from;
+      seq=hotkey_read_begin(s);
+      uint32_t tops=__atomic_load_n(&s->tops,__ATOMIC_ACQUIRE);
+      for(uint32_t j=0;j<tops;j++)
+        cand[cnt++]=__atomic_load_n(s->top+j,__ATOMIC_RELAXED);
+    } while(!hotkey_read_end(s,seq));
+  }
+  qsort(cand,cnt,sizeof(cand[0]),hotkey_cmp_idx);
+
+  hotkey_item_t* items=md_tmalloc(hotkey_item_t,cnt ? cnt : 1);
+  size_t n=0;
+  for(size_t i=0;i<cnt;i++)
+  {
+    if(i && cand[i]==cand[i-1])  continue;
+    uint64_t c=hotkey_est(k,cand[i],shift);
+    if(!c)  continue;
+    items[n].idx=cand[i];
+    items[n++].count=c;
+  }
+  qsort(items,n,sizeof(items[0]),hotkey_cmp_count);
+  if(n>max)  n=max;
+  memcpy(out,items,n*sizeof(items[0]));
+  free(items);
+  free(cand);
+  return n;
+}
+
+void hotkey_decay(hotkey_t* k,uint32_t shift)
+{
+  if(!k || !shift)  return;
+  __atomic_fetch_add(&k->shift,shift<HOTKEY_RESET ? shift : HOTKEY_RESET,__ATOMIC_RELEASE);
+}
+
+
+int hotkey_save(hotkey_t* k,const hfile_t* hf,const char* fn)
+{
+  if(!k || !hf || !fn || !*fn)  return -1;
+  if(memcmp(k->uuid,hf->idx.header.uuid,UUID_SIZE))
+  {
+    log("tracker belongs to another database");
+    return -1;
+  }
+
+  char* tmp=0;
+  asprintf(&tmp,"%s.tmp",fn);
+  FILE* f=fopen(tmp,"w");
+  if(!f)
+  {
+    log("can not create file <%s>: %s",tmp,strerror(errno));
+    free(tmp);
+    return -1;
+  }
+
+  hotkey_item_t* items=md_tmalloc(hotkey_item_t,k->topk);
+  size_t n=hotkey_top(k,items,k->topk);
+  int rv=0;
+  for(size_t i=0;i<n && rv>=0;i++)
+  {
+    const char* name=hfile_name_by_idx(hf,items[i].idx);
+    if(name)  rv=fprintf(f,"%s\t%ju\n",name,(uintmax_t)items[i].count);
+  }
+  free(items);
+  rv=rv<0 || fclose(f);
+  if(!rv)  rv=rename(tmp,fn);
+  if(rv)
+  {
+    log("can not save hot list <%s>",fn);
+    unlink(tmp);
+  }
+  free(tmp);
+  return rv ? -1 : 0;
+}
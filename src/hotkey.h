@@ -0,0 +1,47 @@
+//! \file
+//! \brief hot names tracker: count-min sketch of lookups with heavy hitters candidates, one slot per thread
+//! updated without locks or shared writes, slots are merged on read. counts decay by windows
+
+typedef struct hotkey_t hotkey_t;
+
+//! default count of heavy hitters kept per thread
+#define HOTKEY_TOPK		64
+//! default counters per sketch row, rounded up to power of two
+#define HOTKEY_WIDTH		4096
+//! sketch rows, estimate is minimum over them
+#define HOTKEY_DEPTH		4
+//! threads with own slots, further threads share one locked slot
+#define HOTKEY_SLOTS		64
+//! decay shift that zeroes counts
+#define HOTKEY_RESET		32
+
+//! snapshot item
+typedef struct hotkey_item_t
+{
+  uint32_t idx;				//!< name index
+  uint64_t count;			//!< estimated lookups in current window, never below true count
+} hotkey_item_t;
+
+//! create empty tracker for database, topk and width are 0 for defaults. counts overestimate by at most
+//! e/width of all lookups with probability 1-e^-HOTKEY_DEPTH
+hotkey_t* hotkey_init(const hfile_t* hf,uint32_t topk,uint32_t width);
+//! dtr, tracker shall be detached before
+void hotkey_free(hotkey_t*);
+
+//! start counting lookups by name, fail if tracker belongs to another database
+int hotkey_attach(hfile_t* hf,hotkey_t* k);
+//! stop counting, return detached tracker
+hotkey_t* hotkey_detach(hfile_t* hf);
+//! count lookup of item, called by library for attached tracker, thread safe
+void hotkey_mark(hotkey_t* k,size_t idx);
+
+//! estimated count of item, thread safe
+uint64_t hotkey_count(hotkey_t* k,size_t idx);
+//! up to max hottest items by estimated count, descending. return count of items, thread safe
+size_t hotkey_top(hotkey_t* k,hotkey_item_t* out,size_t max);
+//! start new window: counts so far are shifted right by shift bits, 1 halves them, HOTKEY_RESET drops them.
+//! slots apply it on their next lookup, readers account for slots not done yet
+void hotkey_decay(hotkey_t* k,uint32_t shift);
+
+//! save top items as TSV name<TAB>count, accepted by build option hot
+int hotkey_save(hotkey_t* k,const hfile_t* hf,const char* fn);
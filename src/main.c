@@ -6,33 +6,85 @@
 
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #include "common.h"
 #include "checksum.h"
 #include "utils.h"
 #include "dict.h"
 #include "hfile.h"
+#include "bitmap.h"
+#include "prewarm.h"
+#include "hotkey.h"
+#include "aio.h"
 #include "memcache.h"
 
 
+//! maximal count of -O options
+#define MAIN_MAX_OPTS	64
+
+//! names looked up together, results of a batch are held at once like answer to multi-get
+#define MAIN_GET_BATCH	64
+
+//! -O options of commands reading database
+static hfile_open_opt_t open_opt;
+
 static const char* usage="hugefle manipulation program\n"
 "usage:\n"
 "hugefile -h\n"
 "\tprint this help\n"
-"hugefile -c -d database_to_create -s source_filelist\n"
+"hugefile -c -d database_to_create -s source_filelist [-O option=value]...\n"
 "\tcreate hugefile from list of files, filelist format see in README.md, in simplest case it is a result of find $DIR -type f >filelist\n"
-"hugefile -x -d database -o target_folder [-f filter] [-s filelist_for_mapping]\n"
+"\tbuild options:\n"
+"\t\thot=hotlist\tplace frequently accessed items first, hotlist is TSV name<TAB>count or access map\n"
+"\t\thotdb=database\tdatabase access map was recorded on\n"
+"\t\torder=hilbert|zorder|input\tplace tiles of the same zoom level along space filling curve\n"
+"\t\ttiles=pattern\ttile name pattern like {z}-{x}-{y}.png, by default zoom/x/y properties are used\n"
+"\t\tmph=bdz|chd|pthash\tminimal perfect hash algorithm of names, default bdz\n"
+"\t\tnames=0\tdo not keep names in memory, only 64 bit fingerprints; listing and extract use names from names.content\n"
+"\t\tnames=front\tkeep names sorted and front coded in blocks of 16, decoded on access\n"
+"\t\tpacked_idx=1\twrite data.pidx, index with offsets packed to their bit width, used instead of data.idx\n"
+"\t\trecords=1\twrite data.hot, packed record per name with payload offset, size and property ids\n"
+"\t\tvalues=1\tkeep repeated property values once, items hold varint property and value ids\n"
+"\t\tcolumns=1\twrite data.cols, dense column per property with numeric values only, used by -x -q\n"
+"\t\tsample=property\twrite data.alias, alias table drawing names with probability proportional to numeric property\n"
+"\t\tcdc=1|size[k|m]\tsplit files above 8*size to content defined pieces of size in average (8k for 1), identical pieces are stored once\n"
+"\t\tfingerprint=1\tkeep 16 bit fingerprint per name, misses are rejected without touching names\n"
+"\t\tthreads=N\tpthash construction threads, default count of cpus\n"
+"\t\tpartition=N\tpthash keys per partition, default 4M, partitions are built in parallel\n"
+"\t\treport=file\twrite JSON build report: per phase rates, dedup ratio, size histogram\n"
+"\t\tprogress=seconds\tprogress interval, 0 disables, default 10\n"
+"other commands take open options as -O option=value:\n"
+"\t\tnames_budget=size[k|m|g]\tresident memory of names hash, names beyond it stay on disk and are read on hit\n"
+"\t\tpool=size[k|m|g]\tread content by pread into buffer pool of this size instead of mapping it\n"
+"\t\tpool_page=size[k]\tpage of buffer pool, default 32k\n"
+"\t\tidx_advice|names_advice|content_advice=random|normal|sequential|willneed\taccess pattern of mapped file, default random\n"
+"\t\tpopulate=idx,names,content\tprefault mapped files on open\n"
+"\t\tmlock=idx,names,content,dict\tlock mapped files and resident arrays of hashes in memory, all for everything\n"
+"\t\thugepages=1\tback resident arrays of hashes by transparent huge pages\n"
+"\t\tverify=0\tskip checksums of files on open\n"
+"hugefile -x -d database -o target_folder [-f filter] [-q predicate] [-s filelist_for_mapping]\n"
 "\textract all (or selected) files from database to specified folder\n"
+"\tpredicate like \"width>=256 && weight<0.5\" selects by properties built with columns=1\n"
 "hugefile -t -d database\n"
 "\tperform consistency check, report out to stderr\n"
 "hugefile -p -d database -o outfile\n"
 "\tdump structure to loooong text file\n"
-"hugefile -i -d database\n"
-"\tprint base statistic to stderr\n"
+"hugefile -i -d database [-s stride]\n"
+"\tprint base statistic to stderr, page cache residency of files is sampled by one page every stride bytes (0 for all, default 262144)\n"
 "hugefile -r -d database -o repaired_database\n"
 "\trepair database by copy to another database\n"
-"hugefile -l -d database -o filelist\n"
+"hugefile -l -d database -o filelist [-f filter] [-q predicate]\n"
 "\tgenerate filelist from database\n"
+"hugefile -w -d database -s accessmap\n"
+"\tread items recorded in accessmap (see examples/http -r) into page cache\n"
+"hugefile -g -d database -s namelist -o outfile [-k hotlist] [-A depth]\n"
+"hugefile -g -d database -n count -o outfile [-k hotlist]\n"
+"\tlook up names of namelist (first field of filelist line) and write name<TAB>size<TAB>checksum of content per found one\n"
+"\twith -n names are count draws of weighted sampler (build option sample) with fixed seed instead\n"
+"\twith -A read content through io_uring with depth reads in flight after dropping it from page cache, lines come in completion order\n"
+"\twith -k count lookups and save hottest names as TSV for build option hot, empty line of namelist halves counts so far\n"
 "\n";
 
 //"\t-a -d database -s source_filelist -o output_database\n"
@@ -49,13 +101,15 @@ static const char* usage="hugefle manipulation program\n"
 // join databases -j db1 db2 db3 ....
 
 
-static int main_create(const char* database,const char* source);
-static int main_extract(const char* database,const char* output,const char* filter);
+static int main_create(const char* database,const char* source,char** opts,size_t opts_cnt);
+static int main_extract(const char* database,const char* output,const char* filter,const char* query);
 static int main_test(const char* database);
 static int main_dump(const char* database,const char* output);
-static int main_stat(const char* database);
+static int main_stat(const char* database,const char* stride);
 static int main_repair(const char* database,const char* output);
-static int main_list(const char* database,const char* output);
+static int main_list(const char* database,const char* output,const char* filter,const char* query);
+static int main_warm(const char* database,const char* source);
+static int main_get(const char* database,const char* source,const char* output,const char* hot,const char* draws,const char* depth);
 static int main_memcache(const char* source);
 static int main_append(const char* database,const char* source,const char* output);
 static int main_join(const char* database1,const char* database2,const char* output);
@@ -74,10 +128,16 @@ int main(int ac,char** av)
   char* source=0;
   char* output=0;
   char* filter=0;
+  char* query=0;
+  char* hot=0;
+  char* draws=0;
+  char* depth=0;
+  char* opts[MAIN_MAX_OPTS];
+  size_t opts_cnt=0;
 
   opterr=0;
 
-  while((c=getopt(ac,av,"hcxtpirlad:s:o:f:"))!=-1)
+  while((c=getopt(ac,av,"hcxtpirlawgd:s:o:f:q:k:n:A:O:"))!=-1)
     switch(c)
     {
       case 'h':
@@ -92,6 +152,8 @@ int main(int ac,char** av)
       case 'r':
       case 'l':
       case 'a':
+      case 'w':
+      case 'g':
         if(command)
         {
           log("mutual exclusive commands -%c and -%c",command,c);
@@ -107,6 +169,18 @@ int main(int ac,char** av)
       case 'f':
         filter=optarg;
         continue;
+      case 'q':
+        query=optarg;
+        continue;
+      case 'k':
+        hot=optarg;
+        continue;
+      case 'n':
+        draws=optarg;
+        continue;
+      case 'A':
+        depth=optarg;
+        continue;
 
       case 's':
         source=optarg;
@@ -114,6 +188,14 @@ int main(int ac,char** av)
       case 'o':
         output=optarg;
         continue;
+      case 'O':
+        if(opts_cnt>=MAIN_MAX_OPTS)
+        {
+          log("too many options");
+          return 1;
+        }
+        opts[opts_cnt++]=optarg;
+        continue;
 /*
       case 'm':
         if(command)
@@ -133,22 +215,31 @@ int main(int ac,char** av)
     }
 
 
+  if(command!='c')
+    for(size_t i=0;i<opts_cnt;i++)
+      if(hfile_open_opt_set(&open_opt,opts[i]))
+        return 1;
+
   switch(command)
   {
     case 'c':
-      return main_create(database,source);
+      return main_create(database,source,opts,opts_cnt);
     case 'x':
-      return main_extract(database,output,filter);
+      return main_extract(database,output,filter,query);
     case 't':
       return main_test(database);
     case 'p':
       return main_dump(database,output);
     case 'i':
-      return main_stat(database);
+      return main_stat(database,source);
     case 'r':
       return main_repair(database,output);
     case 'l':
-      return main_list(database,output);
+      return main_list(database,output,filter,query);
+    case 'w':
+      return main_warm(database,source);
+    case 'g':
+      return main_get(database,source,output,hot,draws,depth);
     case 'm':
       return main_memcache(source);
     case 'a':
@@ -161,22 +252,67 @@ int main(int ac,char** av)
 
 
 
-static int main_create(const char* database,const char* source)
+static int main_create(const char* database,const char* source,char** opts,size_t opts_cnt)
 {
-  int ret=hfile_build(database,source,0);
+  hfile_build_opt_t opt;
+  memset(&opt,0,sizeof(opt));
+  for(size_t i=0;i<opts_cnt;i++)
+    if(hfile_build_opt_set(&opt,opts[i]))
+      return 1;
+
+  int ret=hfile_build_ex(database,source,&opt);
   log("database \"%s\" build %ssuccessfull",database,ret ? "un" : "");
   return ret;
 }
 
-static int main_extract(const char* database,const char* output,const char* filter)
+//! names matching glob and predicate, sel is 0 if there are none of them
+static int main_select(const hfile_t* hf,const char* filter,const char* query,bitmap_t** sel)
 {
-  hfile_t* hf=hfile_open(database);
+  *sel=0;
+  if((!filter || !*filter) && !query)  return 0;
+
+  bitmap_t* rv=bitmap_init(hfile_name_count(hf));
+  if(query && hfile_filter(hf,query,rv))
+  {
+    log("can not evaluate predicate \"%s\"",query);
+    bitmap_free(rv);
+    return -1;
+  }
+  if(filter && *filter)
+  {
+    bitmap_t* g=bitmap_init(hfile_name_count(hf));
+    if(hfile_glob(hf,filter,g)<0)
+    {
+      log("can not match names by \"%s\"",filter);
+      bitmap_free(g);
+      bitmap_free(rv);
+      return -1;
+    }
+    for(size_t w=0;w<bitmap_words(rv->bits);w++)
+      rv->data[w]=query ? rv->data[w]&g->data[w] : g->data[w];
+    bitmap_free(g);
+  }
+  log("%zu names selected",bitmap_count(rv));
+  *sel=rv;
+  return 0;
+}
+
+static int main_extract(const char* database,const char* output,const char* filter,const char* query)
+{
+  hfile_t* hf=hfile_open_ex(database,&open_opt);
   if(!hf)
   {
     log("fail to open database \"%s\"",database);
     return 1;
   }
-  int ret=hfile_extract(hf,output,filter,0777);
+  bitmap_t* sel=0;
+  if(main_select(hf,filter,query,&sel))
+  {
+    hfile_free(hf);
+    return 1;
+  }
+  int ret=hfile_extract_ex(hf,output,0,sel,0777);
+  bitmap_free(sel);
   hfile_free(hf);
 
   if(ret)
@@ -192,7 +328,7 @@ static int main_test(const char* database)
 
 static int main_dump(const char* database,const char* output)
 {
-  hfile_t* hf=hfile_open(database);
+  hfile_t* hf=hfile_open_ex(database,&open_opt);
   if(!hf)
   {
     log("can not open database <%s>",database);
@@ -203,15 +339,15 @@ static int main_dump(const char* database,const char* output)
   return ret;
 }
 
-static int main_stat(const char* database)
+static int main_stat(const char* database,const char* stride)
 {
-  hfile_t* hf=hfile_open(database);
+  hfile_t* hf=hfile_open_ex(database,&open_opt);
   if(!hf)
   {
     log("can not open database <%s>",database);
     return -1;
   }
-  int ret=hfile_stat(hf);
+  int ret=stride ? hfile_stat_ex(hf,strtoull(stride,0,0)) : hfile_stat(hf);
   hfile_free(hf);
   return ret;
   return 0;
@@ -223,20 +359,253 @@ static int main_repair(const char* database,const char* output)
   return 0;
 }
 
-static int main_list(const char* database,const char* output)
+static int main_list(const char* database,const char* output,const char* filter,const char* query)
+{
+  hfile_t* hf=hfile_open_ex(database,&open_opt);
+  if(!hf)
+  {
+    log("can not open database <%s>",database);
+    return -1;
+  }
+
+  bitmap_t* sel=0;
+  if(main_select(hf,filter,query,&sel))
+  {
+    hfile_free(hf);
+    return -1;
+  }
+  int ret=hfile_genlist_ex(hf,output,sel);
+  bitmap_free(sel);
+  hfile_free(hf);
+  return ret;
+}
+
+static int main_warm(const char* database,const char* source)
 {
-  hfile_t* hf=hfile_open(database);
+  hfile_t* hf=hfile_open_ex(database,&open_opt);
   if(!hf)
   {
     log("can not open database <%s>",database);
     return -1;
   }
 
-  int ret=hfile_genlist(hf,output);
+  prewarm_t* p=prewarm_load(source);
+  if(!p)
+  {
+    log("can not load access map <%s>",source);
+    hfile_free(hf);
+    return -1;
+  }
+
+  int ret=prewarm_replay(hf,p);
+  prewarm_free(p);
   hfile_free(hf);
   return ret;
 }
 
+//! write found content line
+static int main_get_write(FILE* f,const char* name,const void* data,uint64_t size)
+{
+  uint8_t cs[CHECKSUM_SIZE];
+  char hex[2*CHECKSUM_SIZE+1];
+  checksum_t* c=checksum_init();
+  checksum_update(c,(uint8_t*)data,size);
+  checksum_finalize(c,cs);
+  utils_bin2hex(hex,cs,CHECKSUM_SIZE);
+  return fprintf(f,"%s\t%zu\t%s\n",name,(size_t)size,hex)<0 ? -1 : 0;
+}
+
+//! write results of batch and free them
+static int main_get_flush(FILE* f,hfile_ret_t** ret,size_t cnt)
+{
+  int rv=0;
+  for(size_t i=0;i<cnt;i++)
+  {
+    rv|=main_get_write(f,ret[i]->name,ret[i]->content,ret[i]->size);
+    hfile_ret_free(ret[i]);
+  }
+  return rv;
+}
+
+//! look name up into batch, write batch when it is full
+static int main_get_one(const hfile_t* hf,const char* name,FILE* out,hfile_ret_t** ret,size_t* cnt,size_t* missing)
+{
+  if(!name || !(ret[*cnt]=hfile_get(hf,name)))
+  {
+    (*missing)++;
+    return 0;
+  }
+  if(++*cnt<MAIN_GET_BATCH)  return 0;
+  *cnt=0;
+  return main_get_flush(out,ret,MAIN_GET_BATCH);
+}
+
+//! read content of namelist through aio, results come in completion order.
+//! content is dropped from page cache first and buffers start small, so ring reads, bounce buffers and -ENOBUFS retries run
+static int main_get_aio(const char* database,const hfile_t* hf,FILE* in,FILE* out,uint32_t depth,size_t* missing)
+{
+  char* path=0;
+  asprintf(&path,"%s/data.content",database);
+  int fd=open(path,O_RDONLY);
+  if(fd>=0)
+  {
+// dirty pages of fresh build stay in cache, write them first
+    fdatasync(fd);
+    posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+  free(path);
+
+  aio_t* a=aio_init(hf,depth,0);
+  if(!a)
+  {
+    log("can not init asynchronous reads");
+    return -1;
+  }
+  depth=depth ? depth : AIO_DEPTH;
+  uint8_t** buf=md_anew(buf,depth);
+  size_t* size=md_anew(size,depth);
+  uint32_t* spare=md_anew(spare,depth);
+  uint32_t spares=depth;
+  for(uint32_t i=0;i<depth;i++)
+    spare[i]=i;
+  aio_done_t* done=md_anew(done,depth);
+
+  int rv=0,eof=0;
+  char* bf=0;
+  size_t z=0;
+  while(!rv && (!eof || aio_pending(a)))
+  {
+    if(!eof && spares)
+    {
+      if(getline(&bf,&z,in)<0)
+      {
+        eof=1;
+        continue;
+      }
+      char* name=bf;
+      name=strsep(&name,"\t\n\r");
+      if(!*name)  continue;
+      uint32_t s=spare[--spares];
+      if(!buf[s])  buf[s]=md_malloc(size[s]=1024);
+      if(!aio_submit(a,name,buf[s],size[s],s))  continue;
+      log("can not submit read of <%s>",name);
+      rv=-1;
+      break;
+    }
+
+    ssize_t n=aio_reap(a,done,depth,1);
+    for(ssize_t i=0;i<n && !rv;i++)
+    {
+      aio_done_t* d=done+i;
+      uint32_t s=d->user;
+      if(d->err==-ENOBUFS)
+      {
+        buf[s]=md_realloc(buf[s],size[s]=d->size);
+        if(!aio_submit_idx(a,d->idx,buf[s],size[s],s))  continue;
+        rv=-1;
+      }
+      else if(d->err==-ENOENT)
+        (*missing)++;
+      else if(d->err)
+      {
+        log("read of name %zd failed: %s",d->idx,strerror(-d->err));
+        rv=-1;
+      }
+      else
+        rv=main_get_write(out,hfile_name_by_idx(hf,d->idx),d->data,d->size);
+      spare[spares++]=s;
+    }
+    if(n<0)  rv=-1;
+  }
+
+  aio_free(a);
+  for(uint32_t i=0;i<depth;i++)
+    free(buf[i]);
+  free(buf);
+  free(size);
+  free(spare);
+  free(done);
+  free(bf);
+  return rv;
+}
+
+static int main_get(const char* database,const char* source,const char* output,const char* hot,const char* draws,const char* depth)
+{
+  if((!source && !draws) || !output || (depth && !source))
+  {
+    log("namelist or count of draws and output are required, asynchronous reads take namelist");
+    return -1;
+  }
+  FILE* in=source ? fopen(source,"r") : 0;
+  if(source && !in)
+  {
+    log("can not open namelist <%s>",source);
+    return -1;
+  }
+  FILE* out=fopen(output,"w");
+  if(!out)
+  {
+    log("can not create <%s>",output);
+    if(in)  fclose(in);
+    return -1;
+  }
+  hfile_t* hf=hfile_open_ex(database,&open_opt);
+  if(!hf)
+  {
+    log("can not open database <%s>",database);
+    fclose(out);
+    if(in)  fclose(in);
+    return -1;
+  }
+  hotkey_t* keys=hot ? hotkey_init(hf,0,0) : 0;
+  if(keys)  hotkey_attach(hf,keys);
+
+  hfile_ret_t* ret[MAIN_GET_BATCH];
+  size_t cnt=0,missing=0;
+  int rv=depth ? main_get_aio(database,hf,in,out,strtoul(depth,0,0),&missing) : 0;
+  char* bf=0;
+  size_t z=0;
+  while(in && !depth && !rv && getline(&bf,&z,in)>=0)
+  {
+    char* name=bf;
+    name=strsep(&name,"\t\n\r");
+    if(!*name)
+      hotkey_decay(keys,1);
+    else
+      rv=main_get_one(hf,name,out,ret,&cnt,&missing);
+  }
+
+// draws of weighted sampler, fixed seed keeps output reproducible
+  hfile_rng_t rng;
+  hfile_rng_seed(&rng,1);
+  uint32_t idx[MAIN_GET_BATCH];
+  for(uint64_t left=draws ? strtoull(draws,0,0) : 0;left && !rv;)
+  {
+    size_t n=left<MAIN_GET_BATCH ? left : MAIN_GET_BATCH;
+    if(hfile_sample_batch(hf,&rng,idx,n)<0)
+    {
+      log("database has no weighted sampler");
+      rv=-1;
+      break;
+    }
+    for(size_t i=0;i<n && !rv;i++)
+      rv=main_get_one(hf,hfile_name_by_idx(hf,idx[i]),out,ret,&cnt,&missing);
+    left-=n;
+  }
+
+  rv|=main_get_flush(out,ret,cnt);
+  if(missing)  log("%zu names not found",missing);
+  if(keys)  rv|=hotkey_save(keys,hf,hot);
+
+  free(bf);
+  hotkey_free(hotkey_detach(hf));
+  hfile_free(hf);
+  rv|=fclose(out);
+  if(in)  fclose(in);
+  return rv ? -1 : 0;
+}
+
 static int main_memcache(const char* source)
 {
   log("sorry, not yet implemented");
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "common.h"
+#include "utils.h"
+#include "metrics.h"
+
+
+uint64_t metrics_now(void)
+{
+  struct timespec tm;
+  clock_gettime(CLOCK_MONOTONIC,&tm);
+  return tm.tv_sec*1000000000ULL+tm.tv_nsec;
+}
+
+static uint64_t metrics_cpu(void)
+{
+  struct timespec tm;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID,&tm);
+  return tm.tv_sec*1000000000ULL+tm.tv_nsec;
+}
+
+
+metrics_t* metrics_init(uint32_t progress)
+{
+  metrics_t* rv=md_new(rv);
+  rv->started=rv->progress_last=metrics_now();
+  rv->progress_ns=progress*1000000000ULL;
+  return rv;
+}
+
+void metrics_free(metrics_t* m)
+{
+  free(m);
+}
+
+
+metrics_phase_t* metrics_phase(metrics_t* m,const char* name)
+{
+  for(size_t i=0;i<m->phases;i++)
+    if(!strcmp(m->phase[i].name,name))
+      return m->phase+i;
+  if(m->phases>=METRICS_PHASES)
+    crash("too many phases");
+  metrics_phase_t* rv=m->phase+m->phases++;
+  memset(rv,0,sizeof(*rv));
+  rv->name=name;
+  rv->cpu_ns=METRICS_NO_CPU;
+  return rv;
+}
+
+void metrics_begin(metrics_phase_t* p)
+{
+  p->wall_start=metrics_now();
+  p->cpu_start=metrics_cpu();
+}
+
+void metrics_end(metrics_phase_t* p,uint64_t items,uint64_t bytes)
+{
+  if(p->cpu_ns==METRICS_NO_CPU)  p->cpu_ns=0;
+  p->cpu_ns+=metrics_cpu()-p->cpu_start;
+  p->wall_ns+=metrics_now()-p->wall_start;
+  p->items+=items;
+  p->bytes+=bytes;
+}
+
+void metrics_add(metrics_phase_t* p,uint64_t since,uint64_t items,uint64_t bytes)
+{
+  p->wall_ns+=metrics_now()-since;
+  p->items+=items;
+  p->bytes+=bytes;
+}
+
+
+static size_t metrics_bucket(uint64_t size)
+{
+  size_t rv=size ? 64-__builtin_clzll(size) : 0;
+  return rv<METRICS_BUCKETS ? rv : METRICS_BUCKETS-1;
+}
+
+void metrics_source(metrics_t* m,uint64_t size,int stored)
+{
+  size_t b=metrics_bucket(size);
+  m->sources++;
+  m->bytes_in+=size;
+  m->hist_sources[b]++;
+  if(!size)  m->empty++;
+  if(stored)
+  {
+    m->unique++;
+    m->bytes_stored+=size;
+    m->hist_unique[b]++;
+  }
+  else
+    m->dedup_hits++;
+}
+
+void metrics_pieces(metrics_t* m,uint64_t pieces,uint64_t hits,uint64_t dup_bytes)
+{
+  m->chunked++;
+  m->pieces+=pieces;
+  m->piece_hits+=hits;
+  m->bytes_stored-=dup_bytes;
+}
+
+
+//! format duration in ms to bf
+static const char* metrics_time(char* bf,size_t size,uint64_t ms)
+{
+  char* tm=utils_time_format(ms);
+  snprintf(bf,size,"%s",tm ? tm : "");
+  free(tm);
+  return bf;
+}
+
+void metrics_progress(metrics_t* m,uint64_t done,uint64_t total,uint64_t bytes)
+{
+  if(!m->progress_ns)  return;
+  uint64_t now=metrics_now();
+  if(now-m->progress_last<m->progress_ns)  return;
+  m->progress_last=now;
+
+  double sec=(now-m->started)/1e9;
+  double rate=sec>0 ? done/sec : 0;
+  uintmax_t eta=(rate>0 && total>done) ? (total-done)/rate*1000 : 0;
+  char tm[64];
+  log("progress: %.2f%% %ju/%ju items, %.0f items/s, %.2f MB/s, missing %ju, dedup %ju, eta %s",
+      total ? 100.0*done/total : 0.0,(uintmax_t)done,(uintmax_t)total,rate,sec>0 ? bytes/sec/1e6 : 0.0,
+      (uintmax_t)m->missing,(uintmax_t)m->dedup_hits,metrics_time(tm,sizeof(tm),eta));
+}
+
+
+void metrics_print(const metrics_t* m)
+{
+  log("phase\twall\tcpu/wall\titems/s\tMB/s");
+  char tm[64];
+  for(size_t i=0;i<m->phases;i++)
+  {
+    const metrics_phase_t* p=m->phase+i;
+    double sec=p->wall_ns/1e9;
+    if(p->cpu_ns==METRICS_NO_CPU)
+      log("%s\t%s\t-\t%.0f\t%.2f",p->name,metrics_time(tm,sizeof(tm),p->wall_ns/1000000),
+          sec>0 ? p->items/sec : 0.0,sec>0 ? p->bytes/sec/1e6 : 0.0);
+    else
+      log("%s\t%s\t%.2f\t%.0f\t%.2f",p->name,metrics_time(tm,sizeof(tm),p->wall_ns/1000000),
+          p->wall_ns ? (double)p->cpu_ns/p->wall_ns : 0.0,sec>0 ? p->items/sec : 0.0,sec>0 ? p->bytes/sec/1e6 : 0.0);
+  }
+  log("sources %ju, missing %ju, skipped %ju, empty %ju, unique %ju, dedup hits %ju (%.2f%%), bytes in %ju, stored %ju",
+      (uintmax_t)m->sources,(uintmax_t)m->missing,(uintmax_t)m->skipped,(uintmax_t)m->empty,(uintmax_t)m->unique,
+      (uintmax_t)m->dedup_hits,m->sources ? 100.0*m->dedup_hits/m->sources : 0.0,(uintmax_t)m->bytes_in,(uintmax_t)m->bytes_stored);
+  if(m->chunked)
+    log("chunked sources %ju, pieces %ju, piece dedup hits %ju (%.2f%%)",(uintmax_t)m->chunked,(uintmax_t)m->pieces,
+        (uintmax_t)m->piece_hits,100.0*m->piece_hits/m->pieces);
+}
+
+
+int metrics_save(const metrics_t* m,const char* fn)
+{
+  if(!m || !fn || !*fn)  return -1;
+  FILE* f=fopen(fn,"w");
+  if(!f)
+  {
+    log("can not create report <%s>: %s",fn,strerror(errno));
+    return -1;
+  }
+
+  fprintf(f,"{\n  \"format\": 1,\n  \"wall_ns\": %ju,\n  \"phases\": [\n",(uintmax_t)(metrics_now()-m->started));
+  for(size_t i=0;i<m->phases;i++)
+  {
+    const metrics_phase_t* p=m->phase+i;
+    double sec=p->wall_ns/1e9;
+    fprintf(f,"    { \"name\": \"%s\", \"wall_ns\": %ju, ",p->name,(uintmax_t)p->wall_ns);
+    if(p->cpu_ns==METRICS_NO_CPU)
+      fprintf(f,"\"cpu_ns\": null, ");
+    else
+      fprintf(f,"\"cpu_ns\": %ju, ",(uintmax_t)p->cpu_ns);
+    fprintf(f,"\"items\": %ju, \"bytes\": %ju, \"items_per_s\": %.1f, \"bytes_per_s\": %.1f }%s\n",
+            (uintmax_t)p->items,(uintmax_t)p->bytes,sec>0 ? p->items/sec : 0.0,sec>0 ? p->bytes/sec : 0.0,
+            i+1<m->phases ? "," : "");
+  }
+  fprintf(f,"  ],\n");
+
+  fprintf(f,"  \"sources\": { \"processed\": %ju, \"missing\": %ju, \"skipped\": %ju, \"empty\": %ju },\n",
+          (uintmax_t)m->sources,(uintmax_t)m->missing,(uintmax_t)m->skipped,(uintmax_t)m->empty);
+  fprintf(f,"  \"dedup\": { \"unique\": %ju, \"hits\": %ju, \"hit_ratio\": %.6f, \"bytes_in\": %ju, \"bytes_stored\": %ju },\n",
+          (uintmax_t)m->unique,(uintmax_t)m->dedup_hits,m->sources ? (double)m->dedup_hits/m->sources : 0.0,
+          (uintmax_t)m->bytes_in,(uintmax_t)m->bytes_stored);
+  fprintf(f,"  \"chunking\": { \"sources\": %ju, \"pieces\": %ju, \"hits\": %ju },\n",
+          (uintmax_t)m->chunked,(uintmax_t)m->pieces,(uintmax_t)m->piece_hits);
+
+  fprintf(f,"  \"size_histogram\": [\n");
+  size_t last=0;
+  for(size_t i=0;i<METRICS_BUCKETS;i++)
+    if(m->hist_sources[i])  last=i;
+  for(size_t i=0;i<=last;i++)
+    fprintf(f,"    { \"below\": %ju, \"sources\": %ju, \"unique\": %ju }%s\n",
+            (uintmax_t)(i ? 1ULL<<i : 1),(uintmax_t)m->hist_sources[i],(uintmax_t)m->hist_unique[i],i<last ? "," : "");
+  fprintf(f,"  ]\n}\n");
+
+  if(fclose(f))
+  {
+    log("can not write report <%s>: %s",fn,strerror(errno));
+    return -1;
+  }
+  return 0;
+}
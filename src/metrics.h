@@ -0,0 +1,77 @@
+//! \file
+//! \brief build telemetry: per phase rates, source counters, size histograms, live progress
+
+//! maximal count of phases
+#define METRICS_PHASES		16
+//! count of log2 size buckets
+#define METRICS_BUCKETS		34
+//! default progress interval in seconds
+#define METRICS_PROGRESS	10
+
+//! phase accumulator
+typedef struct metrics_phase_t
+{
+  const char* name;
+  uint64_t wall_ns;			//!< wall time
+  uint64_t cpu_ns;			//!< process cpu time (all threads), METRICS_NO_CPU if not measured
+  uint64_t items;
+  uint64_t bytes;
+  uint64_t wall_start;			//!< internal, begin mark
+  uint64_t cpu_start;			//!< internal, begin mark
+} metrics_phase_t;
+
+#define METRICS_NO_CPU		((uint64_t)-1)
+
+typedef struct metrics_t
+{
+  metrics_phase_t phase[METRICS_PHASES];
+  size_t phases;
+
+  uint64_t sources;			//!< filelist lines processed
+  uint64_t missing;			//!< sources not found
+  uint64_t skipped;			//!< sources found but not readable
+  uint64_t empty;			//!< zero size sources
+  uint64_t dedup_hits;			//!< sources with content already stored
+  uint64_t unique;			//!< stored contents
+  uint64_t bytes_in;			//!< sum of source sizes
+  uint64_t bytes_stored;		//!< sum of stored content sizes
+  uint64_t chunked;			//!< stored sources split to pieces
+  uint64_t pieces;			//!< pieces of them
+  uint64_t piece_hits;			//!< pieces already stored
+  uint64_t hist_sources[METRICS_BUCKETS];	//!< source sizes, bucket i holds sizes in [2^(i-1),2^i)
+  uint64_t hist_unique[METRICS_BUCKETS];	//!< stored content sizes
+
+  uint64_t started;			//!< wall time of init
+  uint64_t progress_ns;			//!< progress interval, 0 disabled
+  uint64_t progress_last;		//!< last progress print
+} metrics_t;
+
+//! ctr, progress in seconds, 0 disable progress
+metrics_t* metrics_init(uint32_t progress);
+//! dtr
+void metrics_free(metrics_t*);
+
+//! monotonic wall clock in ns
+uint64_t metrics_now(void);
+
+//! get phase by name, create if absent
+metrics_phase_t* metrics_phase(metrics_t* m,const char* name);
+//! start phase with wall and cpu measurement
+void metrics_begin(metrics_phase_t* p);
+//! finish phase started by metrics_begin
+void metrics_end(metrics_phase_t* p,uint64_t items,uint64_t bytes);
+//! add wall time since given metrics_now() mark, cheap enough to be called per item
+void metrics_add(metrics_phase_t* p,uint64_t since,uint64_t items,uint64_t bytes);
+
+//! account source of given size, stored is 1 if content is new
+void metrics_source(metrics_t* m,uint64_t size,int stored);
+//! account new source stored as pieces, hits of them with dup_bytes were stored before
+void metrics_pieces(metrics_t* m,uint64_t pieces,uint64_t hits,uint64_t dup_bytes);
+
+//! print progress line if interval passed
+void metrics_progress(metrics_t* m,uint64_t done,uint64_t total,uint64_t bytes);
+
+//! print summary to stderr
+void metrics_print(const metrics_t* m);
+//! write JSON report
+int metrics_save(const metrics_t* m,const char* fn);
@@ -0,0 +1,570 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "common.h"
+#include "utils.h"
+#include "mph.h"
+
+//! buckets count is MPH_C*n/log2(n)
+#define MPH_C			5.0
+//! share of keys going to dense buckets, 0.6*2^64
+#define MPH_DENSE_KEYS		0x999999999999999aULL
+//! share of buckets which are dense, in percents
+#define MPH_DENSE_BUCKETS	30
+//! give up if bucket pilot not found
+#define MPH_MAX_PILOT		(1U<<24)
+//! attempts to build partition with different salt
+#define MPH_TRIES		4
+//! padding of pilot array for unaligned 64 bit reads
+#define MPH_PAD			8
+//! hashes buffered per partition while spilling
+#define MPH_SPILL		256
+
+#define MPH_P0	0xa0761d6478bd642fULL
+#define MPH_P1	0xe7037ed1a0b428dbULL
+#define MPH_P2	0x8ebc6af09c88c6e3ULL
+#define MPH_P3	0x589965cc75374cc3ULL
+#define MPH_PILOT	0x9e3779b97f4a7c15ULL
+
+//! one partition
+typedef struct mph_part_t
+{
+  uint64_t n;				//!< count of keys
+  uint64_t table;			//!< table size, slightly above n
+  uint64_t buckets;			//!< count of buckets
+  uint64_t dense;			//!< count of dense buckets
+  uint64_t salt;			//!< mixed into positions, changed on retry
+  uint32_t width;			//!< bits per pilot
+  uint8_t* pilots;			//!< packed pilots, MPH_PAD bytes padded
+  uint32_t* remap;			//!< free slot below n for each table slot above n
+} mph_part_t;
+
+struct mph_t
+{
+  uint64_t seed;			//!< key hash seed
+  uint64_t n;				//!< count of keys
+  uint64_t parts;			//!< count of partitions
+  uint64_t* offset;			//!< first index of partition, parts+1 items
+  mph_part_t* part;
+};
+
+
+static inline uint64_t mph_mix(uint64_t a,uint64_t b)
+{
+  __uint128_t r=(__uint128_t)a*b;
+  return (uint64_t)r^(uint64_t)(r>>64);
+}
+
+static inline uint64_t mph_fmix(uint64_t k)
+{
+  k^=k>>33;
+  k*=0xff51afd7ed558ccdULL;
+  k^=k>>33;
+  k*=0xc4ceb9fe1a85ec53ULL;
+  k^=k>>33;
+  return k;
+}
+
+//! map x uniformly to [0,n)
+static inline uint64_t mph_range(uint64_t x,uint64_t n)
+{
+  return ((__uint128_t)x*n)>>64;
+}
+
+static inline uint64_t mph_bucket(const mph_part_t* m,uint64_t h1)
+{
+  uint64_t r=h1<<32 | h1>>32;
+  return h1<MPH_DENSE_KEYS ? mph_range(r,m->dense) : m->dense+mph_range(r,m->buckets-m->dense);
+}
+
+static inline uint64_t mph_pos(const mph_part_t* m,uint64_t h2,uint64_t pilot)
+{
+  return mph_range(mph_fmix(h2^m->salt^(pilot*MPH_PILOT)),m->table);
+}
+
+static inline uint64_t mph_pilot(const mph_part_t* m,uint64_t b)
+{
+  uint64_t bit=b*m->width;
+  uint64_t w;
+  memcpy(&w,m->pilots+(bit>>3),sizeof(w));
+  return (w>>(bit&7)) & ((1ULL<<m->width)-1);
+}
+
+static inline uint64_t mph_partition(const mph_t* m,uint64_t h2)
+{
+  return mph_range(h2,m->parts);
+}
+
+
+mph_hash_t mph_hash(const void* key,size_t len,uint64_t seed)
+{
+  const uint8_t* p=key;
+  uint64_t a=seed^MPH_P0;
+  uint64_t b=mph_fmix(seed)^MPH_P1;
+  uint64_t x,y;
+  size_t l=len;
+
+  for(;l>=16;l-=16,p+=16)
+  {
+    memcpy(&x,p,sizeof(x));
+    memcpy(&y,p+8,sizeof(y));
+    a=mph_mix(x^MPH_P1,y^a);
+    b=mph_mix(y^MPH_P2,x^b);
+  }
+  x=y=0;
+  if(l>8)
+  {
+    memcpy(&x,p,sizeof(x));
+    memcpy(&y,p+8,l-8);
+  }
+  else
+    memcpy(&x,p,l);
+  a=mph_mix(x^MPH_P1,y^a);
+  b=mph_mix(y^MPH_P2,x^b);
+
+  mph_hash_t rv={mph_fmix(a^len),mph_fmix(b^len^MPH_P3)};
+  return rv;
+}
+
+
+static int mph_cmp64(const void* a,const void* b)
+{
+  uint64_t x=*(const uint64_t*)a;
+  uint64_t y=*(const uint64_t*)b;
+  return x<y ? -1 : x>y;
+}
+
+//! build partition, return 0 on success, 1 if pilot search failed, -1 on duplicate hashes
+static int mph_part_build(mph_part_t* m,const mph_hash_t* keys,size_t n,uint64_t salt)
+{
+  m->n=n;
+  m->table=n+(n+99)/100;
+  m->salt=salt*MPH_P3;
+  double lg=n>2 ? log2(n) : 1.0;
+  m->buckets=ceil(MPH_C*n/lg);
+  if(!m->buckets)  m->buckets=1;
+  m->dense=m->buckets*MPH_DENSE_BUCKETS/100;
+
+// counting sort of position hashes by bucket
+  uint32_t* start=md_tcalloc(uint32_t,m->buckets+1);
+  for(size_t i=0;i<n;i++)
+    start[mph_bucket(m,keys[i].h1)+1]++;
+  size_t maxsz=0;
+  for(size_t b=0;b<m->buckets;b++)
+  {
+    if(start[b+1]>maxsz)  maxsz=start[b+1];
+    start[b+1]+=start[b];
+  }
+
+  uint64_t* h2=md_tmalloc(uint64_t,n+1);
+  uint32_t* fill=md_tmalloc(uint32_t,m->buckets);
+  memcpy(fill,start,m->buckets*sizeof(uint32_t));
+  for(size_t i=0;i<n;i++)
+    h2[fill[mph_bucket(m,keys[i].h1)]++]=keys[i].h2;
+
+// largest buckets first
+  uint32_t* order=fill;
+  uint32_t* bysize=md_tcalloc(uint32_t,maxsz+2);
+  for(size_t b=0;b<m->buckets;b++)
+    bysize[maxsz-(start[b+1]-start[b])+1]++;
+  for(size_t s=0;s<=maxsz;s++)
+    bysize[s+1]+=bysize[s];
+  for(size_t b=0;b<m->buckets;b++)
+    order[bysize[maxsz-(start[b+1]-start[b])]++]=b;
+  free(bysize);
+
+  uint32_t* pilot=md_tcalloc(uint32_t,m->buckets);
+  uint64_t* taken=md_tcalloc(uint64_t,m->table/64+1);
+  uint64_t* pos=md_tmalloc(uint64_t,maxsz+1);
+  uint32_t maxpilot=0;
+  int rv=0;
+
+  for(size_t i=0;i<m->buckets && !rv;i++)
+  {
+    uint32_t b=order[i];
+    size_t sz=start[b+1]-start[b];
+    if(!sz)  break;
+    uint64_t* h=h2+start[b];
+
+    qsort(h,sz,sizeof(*h),mph_cmp64);
+    for(size_t j=1;j<sz;j++)
+      if(h[j]==h[j-1])
+      {
+        rv=-1;
+        break;
+      }
+
+    for(uint32_t p=0;!rv;p++)
+    {
+      if(p>=MPH_MAX_PILOT)
+      {
+        rv=1;
+        break;
+      }
+      size_t j;
+      for(j=0;j<sz;j++)
+      {
+        uint64_t q=mph_pos(m,h[j],p);
+        if(taken[q>>6] & (1ULL<<(q&63)))  break;
+        taken[q>>6]|=1ULL<<(q&63);
+        pos[j]=q;
+      }
+      if(j==sz)
+      {
+        pilot[b]=p;
+        if(p>maxpilot)  maxpilot=p;
+        break;
+      }
+      while(j--)
+        taken[pos[j]>>6]&=~(1ULL<<(pos[j]&63));
+    }
+  }
+
+  free(pos);
+  free(order);
+  free(h2);
+  free(start);
+
+  if(rv)
+  {
+    free(taken);
+    free(pilot);
+    return rv;
+  }
+
+  m->width=1;
+  while(maxpilot>>m->width)  m->width++;
+  m->pilots=md_calloc((m->buckets*m->width+7)/8+MPH_PAD);
+  for(uint64_t b=0;b<m->buckets;b++)
+  {
+    uint64_t bit=b*m->width;
+    uint64_t w;
+    memcpy(&w,m->pilots+(bit>>3),sizeof(w));
+    w|=(uint64_t)pilot[b]<<(bit&7);
+    memcpy(m->pilots+(bit>>3),&w,sizeof(w));
+  }
+  free(pilot);
+
+// slots above n are redirected to free slots below n
+  m->remap=md_tcalloc(uint32_t,m->table-m->n+1);
+  uint64_t f=0;
+  for(uint64_t q=m->n;q<m->table;q++)
+  {
+    if(!(taken[q>>6] & (1ULL<<(q&63))))  continue;
+    while(taken[f>>6] & (1ULL<<(f&63)))  f++;
+    m->remap[q-m->n]=f++;
+  }
+  free(taken);
+
+  return 0;
+}
+
+//! build partition retrying with other salts
+static int mph_part_init(mph_part_t* m,const mph_hash_t* keys,size_t n)
+{
+  int rv=1;
+  for(uint64_t salt=0;rv>0 && salt<MPH_TRIES;salt++)
+    rv=mph_part_build(m,keys,n,salt);
+  return rv;
+}
+
+static void mph_part_free(mph_part_t* m)
+{
+  free(m->pilots);
+  free(m->remap);
+}
+
+static inline uint64_t mph_part_search(const mph_part_t* m,mph_hash_t h)
+{
+  uint64_t q=mph_pos(m,h.h2,mph_pilot(m,mph_bucket(m,h.h1)));
+  return q<m->n ? q : m->remap[q-m->n];
+}
+
+
+//! state shared by construction threads
+typedef struct mph_build_t
+{
+  mph_t* m;
+  int fd;				//!< spilled hashes grouped by partition
+  atomic_size_t next;			//!< next partition to build
+  atomic_int failed;
+} mph_build_t;
+
+static int mph_pread(int fd,void* bf,size_t sz,off_t off)
+{
+  for(size_t done=0;done<sz;)
+  {
+    ssize_t r=pread(fd,bf+done,sz-done,off+done);
+    if(r<=0)  return -1;
+    done+=r;
+  }
+  return 0;
+}
+
+static int mph_pwrite(int fd,const void* bf,size_t sz,off_t off)
+{
+  for(size_t done=0;done<sz;)
+  {
+    ssize_t r=pwrite(fd,bf+done,sz-done,off+done);
+    if(r<=0)  return -1;
+    done+=r;
+  }
+  return 0;
+}
+
+static void* mph_worker(void* arg)
+{
+  mph_build_t* b=arg;
+  mph_t* m=b->m;
+
+  for(size_t p;!atomic_load(&b->failed) && (p=atomic_fetch_add(&b->next,1))<m->parts;)
+  {
+    size_t n=m->offset[p+1]-m->offset[p];
+    mph_hash_t* keys=md_tmalloc(mph_hash_t,n+1);
+    int rv=mph_pread(b->fd,keys,n*sizeof(mph_hash_t),m->offset[p]*sizeof(mph_hash_t));
+    if(rv)
+      log("can not read spilled hashes: %s",strerror(errno));
+    else if((rv=mph_part_init(m->part+p,keys,n)))
+      log("partition %zu of %ju keys: %s",p,(uintmax_t)n,rv<0 ? "duplicate key hashes" : "pilot search failed");
+    free(keys);
+    if(rv)  atomic_store(&b->failed,1);
+  }
+  return 0;
+}
+
+//! write hashes of all keys to temporary file grouped by partition, return descriptor or -1
+static int mph_spill(mph_t* m,mph_key_f key,void* arg)
+{
+  const char* dir=getenv("TMPDIR");
+  char* fn=0;
+  asprintf(&fn,"%s/mph.XXXXXX",dir && *dir ? dir : "/tmp");
+  int fd=mkstemp(fn);
+  if(fd<0)
+  {
+    log("can not create temporary file <%s>: %s",fn,strerror(errno));
+    free(fn);
+    return -1;
+  }
+  unlink(fn);
+  free(fn);
+
+  mph_hash_t* bf=md_tmalloc(mph_hash_t,m->parts*MPH_SPILL);
+  uint32_t* fill=md_tcalloc(uint32_t,m->parts);
+  uint64_t* written=md_tcalloc(uint64_t,m->parts);
+  int rv=0;
+
+  for(size_t i=0;i<m->n && !rv;i++)
+  {
+    mph_hash_t h=key(arg,i,m->seed);
+    uint64_t p=mph_partition(m,h.h2);
+    bf[p*MPH_SPILL+fill[p]++]=h;
+    if(fill[p]<MPH_SPILL)  continue;
+    rv=mph_pwrite(fd,bf+p*MPH_SPILL,MPH_SPILL*sizeof(mph_hash_t),(m->offset[p]+written[p])*sizeof(mph_hash_t));
+    written[p]+=MPH_SPILL;
+    fill[p]=0;
+  }
+  for(size_t p=0;p<m->parts && !rv;p++)
+    rv=mph_pwrite(fd,bf+p*MPH_SPILL,fill[p]*sizeof(mph_hash_t),(m->offset[p]+written[p])*sizeof(mph_hash_t));
+
+  free(bf);
+  free(fill);
+  free(written);
+
+  if(rv)
+  {
+    log("can not spill hashes: %s",strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+mph_t* mph_init(size_t n,mph_key_f key,void* arg,uint64_t seed,const mph_opt_t* opt)
+{
+  if(!key || !n || n>=UINT32_MAX)  return 0;
+
+  size_t partition=opt && opt->partition ? opt->partition : MPH_PARTITION;
+  size_t threads=opt && opt->threads ? opt->threads : utils_getCPUs();
+
+  mph_t* m=md_new(m);
+  m->seed=seed;
+  m->n=n;
+  m->parts=(n+partition-1)/partition;
+  m->offset=md_tcalloc(uint64_t,m->parts+1);
+  m->part=md_anew(m->part,m->parts);
+
+  if(m->parts==1)
+  {
+    mph_hash_t* keys=md_tmalloc(mph_hash_t,n);
+    for(size_t i=0;i<n;i++)
+      keys[i]=key(arg,i,seed);
+    m->offset[1]=n;
+    int rv=mph_part_init(m->part,keys,n);
+    free(keys);
+    if(!rv)  return m;
+    if(rv<0)  log("duplicate key hashes");
+    mph_free(m);
+    return 0;
+  }
+
+// count partition sizes, then spill hashes and build partitions in parallel
+  for(size_t i=0;i<n;i++)
+    m->offset[mph_partition(m,key(arg,i,seed).h2)+1]++;
+  for(size_t p=0;p<m->parts;p++)
+    m->offset[p+1]+=m->offset[p];
+
+  mph_build_t b;
+  memset(&b,0,sizeof(b));
+  b.m=m;
+  if((b.fd=mph_spill(m,key,arg))<0)
+  {
+    mph_free(m);
+    return 0;
+  }
+
+  if(threads>m->parts)  threads=m->parts;
+  pthread_t* th=md_tcalloc(pthread_t,threads);
+  size_t started=0;
+  for(;started<threads;started++)
+    if(pthread_create(th+started,0,mph_worker,&b))
+      break;
+  if(!started)
+    mph_worker(&b);
+  for(size_t i=0;i<started;i++)
+    pthread_join(th[i],0);
+  free(th);
+  close(b.fd);
+
+  if(atomic_load(&b.failed))
+  {
+    mph_free(m);
+    return 0;
+  }
+  return m;
+}
+
+
+void mph_free(mph_t* m)
+{
+  if(!m)  return;
+  for(size_t p=0;m->part && p<m->parts;p++)
+    mph_part_free(m->part+p);
+  free(m->part);
+  free(m->offset);
+  free(m);
+}
+
+
+uint32_t mph_search_hash(const mph_t* m,mph_hash_t h)
+{
+  uint64_t p=mph_partition(m,h.h2);
+  return m->offset[p]+mph_part_search(m->part+p,h);
+}
+
+uint32_t mph_search(const mph_t* m,const void* key,size_t len)
+{
+  return mph_search_hash(m,mph_hash(key,len,m->seed));
+}
+
+uint64_t mph_seed(const mph_t* m)
+{
+  return m ? m->seed : 0;
+}
+
+size_t mph_size(const mph_t* m)
+{
+  return m ? m->n : 0;
+}
+
+size_t mph_parts(const mph_t* m)
+{
+  return m ? m->parts : 0;
+}
+
+size_t mph_packed_size(const mph_t* m)
+{
+  if(!m)  return 0;
+  size_t rv=sizeof(*m)+(m->parts+1)*sizeof(uint64_t);
+  for(size_t p=0;p<m->parts;p++)
+  {
+    const mph_part_t* q=m->part+p;
+    rv+=sizeof(*q)+(q->buckets*q->width+7)/8+MPH_PAD+(q->table-q->n+1)*sizeof(uint32_t);
+  }
+  return rv;
+}
+
+
+int mph_dump(const mph_t* m,FILE* f)
+{
+  if(!m || !f)  return -1;
+
+  if(fwrite(&m->seed,sizeof(m->seed),1,f)!=1)  return -1;
+  if(fwrite(&m->n,sizeof(m->n),1,f)!=1)  return -1;
+  if(fwrite(&m->parts,sizeof(m->parts),1,f)!=1)  return -1;
+  if(fwrite(m->offset,sizeof(uint64_t),m->parts+1,f)!=m->parts+1)  return -1;
+
+  for(size_t p=0;p<m->parts;p++)
+  {
+    const mph_part_t* q=m->part+p;
+    size_t psz=(q->buckets*q->width+7)/8;
+    size_t rsz=q->table-q->n+1;
+
+    if(fwrite(&q->n,sizeof(q->n),1,f)!=1)  return -1;
+    if(fwrite(&q->table,sizeof(q->table),1,f)!=1)  return -1;
+    if(fwrite(&q->buckets,sizeof(q->buckets),1,f)!=1)  return -1;
+    if(fwrite(&q->dense,sizeof(q->dense),1,f)!=1)  return -1;
+    if(fwrite(&q->salt,sizeof(q->salt),1,f)!=1)  return -1;
+    if(fwrite(&q->width,sizeof(q->width),1,f)!=1)  return -1;
+    if(fwrite(q->pilots,1,psz,f)!=psz)  return -1;
+    if(fwrite(q->remap,sizeof(uint32_t),rsz,f)!=rsz)  return -1;
+  }
+  return 0;
+}
+
+mph_t* mph_load(FILE* f)
+{
+  if(!f)  return 0;
+  mph_t* m=md_new(m);
+
+  if(fread(&m->seed,sizeof(m->seed),1,f)!=1)  goto err;
+  if(fread(&m->n,sizeof(m->n),1,f)!=1)  goto err;
+  if(fread(&m->parts,sizeof(m->parts),1,f)!=1)  goto err;
+  if(!m->n || !m->parts || m->parts>m->n)  goto err;
+
+  m->offset=md_tmalloc(uint64_t,m->parts+1);
+  m->part=md_anew(m->part,m->parts);
+  if(fread(m->offset,sizeof(uint64_t),m->parts+1,f)!=m->parts+1)  goto err;
+  if(m->offset[0] || m->offset[m->parts]!=m->n)  goto err;
+
+  for(size_t p=0;p<m->parts;p++)
+  {
+    mph_part_t* q=m->part+p;
+
+    if(fread(&q->n,sizeof(q->n),1,f)!=1)  goto err;
+    if(fread(&q->table,sizeof(q->table),1,f)!=1)  goto err;
+    if(fread(&q->buckets,sizeof(q->buckets),1,f)!=1)  goto err;
+    if(fread(&q->dense,sizeof(q->dense),1,f)!=1)  goto err;
+    if(fread(&q->salt,sizeof(q->salt),1,f)!=1)  goto err;
+    if(fread(&q->width,sizeof(q->width),1,f)!=1)  goto err;
+    if(q->n!=m->offset[p+1]-m->offset[p] || q->table<q->n || !q->buckets || q->dense>q->buckets || !q->width || q->width>32)  goto err;
+
+    size_t psz=(q->buckets*q->width+7)/8;
+    size_t rsz=q->table-q->n+1;
+    q->pilots=md_calloc(psz+MPH_PAD);
+    q->remap=md_tmalloc(uint32_t,rsz);
+    if(fread(q->pilots,1,psz,f)!=psz)  goto err;
+    if(fread(q->remap,sizeof(uint32_t),rsz,f)!=rsz)  goto err;
+  }
+  return m;
+
+err:
+  mph_free(m);
+  return 0;
+}
@@ -0,0 +1,54 @@
+//! \file
+//! \brief in-tree minimal perfect hash, PTHash-like: skewed buckets, one pilot per bucket, compact pilot array.
+//! lookup is a key hash, one pilot read and a remap read for ~1% of keys.
+//! big key sets are split to partitions by hash, partitions are built in parallel,
+//! hashes of keys are spilled to temporary file in $TMPDIR so peak memory is bounded by partition size
+
+//! default count of keys in partition
+#define MPH_PARTITION		(1U<<22)
+
+//! 128 bit key hash
+typedef struct mph_hash_t
+{
+  uint64_t h1;				//!< bucket selection
+  uint64_t h2;				//!< partition and position inside table
+} mph_hash_t;
+
+typedef struct mph_t mph_t;
+
+//! key source, return hash of i-th key made by mph_hash with given seed. never called concurrently
+typedef mph_hash_t (*mph_key_f)(void* arg,size_t i,uint64_t seed);
+
+//! construction options
+typedef struct mph_opt_t
+{
+  size_t partition;			//!< keys per partition, 0 for MPH_PARTITION
+  size_t threads;			//!< construction threads, 0 for count of cpus
+} mph_opt_t;
+
+//! hash key
+mph_hash_t mph_hash(const void* key,size_t len,uint64_t seed);
+
+//! build over n keys, opt may be 0. return 0 if key hashes are not unique or construction failed
+mph_t* mph_init(size_t n,mph_key_f key,void* arg,uint64_t seed,const mph_opt_t* opt);
+//! destructor
+void mph_free(mph_t*);
+
+//! return value in [0,n) for keys of set, value in [0,n] for other hashes
+uint32_t mph_search_hash(const mph_t* m,mph_hash_t h);
+//! return value in [0,n) for keys of set, value in [0,n] for other keys
+uint32_t mph_search(const mph_t* m,const void* key,size_t len);
+
+//! seed keys must be hashed with
+uint64_t mph_seed(const mph_t* m);
+//! count of keys
+size_t mph_size(const mph_t* m);
+//! count of partitions
+size_t mph_parts(const mph_t* m);
+//! size of structure in bytes
+size_t mph_packed_size(const mph_t* m);
+
+//! save
+int mph_dump(const mph_t* m,FILE* f);
+//! load
+mph_t* mph_load(FILE* f);
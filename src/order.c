@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "common.h"
+#include "dict.h"
+#include "utils.h"
+#include "bitmap.h"
+#include "hfile.h"
+#include "prewarm.h"
+#include "order.h"
+
+
+order_t* order_init(void)
+{
+  order_t* rv=md_new(rv);
+  return rv;
+}
+
+void order_free(order_t* o)
+{
+  if(!o)  return;
+  free(o->data);
+  free(o);
+}
+
+void order_add(order_t* o,uint64_t pos,uint64_t hot,uint32_t zoom,uint64_t curve)
+{
+  if(o->cnt==o->max)
+  {
+    o->max=o->max ? 2*o->max : 4096;
+    o->data=md_realloc(o->data,o->max*sizeof(o->data[0]));
+  }
+  o->data[o->cnt].pos=pos;
+  o->data[o->cnt].hot=hot;
+  o->data[o->cnt].zoom=zoom;
+  o->data[o->cnt++].curve=curve;
+}
+
+static int order_cmp(const void* a,const void* b)
+{
+  const order_item_t* x=a;
+  const order_item_t* y=b;
+  if(x->hot!=y->hot)  return x->hot>y->hot ? -1 : 1;
+  if(x->zoom!=y->zoom)  return x->zoom<y->zoom ? -1 : 1;
+  if(x->curve!=y->curve)  return x->curve<y->curve ? -1 : 1;
+  return x->pos<y->pos ? -1 : x->pos>y->pos;
+}
+
+void order_sort(order_t* o)
+{
+  if(o && o->cnt)
+    qsort(o->data,o->cnt,sizeof(o->data[0]),order_cmp);
+}
+
+
+uint64_t order_hilbert(uint32_t x,uint32_t y)
+{
+  uint64_t d=0;
+  for(uint32_t s=1U<<31;s;s>>=1)
+  {
+    uint32_t rx=(x&s)!=0;
+    uint32_t ry=(y&s)!=0;
+    d+=(uint64_t)s*s*((3*rx)^ry);
+    if(!ry)
+    {
+      if(rx)
+      {
+        x=~x;
+        y=~y;
+      }
+      uint32_t t=x;
+      x=y;
+      y=t;
+    }
+  }
+  return d;
+}
+
+//! spread 32 bits to even positions of 64 bit word
+static uint64_t order_spread(uint32_t v)
+{
+  uint64_t x=v;
+  x=(x|(x<<16))&0x0000ffff0000ffffULL;
+  x=(x|(x<<8))&0x00ff00ff00ff00ffULL;
+  x=(x|(x<<4))&0x0f0f0f0f0f0f0f0fULL;
+  x=(x|(x<<2))&0x3333333333333333ULL;
+  x=(x|(x<<1))&0x5555555555555555ULL;
+  return x;
+}
+
+uint64_t order_morton(uint32_t x,uint32_t y)
+{
+  return order_spread(x)|(order_spread(y)<<1);
+}
+
+//! match name against pattern with {z},{x},{y} placeholders
+static int order_pattern(const char* pattern,const char* name,uint32_t* z,uint32_t* x,uint32_t* y)
+{
+  int found=0;
+  while(*pattern)
+  {
+    if(pattern[0]=='{' && pattern[1] && strchr("zxy",pattern[1]) && pattern[2]=='}')
+    {
+      if(*name<'0' || *name>'9')  return -1;
+      char* end=0;
+      unsigned long v=strtoul(name,&end,10);
+      if(v>UINT32_MAX)  return -1;
+      switch(pattern[1])
+      {
+        case 'z': *z=v; found|=1; break;
+        case 'x': *x=v; found|=2; break;
+        case 'y': *y=v; found|=4; break;
+      }
+      name=end;
+      pattern+=3;
+      continue;
+    }
+    if(*pattern++!=*name++)  return -1;
+  }
+  return (*name || found!=7) ? -1 : 0;
+}
+
+int order_spatial(uint32_t curve,const char* pattern,const utils_line_t* line,uint32_t* pzoom,uint64_t* pcurve)
+{
+  *pzoom=ORDER_NO_ZOOM;
+  *pcurve=0;
+  if(curve==HFILE_ORDER_INPUT || !line)  return -1;
+
+  uint32_t z=0,x=0,y=0;
+  int found=0;
+
+  if(pattern && *pattern && !order_pattern(pattern,line->name,&z,&x,&y))
+    found=7;
+
+  for(size_t i=0;i<line->metas && found!=7;i++)
+  {
+    const char* k=line->keys[i];
+    uint32_t v=strtoul(line->vals[i],0,10);
+    if(!strcmp(k,"zoom") || !strcmp(k,"z"))
+    {
+      z=v;
+      found|=1;
+    }
+    else if(!strcmp(k,"x"))
+    {
+      x=v;
+      found|=2;
+    }
+    else if(!strcmp(k,"y"))
+    {
+      y=v;
+      found|=4;
+    }
+  }
+
+  if(found!=7)  return -1;
+
+  *pzoom=z;
+  *pcurve=curve==HFILE_ORDER_HILBERT ? order_hilbert(x,y) : order_morton(x,y);
+  return 0;
+}
+
+
+//! counts from TSV name<TAB>count, missing count means 1
+static int order_hotness_tsv(const dict_t* names_dict,const char* hot,uint64_t* counts)
+{
+  FILE* f=fopen(hot,"r");
+  if(!f)
+  {
+    log("can not open hotlist <%s>",hot);
+    return -1;
+  }
+
+  size_t z=0;
+  char* bf=0;
+  size_t lines=0,unknown=0;
+
+  while(getline(&bf,&z,f)>=0)
+  {
+    if(!*bf || strchr(" \t\n\r\f",*bf))  continue;
+    char* p=bf;
+    char* name=strsep(&p,"\t\n\r\f");
+    uint64_t cnt=(p && *p) ? strtoull(p,0,10) : 1;
+    uint32_t idx=dict_get_str(names_dict,name);
+    lines++;
+    if(idx==DICT_NOT_FOUND)
+    {
+      unknown++;
+      continue;
+    }
+    counts[idx]+=cnt;
+  }
+
+  if(unknown)
+    log("hotlist <%s>: %zu of %zu names are not in filelist",hot,unknown,lines);
+  free(bf);
+  fclose(f);
+  return 0;
+}
+
+//! counts from access map, indices are resolved to names by database the map was recorded on
+static int order_hotness_map(const dict_t* names_dict,const char* hot,const char* hot_db,uint64_t* counts)
+{
+  prewarm_t* p=prewarm_load(hot);
+  if(!p)
+  {
+    log("can not load access map <%s>",hot);
+    return -1;
+  }
+  hfile_t* hf=hfile_open(hot_db);
+  if(!hf)
+  {
+    log("can not open database <%s> for access map",hot_db);
+    prewarm_free(p);
+    return -1;
+  }
+
+  int rv=-1;
+  const bitmap_t* map=prewarm_map(p);
+  if(prewarm_match(hf,p))
+  {
+    log("access map <%s> was not recorded on <%s>",hot,hot_db);
+    goto leave;
+  }
+
+  for(size_t i=0;i<map->bits;i++)
+  {
+    if(!bitmap_test(map,i))  continue;
+    const char* name=hfile_name_by_idx(hf,i);
+    uint32_t idx=name ? dict_get_str(names_dict,name) : DICT_NOT_FOUND;
+    if(idx!=DICT_NOT_FOUND)  counts[idx]++;
+  }
+  rv=0;
+
+leave:
+  hfile_free(hf);
+  prewarm_free(p);
+  return rv;
+}
+
+uint64_t* order_hotness(const dict_t* names_dict,const char* hot,const char* hot_db)
+{
+  if(!names_dict || !hot || !*hot)  return 0;
+
+  uint64_t* rv=md_tcalloc(uint64_t,dict_get_size(names_dict)+1);
+  int err=(hot_db && *hot_db) ? order_hotness_map(names_dict,hot,hot_db,rv) : order_hotness_tsv(names_dict,hot,rv);
+  if(err)
+  {
+    free(rv);
+    return 0;
+  }
+  return rv;
+}
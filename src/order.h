@@ -0,0 +1,43 @@
+//! \file
+//! \brief placement order of items at build time
+
+//! no spatial key, such items go last
+#define ORDER_NO_ZOOM		((uint32_t)-1)
+
+//! one filelist line
+typedef struct order_item_t
+{
+  uint64_t pos;				//!< line offset in filelist
+  uint64_t hot;				//!< access count, hotter first
+  uint64_t curve;			//!< position on space filling curve inside zoom level
+  uint32_t zoom;			//!< zoom level or ORDER_NO_ZOOM
+} order_item_t;
+
+//! placement order
+typedef struct order_t
+{
+  order_item_t* data;
+  size_t cnt;
+  size_t max;
+} order_t;
+
+//! ctr
+order_t* order_init(void);
+//! dtr
+void order_free(order_t*);
+//! add line
+void order_add(order_t* o,uint64_t pos,uint64_t hot,uint32_t zoom,uint64_t curve);
+//! sort lines to placement order
+void order_sort(order_t* o);
+
+//! spatial key of line by name pattern like "{z}-{x}-{y}.png" or by zoom/x/y properties, curve is HFILE_ORDER_*.
+//! return 0 if coordinates found
+int order_spatial(uint32_t curve,const char* pattern,const utils_line_t* line,uint32_t* pzoom,uint64_t* pcurve);
+
+//! position of tile on Hilbert curve
+uint64_t order_hilbert(uint32_t x,uint32_t y);
+//! position of tile on Z-order (Morton) curve
+uint64_t order_morton(uint32_t x,uint32_t y);
+
+//! load access counts per names_dict index from TSV name<TAB>count, or from access map recorded on database hot_db
+uint64_t* order_hotness(const dict_t* names_dict,const char* hot,const char* hot_db);
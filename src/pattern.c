@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "common.h"
+#include "utils.h"
+#include "pattern.h"
+
+
+//! end of bracket expression starting at glob[i], 0 if it is not closed and '[' is literal
+static size_t pattern_bracket(const char* glob,size_t i)
+{
+  size_t j=i+1;
+  if(glob[j]=='!' || glob[j]=='^')  j++;
+  if(glob[j]==']')  j++;
+  for(;glob[j];j++)
+  {
+    if(glob[j]==']')  return j+1;
+    if(glob[j]=='\\' && glob[j+1])
+      j++;
+    else if(glob[j]=='[' && strchr(":.=",glob[j+1]))
+    {
+// class like [:alpha:], closed by the same char and ']'
+      const char* e=glob+j+2;
+      while(*e && !(e[0]==glob[j+1] && e[1]==']'))  e++;
+      if(!*e)  return 0;
+      j=e+1-glob;
+    }
+  }
+  return 0;
+}
+
+//! end of extglob group with '(' at glob[i], 0 if it is not closed
+static size_t pattern_group(const char* glob,size_t i)
+{
+  size_t depth=0;
+  for(size_t j=i;glob[j];j++)
+  {
+    if(glob[j]=='\\' && glob[j+1])
+      j++;
+    else if(glob[j]=='[')
+    {
+      size_t e=pattern_bracket(glob,j);
+      if(e)  j=e-1;
+    }
+    else if(glob[j]=='(')
+      depth++;
+    else if(glob[j]==')' && !--depth)
+      return j+1;
+  }
+  return 0;
+}
+
+//! append literal run, reset it
+static void pattern_flush(pattern_t* p,char* run,size_t* rl)
+{
+  if(!*rl)  return;
+  run[*rl]=0;
+  p->lit[p->cnt]=md_strdup(run);
+  p->len[p->cnt]=*rl;
+  if(*rl>p->len[p->longest])  p->longest=p->cnt;
+  p->cnt++;
+  *rl=0;
+}
+
+pattern_t* pattern_init(const char* glob)
+{
+  if(!glob || !*glob)  return 0;
+
+  size_t n=strlen(glob);
+  pattern_t* p=md_new(p);
+  p->glob=md_strdup(glob);
+  p->lit=md_tcalloc(char*,n);
+  p->len=md_tcalloc(size_t,n);
+  p->stars=1;
+
+  char* run=md_tmalloc(char,n+1);
+  size_t rl=0,run_at=0;
+  for(size_t i=0;i<n;)
+  {
+    char c=glob[i];
+    size_t end=0;
+    if(c=='\\' && i+1<n)
+    {
+      run[rl++]=glob[i+1];
+      i+=2;
+      continue;
+    }
+    if(strchr("?*+@!",c) && glob[i+1]=='(')
+      end=pattern_group(glob,i+1);
+    if(!end && (c=='*' || c=='?'))
+      end=i+1;
+    if(!end && c=='[')
+      end=pattern_bracket(glob,i);
+    if(!end)
+    {
+      run[rl++]=c;
+      i++;
+      continue;
+    }
+
+    if(rl && !run_at)  p->prefix=1;
+    pattern_flush(p,run,&rl);
+    if(c!='*' || end!=i+1)  p->stars=0;
+    i=run_at=end;
+  }
+  if(rl)
+  {
+    if(!run_at)  p->prefix=1;
+    p->suffix=1;
+  }
+  pattern_flush(p,run,&rl);
+  free(run);
+  return p;
+}
+
+void pattern_free(pattern_t* p)
+{
+  if(!p)  return;
+  for(size_t i=0;i<p->cnt;i++)
+    free(p->lit[i]);
+  free(p->lit);
+  free(p->len);
+  free(p->glob);
+  free(p);
+}
+
+int pattern_match(const pattern_t* p,const char* s,size_t len)
+{
+  if(pattern_exact(p))
+    return len==p->len[0] && !memcmp(s,p->lit[0],len);
+
+  size_t pos=0,end=len;
+  size_t k=0,last=p->cnt;
+  if(p->prefix)
+  {
+    if(p->len[0]>len || memcmp(s,p->lit[0],p->len[0]))  return 0;
+    pos=p->len[k++];
+  }
+  if(p->suffix && last>k)
+  {
+    last--;
+    if(p->len[last]>end-pos || memcmp(s+len-p->len[last],p->lit[last],p->len[last]))  return 0;
+    end-=p->len[last];
+  }
+// the rest in order, leftmost occurrence leaves most room for the next ones
+  for(;k<last;k++)
+  {
+    const char* f=memmem(s+pos,end-pos,p->lit[k],p->len[k]);
+    if(!f)  return 0;
+    pos=f-s+p->len[k];
+  }
+  return p->stars || !fnmatch(p->glob,s,FNM_EXTMATCH);
+}
+
+
+#if defined(__x86_64__)
+//! compare first and last byte of literal at 32 positions at once, memcmp the rest of candidates
+__attribute__((target("avx2")))
+static const char* pattern_find_avx2(const char* s,size_t n,const char* lit,size_t l)
+{
+  __m256i first=_mm256_set1_epi8(lit[0]);
+  __m256i last=_mm256_set1_epi8(lit[l-1]);
+  size_t i=0;
+  for(;i+l-1+32<=n;i+=32)
+  {
+    __m256i a=_mm256_loadu_si256((const __m256i*)(s+i));
+    __m256i b=_mm256_loadu_si256((const __m256i*)(s+i+l-1));
+    uint32_t m=_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a,first),_mm256_cmpeq_epi8(b,last)));
+    for(;m;m&=m-1)
+    {
+      size_t j=i+__builtin_ctz(m);
+      if(!memcmp(s+j+1,lit+1,l-2))  return s+j;
+    }
+  }
+  return i<n ? memmem(s+i,n-i,lit,l) : 0;
+}
+#elif defined(__aarch64__)
+//! the same with NEON, 16 positions at once, mask has 4 bits per position
+static const char* pattern_find_neon(const char* s,size_t n,const char* lit,size_t l)
+{
+  uint8x16_t first=vdupq_n_u8(lit[0]);
+  uint8x16_t last=vdupq_n_u8(lit[l-1]);
+  size_t i=0;
+  for(;i+l-1+16<=n;i+=16)
+  {
+    uint8x16_t eq=vandq_u8(vceqq_u8(vld1q_u8((const uint8_t*)s+i),first),vceqq_u8(vld1q_u8((const uint8_t*)s+i+l-1),last));
+    uint64_t m=vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq),4)),0);
+    for(m&=0x1111111111111111ULL;m;m&=m-1)
+    {
+      size_t j=i+__builtin_ctzll(m)/4;
+      if(!memcmp(s+j+1,lit+1,l-2))  return s+j;
+    }
+  }
+  return i<n ? memmem(s+i,n-i,lit,l) : 0;
+}
+#endif
+
+const char* pattern_find(const char* s,size_t n,const char* lit,size_t l)
+{
+  if(!l)  return s;
+  if(l>n)  return 0;
+  if(l==1)  return memchr(s,*lit,n);
+#if defined(__x86_64__)
+  if(__builtin_cpu_supports("avx2"))
+    return pattern_find_avx2(s,n,lit,l);
+#elif defined(__aarch64__)
+  return pattern_find_neon(s,n,lit,l);
+#endif
+  return memmem(s,n,lit,l);
+}
+
+
+//! part of scan done by one thread
+typedef struct pattern_job_t
+{
+  const pattern_t* p;
+  const char* from;			//!< first string of pool part
+  const char* to;			//!< end of last string
+  size_t lo,hi;				//!< index range of pattern_scan_idx
+  pattern_cb_t cb;
+  pattern_name_t name;
+  pattern_idx_cb_t idx_cb;
+  void* arg;
+  size_t found;
+} pattern_job_t;
+
+static void* pattern_pool_worker(void* a)
+{
+  pattern_job_t* j=a;
+  const pattern_t* p=j->p;
+  const char* s=j->from;
+
+  if(!p->cnt)
+  {
+    while(s<j->to)
+    {
+      size_t l=strlen(s);
+      if(pattern_match(p,s,l))
+      {
+        j->cb(j->arg,s,l);
+        j->found++;
+      }
+      s+=l+1;
+    }
+    return 0;
+  }
+
+// only strings holding the longest literal are candidates
+  const char* lit=p->lit[p->longest];
+  size_t ll=p->len[p->longest];
+  while(s<j->to)
+  {
+    const char* hit=pattern_find(s,j->to-s,lit,ll);
+    if(!hit)  break;
+    const char* b=memrchr(s,0,hit-s);
+    b=b ? b+1 : s;
+    const char* e=rawmemchr(hit,0);
+    if(pattern_match(p,b,e-b))
+    {
+      j->cb(j->arg,b,e-b);
+      j->found++;
+    }
+    s=e+1;
+  }
+  return 0;
+}
+
+static void* pattern_idx_worker(void* a)
+{
+  pattern_job_t* j=a;
+  for(size_t i=j->lo;i<j->hi;i++)
+  {
+    const char* s=j->name(j->arg,i);
+    if(s && pattern_match(j->p,s,strlen(s)))
+    {
+      j->idx_cb(j->arg,i);
+      j->found++;
+    }
+  }
+  return 0;
+}
+
+//! run jobs, first one in calling thread. return sum of found
+static size_t pattern_run(pattern_job_t* jobs,size_t cnt,void* (*worker)(void*))
+{
+  pthread_t* th=md_tcalloc(pthread_t,cnt);
+  uint8_t* started=md_tcalloc(uint8_t,cnt);
+  for(size_t t=1;t<cnt;t++)
+    started[t]=!pthread_create(th+t,0,worker,jobs+t);
+  worker(jobs);
+
+  size_t rv=0;
+  for(size_t t=0;t<cnt;t++)
+  {
+    if(t && started[t])  pthread_join(th[t],0);
+    else if(t)  worker(jobs+t);
+    rv+=jobs[t].found;
+  }
+  free(started);
+  free(th);
+  return rv;
+}
+
+size_t pattern_scan(const pattern_t* p,const char* pool,uint64_t size,uint32_t threads,pattern_cb_t cb,void* arg)
+{
+  if(!p || !pool || !size || !cb)  return 0;
+  if(!threads)  threads=utils_getCPUs();
+  if(!threads || size<PATTERN_PARALLEL_MIN)  threads=1;
+
+// parts end at string ends, so every string is seen by one thread
+  pattern_job_t* jobs=md_tcalloc(pattern_job_t,threads);
+  const char* end=pool+size;
+  const char* from=pool;
+  size_t cnt=0;
+  for(uint32_t t=0;t<threads && from<end;t++)
+  {
+    const char* to=t+1<threads ? pool+size/threads*(t+1) : end;
+    if(to<from)  to=from;
+    const char* z=to<end ? memchr(to,0,end-to) : 0;
+    to=z ? z+1 : end;
+    jobs[cnt]=(pattern_job_t){.p=p,.from=from,.to=to,.cb=cb,.arg=arg};
+    cnt++;
+    from=to;
+  }
+  size_t rv=pattern_run(jobs,cnt,pattern_pool_worker);
+  free(jobs);
+  return rv;
+}
+
+size_t pattern_scan_idx(const pattern_t* p,size_t n,pattern_name_t name,uint32_t threads,pattern_idx_cb_t cb,void* arg)
+{
+  if(!p || !n || !name || !cb)  return 0;
+  if(!threads)  threads=utils_getCPUs();
+  if(!threads)  threads=1;
+  if(threads>n)  threads=n;
+
+  pattern_job_t* jobs=md_tcalloc(pattern_job_t,threads);
+  for(uint32_t t=0;t<threads;t++)
+    jobs[t]=(pattern_job_t){.p=p,.lo=n*t/threads,.hi=n*(t+1)/threads,.name=name,.idx_cb=cb,.arg=arg};
+  size_t rv=pattern_run(jobs,threads,pattern_idx_worker);
+  free(jobs);
+  return rv;
+}
@@ -0,0 +1,45 @@
+//! \file
+//! \brief glob (fnmatch with FNM_EXTMATCH) compiled to literal anchors and residual matcher, parallel SIMD scan of string pools
+
+//! pools smaller than this are scanned by one thread
+#define PATTERN_PARALLEL_MIN	(1U<<20)
+
+//! compiled glob
+typedef struct pattern_t
+{
+  char* glob;				//!< source pattern, residual matcher
+  char** lit;				//!< literals every match contains, in pattern order, unescaped
+  size_t* len;				//!< their lengths
+  size_t cnt;				//!< count of literals
+  size_t longest;			//!< index of longest literal, searched in pools
+  int prefix;				//!< first literal starts the pattern
+  int suffix;				//!< last literal ends the pattern
+  int stars;				//!< wildcards are only '*', literals checked in order are exact match
+} pattern_t;
+
+//! match callback of pattern_scan, called from scanning threads with matching string of pool
+typedef void (*pattern_cb_t)(void* arg,const char* s,size_t len);
+//! string by index for pattern_scan_idx, 0 to skip index. called from scanning threads
+typedef const char* (*pattern_name_t)(void* arg,size_t idx);
+//! match callback of pattern_scan_idx
+typedef void (*pattern_idx_cb_t)(void* arg,size_t idx);
+
+//! compile, 0 on empty pattern
+pattern_t* pattern_init(const char* glob);
+//! dtr
+void pattern_free(pattern_t*);
+//! pattern is a plain name without wildcards
+static inline int pattern_exact(const pattern_t* p)
+{
+  return p->cnt==1 && p->prefix && p->suffix && p->stars;
+}
+
+//! match string of len bytes: anchors first, fnmatch only if they pass and pattern has other wildcards than '*'
+int pattern_match(const pattern_t* p,const char* s,size_t len);
+//! first occurrence of lit of l bytes in n bytes of s, AVX2/NEON with scalar fallback. 0 if absent
+const char* pattern_find(const char* s,size_t n,const char* lit,size_t l);
+
+//! scan pool of size bytes holding NUL terminated strings back to back by threads (0 for count of cpus), cb gets matching ones. return count of matches
+size_t pattern_scan(const pattern_t* p,const char* pool,uint64_t size,uint32_t threads,pattern_cb_t cb,void* arg);
+//! match strings of indices [0,n) taken by name() in parallel, cb gets matching indices. return count of matches
+size_t pattern_scan_idx(const pattern_t* p,size_t n,pattern_name_t name,uint32_t threads,pattern_idx_cb_t cb,void* arg);
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "common.h"
+#include "checksum.h"
+#include "dict.h"
+#include "utils.h"
+#include "bitmap.h"
+#include "hfile.h"
+#include "hfile_int.h"
+#include "prewarm.h"
+
+//! ranges closer than this are read by one request, reading a hole is cheaper than a seek
+#define PREWARM_GAP		(128*1024)
+
+//! first guess for record size before its header is in memory
+#define PREWARM_HEAD		4096
+
+struct prewarm_t
+{
+  uint8_t uuid[UUID_SIZE];		//!< database uuid
+  bitmap_t* map;			//!< accessed item indices
+  hfile_t* hf;				//!< database recorder attached to
+};
+
+//! range of file to read
+typedef struct prewarm_range_t
+{
+  uint64_t off;
+  uint64_t len;
+} prewarm_range_t;
+
+//! ranges of one file
+typedef struct prewarm_list_t
+{
+  prewarm_range_t* data;
+  size_t cnt;
+  size_t max;
+} prewarm_list_t;
+
+
+prewarm_t* prewarm_init(const hfile_t* hf)
+{
+  if(!hf)  return 0;
+  prewarm_t* rv=md_new(rv);
+  memcpy(rv->uuid,hf->idx.header.uuid,sizeof(rv->uuid));
+  rv->map=bitmap_init(hf->idx.header.chunks);
+  return rv;
+}
+
+void prewarm_free(prewarm_t* p)
+{
+  if(!p)  return;
+  if(p->hf)  prewarm_detach(p->hf);
+  bitmap_free(p->map);
+  free(p);
+}
+
+int prewarm_attach(hfile_t* hf,prewarm_t* p)
+{
+  if(!hf || !p)  return -1;
+  if(prewarm_match(hf,p))
+  {
+    log("recording belongs to another database");
+    return -1;
+  }
+  prewarm_detach(hf);
+  p->hf=hf;
+  hf->rec=p;
+  return 0;
+}
+
+prewarm_t* prewarm_detach(hfile_t* hf)
+{
+  if(!hf || !hf->rec)  return 0;
+  prewarm_t* rv=hf->rec;
+  hf->rec=0;
+  rv->hf=0;
+  return rv;
+}
+
+void prewarm_mark(prewarm_t* p,size_t idx)
+{
+  if(p)  bitmap_set(p->map,idx);
+}
+
+size_t prewarm_count(const prewarm_t* p)
+{
+  return p ? bitmap_count(p->map) : 0;
+}
+
+const bitmap_t* prewarm_map(const prewarm_t* p)
+{
+  return p ? p->map : 0;
+}
+
+int prewarm_match(const hfile_t* hf,const prewarm_t* p)
+{
+  if(!hf || !p)  return -1;
+  return memcmp(p->uuid,hf->idx.header.uuid,UUID_SIZE) || p->map->bits!=hf->idx.header.chunks;
+}
+
+
+int prewarm_save(const prewarm_t* p,const char* fn)
+{
+  if(!p || !fn || !*fn)  return -1;
+
+  char* tmp=0;
+  asprintf(&tmp,"%s.tmp",fn);
+  FILE* f=fopen(tmp,"wb");
+  if(!f)
+  {
+    log("can not create file <%s>: %s",tmp,strerror(errno));
+    free(tmp);
+    return -1;
+  }
+
+  hfile_header_t header;
+  memset(&header,0,sizeof(header));
+  header.magic=MAGIC;
+  header.version=HFILE_VERSION;
+  header.size=sizeof(header)+bitmap_words(p->map->bits)*sizeof(uint64_t);
+  header.chunks=p->map->bits;
+  header.tm=time(0);
+  memcpy(header.uuid,p->uuid,sizeof(header.uuid));
+
+  int rv=fwrite(&header,sizeof(header),1,f)!=1 || bitmap_save_file(p->map,f);
+  rv|=fclose(f);
+  if(!rv)  rv=rename(tmp,fn);
+  if(rv)
+  {
+    log("can not save recording <%s>",fn);
+    unlink(tmp);
+  }
+  free(tmp);
+  return rv ? -1 : 0;
+}
+
+
+prewarm_t* prewarm_load(const char* fn)
+{
+  if(!fn || !*fn)  return 0;
+  FILE* f=fopen(fn,"rb");
+  if(!f)  return 0;
+
+  prewarm_t* rv=0;
+  hfile_header_t header;
+  if(fread(&header,sizeof(header),1,f)!=1 || header.magic!=MAGIC ||
+     header.size!=sizeof(header)+bitmap_words(header.chunks)*sizeof(uint64_t))
+  {
+    log("invalid recording <%s>",fn);
+    goto leave;
+  }
+
+  rv=md_new(rv);
+  memcpy(rv->uuid,header.uuid,sizeof(rv->uuid));
+  rv->map=bitmap_init(header.chunks);
+  if(bitmap_load_file(rv->map,f))
+  {
+    log("truncated recording <%s>",fn);
+    prewarm_free(rv);
+    rv=0;
+  }
+
+leave:
+  fclose(f);
+  return rv;
+}
+
+
+static void prewarm_add(prewarm_list_t* l,uint64_t off,uint64_t len,uint64_t limit)
+{
+  if(off>=limit)  return;
+  if(off+len>limit)  len=limit-off;
+  if(l->cnt==l->max)
+  {
+    l->max=l->max ? 2*l->max : 1024;
+    l->data=md_realloc(l->data,l->max*sizeof(l->data[0]));
+  }
+  l->data[l->cnt].off=off;
+  l->data[l->cnt++].len=len;
+}
+
+static int prewarm_cmp(const void* a,const void* b)
+{
+  const prewarm_range_t* x=a;
+  const prewarm_range_t* y=b;
+  return x->off<y->off ? -1 : x->off>y->off;
+}
+
+//! sort, coalesce and issue readahead, return count of requests issued
+static size_t prewarm_issue(prewarm_list_t* l,void* base,uint64_t* bytes)
+{
+  if(!l->cnt)  return 0;
+  qsort(l->data,l->cnt,sizeof(l->data[0]),prewarm_cmp);
+
+  size_t page=sysconf(_SC_PAGESIZE);
+  size_t rv=0;
+  size_t i=0;
+  while(i<l->cnt)
+  {
+    uint64_t start=l->data[i].off;
+    uint64_t end=start+l->data[i].len;
+    for(i++;i<l->cnt && l->data[i].off<=end+PREWARM_GAP;i++)
+      if(l->data[i].off+l->data[i].len>end)
+        end=l->data[i].off+l->data[i].len;
+
+    start&=~(uint64_t)(page-1);
+    madvise(base+start,end-start,MADV_WILLNEED);
+    *bytes+=end-start;
+    rv++;
+  }
+  l->cnt=0;
+  return rv;
+}
+
+
+int prewarm_replay(const hfile_t* hf,const prewarm_t* p)
+{
+  if(!hf || !p)  return -1;
+  if(prewarm_match(hf,p))
+  {
+    log("recording belongs to another database");
+    return -1;
+  }
+
+  tic;
+  prewarm_list_t idx={0,},names={0,},content={0,};
+  uint64_t bytes=0;
+  size_t reqs=0;
+  size_t items=0;
+
+// recorded indices in ascending order
+  size_t cnt=0;
+  uint32_t* set=md_tmalloc(uint32_t,bitmap_count(p->map)+1);
+  for(size_t w=0;w<bitmap_words(p->map->bits);w++)
+    for(uint64_t word=p->map->data[w];word;word&=word-1)
+    {
+      size_t i=w*64+__builtin_ctzll(word);
+      if(i<hf->idx.header.chunks)  set[cnt++]=i;
+    }
+
+// pass 1: index entries, names records and content heads, sizes are still unknown
+  if(hf->pidx.data)
+  {
+    uint32_t bits=hf->pidx.content_bits+hf->pidx.name_bits;
+    for(size_t j=0;j<cnt;j++)
+      prewarm_add(&idx,HFILE_PIDX_OFFSET+(uint64_t)set[j]*bits/8,(bits+7)/8+1,hf->pidx.mmapsize);
+    reqs+=prewarm_issue(&idx,hf->pidx.base,&bytes);
+  }
+  else
+  {
+    for(size_t j=0;j<cnt;j++)
+      prewarm_add(&idx,sizeof(hfile_header_t)+set[j]*sizeof(hfile_idx_item_t),sizeof(hfile_idx_item_t),hf->idx.mmapsize);
+    reqs+=prewarm_issue(&idx,hf->idx.base,&bytes);
+  }
+
+  for(size_t j=0;j<cnt;j++)
+  {
+    uint64_t name_off=hfile_idx_name(hf,set[j]);
+    uint64_t content_off=hfile_idx_content(hf,set[j]);
+    if(name_off==HFILE_NOT_FOUND || content_off==HFILE_NOT_FOUND)  continue;
+    prewarm_add(&names,name_off,PREWARM_HEAD,hf->names.mmapsize);
+    prewarm_add(&content,content_off,PREWARM_HEAD,hf->content.mmapsize);
+    items++;
+  }
+  reqs+=prewarm_issue(&names,hf->names.base,&bytes);
+  reqs+=prewarm_issue(&content,hf->content.base,&bytes);
+
+// pass 2: headers are (being) read, add tails of big records
+  for(size_t j=0;j<cnt;j++)
+  {
+    uint64_t name_off=hfile_idx_name(hf,set[j]);
+    uint64_t content_off=hfile_idx_content(hf,set[j]);
+    if(name_off==HFILE_NOT_FOUND || content_off==HFILE_NOT_FOUND)  continue;
+
+    const hfile_item_t* item=hf->names.base+name_off;
+    uint64_t len=sizeof(*item)+item->size;
+    if(len>PREWARM_HEAD)
+      prewarm_add(&names,name_off+PREWARM_HEAD,len-PREWARM_HEAD,hf->names.mmapsize);
+
+    const hfile_chunk_t* chunk=hf->content.base+content_off;
+    len=sizeof(*chunk)+chunk->size;
+    if(len>PREWARM_HEAD)
+      prewarm_add(&content,content_off+PREWARM_HEAD,len-PREWARM_HEAD,hf->content.mmapsize);
+// pieces of chunked content, list itself is read by now
+    if(chunk->flags & HFILE_CHUNK_LIST)
+    {
+      const hfile_piece_t* p=(const void*)(chunk+1);
+      for(size_t i=0;i<chunk->size/sizeof(*p);i++)
+        prewarm_add(&content,p[i].offset,sizeof(*chunk)+p[i].size,hf->content.mmapsize);
+    }
+  }
+  reqs+=prewarm_issue(&names,hf->names.base,&bytes);
+  reqs+=prewarm_issue(&content,hf->content.base,&bytes);
+
+  free(set);
+  free(idx.data);
+  free(names.data);
+  free(content.data);
+
+  log("prewarm replay: %zu items, %zu requests, %ju bytes, time taken %s",items,reqs,(uintmax_t)bytes,toc);
+  return 0;
+}
@@ -0,0 +1,30 @@
+//! \file
+//! \brief access recorder and page cache prewarmer
+
+typedef struct prewarm_t prewarm_t;
+
+//! create empty recording for database
+prewarm_t* prewarm_init(const hfile_t* hf);
+//! dtr, recorder shall be detached before
+void prewarm_free(prewarm_t*);
+
+//! start recording of items fetched by name, fail if recording belongs to another database
+int prewarm_attach(hfile_t* hf,prewarm_t* p);
+//! stop recording, return detached recorder
+prewarm_t* prewarm_detach(hfile_t* hf);
+//! mark item as accessed, called by library for attached recorder
+void prewarm_mark(prewarm_t* p,size_t idx);
+//! count of recorded items
+size_t prewarm_count(const prewarm_t*);
+//! recorded indices
+const bitmap_t* prewarm_map(const prewarm_t*);
+//! check recording belongs to database, return 0 on match
+int prewarm_match(const hfile_t* hf,const prewarm_t* p);
+
+//! save recording
+int prewarm_save(const prewarm_t*,const char* fn);
+//! load recording
+prewarm_t* prewarm_load(const char* fn);
+
+//! read recorded items (index entries, names records and content) into page cache by big coalesced reads
+int prewarm_replay(const hfile_t* hf,const prewarm_t* p);
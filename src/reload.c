@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "common.h"
+#include "utils.h"
+#include "hfile.h"
+#include "reload.h"
+
+//! count of reader counter stripes, readers on different cores rarely share a cache line
+#define RELOAD_STRIPES		16
+
+#define CACHE_LINE		64
+
+//! pair of active readers counters, one per epoch parity
+typedef struct reload_stripe_t
+{
+  atomic_ulong active[2];
+} __attribute__ ((aligned(CACHE_LINE))) reload_stripe_t;
+
+struct reload_t
+{
+  _Atomic(hfile_t*) cur;		//!< database in service
+  atomic_uint epoch;			//!< grace period counter, parity selects readers counter
+  reload_stripe_t stripes[RELOAD_STRIPES];
+  pthread_mutex_t lock;			//!< serialize writers
+  char* base;				//!< last opened path
+  uint32_t prewarm;			//!< HFILE_PREWARM_* mask
+  reload_hook_t hook;			//!< lifetime callbacks
+  atomic_uint_fast64_t generation;	//!< swaps count
+};
+
+
+static atomic_uint stripe_next=0;
+static __thread int32_t stripe_my= -1;
+
+static uint32_t reload_stripe(void)
+{
+  if(stripe_my<0)
+    stripe_my=atomic_fetch_add(&stripe_next,1)%RELOAD_STRIPES;
+  return stripe_my;
+}
+
+
+static hfile_t* reload_open(const char* base,uint32_t prewarm,const reload_hook_t* hook)
+{
+  hfile_t* hf=hfile_open(base);
+  if(!hf)
+  {
+    log("can not open database <%s>",base);
+    return 0;
+  }
+  if(prewarm)
+    hfile_prewarm(hf,prewarm);
+  if(hook->open)
+    hook->open(hf,hook->arg);
+  return hf;
+}
+
+static void reload_close(hfile_t* hf,const reload_hook_t* hook)
+{
+  if(hf && hook->close)
+    hook->close(hf,hook->arg);
+  hfile_free(hf);
+}
+
+
+reload_t* reload_init(const char* base,uint32_t prewarm)
+{
+  return reload_init_hook(base,prewarm,0);
+}
+
+reload_t* reload_init_hook(const char* base,uint32_t prewarm,const reload_hook_t* hook)
+{
+  if(!base || !*base)  return 0;
+
+  reload_hook_t nohook={0,};
+  if(!hook)  hook=&nohook;
+
+  hfile_t* hf=reload_open(base,prewarm,hook);
+  if(!hf)  return 0;
+
+  reload_t* rv=md_new(rv);
+  rv->hook=*hook;
+  atomic_init(&rv->cur,hf);
+  atomic_init(&rv->epoch,0);
+  atomic_init(&rv->generation,0);
+  for(size_t i=0;i<RELOAD_STRIPES;i++)
+  {
+    atomic_init(&rv->stripes[i].active[0],0);
+    atomic_init(&rv->stripes[i].active[1],0);
+  }
+  pthread_mutex_init(&rv->lock,0);
+  rv->base=md_strdup(base);
+  rv->prewarm=prewarm;
+  return rv;
+}
+
+
+void reload_free(reload_t* r)
+{
+  if(!r)  return;
+  reload_close(atomic_load(&r->cur),&r->hook);
+  pthread_mutex_destroy(&r->lock);
+  free(r->base);
+  free(r);
+}
+
+
+const hfile_t* reload_acquire(reload_t* r,reload_ref_t* ref)
+{
+  if(!r || !ref)  return 0;
+
+  ref->stripe=reload_stripe();
+  ref->slot=atomic_load(&r->epoch)&1;
+  atomic_fetch_add(&r->stripes[ref->stripe].active[ref->slot],1);
+// pointer loaded after counter published, writer either waits for us or we see new database
+  ref->hf=atomic_load(&r->cur);
+  return ref->hf;
+}
+
+
+void reload_release(reload_t* r,reload_ref_t* ref)
+{
+  if(!r || !ref || !ref->hf)  return;
+  atomic_fetch_sub(&r->stripes[ref->stripe].active[ref->slot],1);
+  ref->hf=0;
+}
+
+
+//! wait until all readers of given parity are gone
+static void reload_drain(reload_t* r,uint32_t slot)
+{
+  for(;;)
+  {
+    uint64_t active=0;
+    for(size_t i=0;i<RELOAD_STRIPES;i++)
+      active+=atomic_load(&r->stripes[i].active[slot]);
+    if(!active)  return;
+    usleep(1000);
+  }
+}
+
+
+//! grace period: flip epoch twice, so readers which loaded old epoch but published counter late are covered too
+static void reload_synchronize(reload_t* r)
+{
+  for(int i=0;i<2;i++)
+  {
+    uint32_t e=atomic_fetch_add(&r->epoch,1);
+    reload_drain(r,e&1);
+  }
+}
+
+
+int reload_swap(reload_t* r,const char* base)
+{
+  if(!r)  return -1;
+
+  pthread_mutex_lock(&r->lock);
+
+  if(!base)  base=r->base;
+
+  tic;
+  hfile_t* hf=reload_open(base,r->prewarm,&r->hook);
+  if(!hf)
+  {
+    log("reload of <%s> failed, old database stays in service",base);
+    utils_time_pop();
+    pthread_mutex_unlock(&r->lock);
+    return -1;
+  }
+
+  hfile_t* old=atomic_exchange(&r->cur,hf);
+  reload_synchronize(r);
+  reload_close(old,&r->hook);
+
+  if(base!=r->base)
+  {
+    free(r->base);
+    r->base=md_strdup(base);
+  }
+  uint64_t gen=atomic_fetch_add(&r->generation,1)+1;
+  log("database <%s> reloaded, generation %ju, time taken %s",r->base,(uintmax_t)gen,toc);
+
+  pthread_mutex_unlock(&r->lock);
+  return 0;
+}
+
+
+uint64_t reload_generation(const reload_t* r)
+{
+  return r ? atomic_load(&r->generation) : 0;
+}
@@ -0,0 +1,39 @@
+//! \file
+//! \brief reloadable database handle, hot swap without restart
+
+typedef struct reload_t reload_t;
+
+//! reader reference, keep it until all pointers obtained from hf are not used anymore
+typedef struct reload_ref_t
+{
+  const hfile_t* hf;			//!< database snapshot
+  uint32_t slot;			//!< internal, epoch slot
+  uint32_t stripe;			//!< internal, counter stripe
+} reload_ref_t;
+
+//! callbacks around database lifetime
+typedef struct reload_hook_t
+{
+  void (*open)(hfile_t* hf,void* arg);	//!< new database opened, called before it goes to service
+  void (*close)(hfile_t* hf,void* arg);	//!< database retired, called after last reader gone and before free
+  void* arg;
+} reload_hook_t;
+
+//! open database, prewarm is mask of HFILE_PREWARM_* applied on every (re)load
+reload_t* reload_init(const char* base,uint32_t prewarm);
+//! open database with lifetime callbacks, hook copied
+reload_t* reload_init_hook(const char* base,uint32_t prewarm,const reload_hook_t* hook);
+//! destructor, no readers allowed at this point
+void reload_free(reload_t*);
+
+//! pin current database for reading, never blocks
+const hfile_t* reload_acquire(reload_t*,reload_ref_t* ref);
+//! unpin database
+void reload_release(reload_t*,reload_ref_t* ref);
+
+//! open (and prewarm) new database, swap it with current one and release old one after all readers gone.
+//! base may be 0 to reopen the same path. on error current database stays in service.
+int reload_swap(reload_t*,const char* base);
+
+//! count of successfull swaps
+uint64_t reload_generation(const reload_t*);
@@ -0,0 +1,14 @@
+#!/bin/bash
+
+# hot records let reads locate content without touching it, so small items go through O_DIRECT bounce buffers
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbaio -s data.out/cdc.list -O cdc=1k -O records=1 |& tee $0.log
+
+# content through io_uring shall match hfile_get: small items, content defined pieces, 170k items bigger than first buffer.
+# verify=0 keeps content out of page cache after it is dropped, so reads go to disk
+for db in dbaio dbpool; do
+  names=data.out/cdc.list
+  test $db == dbpool && names=data.out/pool.names
+  valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/$db -s $names -o data.out/aio_sync.tsv |& tee -a $0.log
+  valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/$db -s $names -o data.out/aio.tsv -A 4 -O verify=0 |& tee -a $0.log
+  sort data.out/aio_sync.tsv | cmp - <(sort data.out/aio.tsv) || echo "ERROR SUMMARY: asynchronous reads of $db differ" |& tee -a $0.log
+done
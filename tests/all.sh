@@ -9,7 +9,18 @@ echo "Stat test:" ; ./stat.sh >/dev/null
 echo "Dump test:" ; ./dump.sh >/dev/null
 echo "Extract test:" ; ./extract.sh >/dev/null
 echo "Extract with filter test:" ; ./extract2.sh >/dev/null
+echo "Extract with predicate test:" ; ./extract3.sh >/dev/null
 echo "List test:" ; ./list.sh >/dev/null
+echo "Build with hotlist test:" ; ./build_hot.sh >/dev/null
+echo "Build with in-tree MPH test:" ; ./build_mph.sh >/dev/null
+echo "Build with front coded names test:" ; ./build_front.sh >/dev/null
+echo "Build with content defined chunking test:" ; ./build_cdc.sh >/dev/null
+echo "Build with tile order test:" ; ./build_order.sh >/dev/null
+echo "Build with weighted sampler test:" ; ./sample.sh >/dev/null
+echo "Lookup with names budget test:" ; ./get.sh >/dev/null
+echo "Lookup through buffer pool test:" ; ./pool.sh >/dev/null
+echo "Hot names tracker test:" ; ./hotkey.sh >/dev/null
+echo "Asynchronous reads test:" ; ./aio.sh >/dev/null
 
 failed=`fgrep 'ERROR SUMMARY:' *.log | fgrep -v '0 errors from 0 contexts (suppressed: 0 from 0)' | wc -l`
 echo "Done," $failed "tests failed"
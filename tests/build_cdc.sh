@@ -0,0 +1,12 @@
+#!/bin/bash
+
+# two big near-identical files, the second has one line changed
+mkdir -p data.out/cdc.in
+seq 1 30000 >data.out/cdc.in/a
+sed 's/^15000$/fifteen thousand/' data.out/cdc.in/a >data.out/cdc.in/b
+printf "cdc/a\t:data.out/cdc.in/a\ncdc/b\t:data.out/cdc.in/b\n" | cat - source.in >data.out/cdc.list
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbcdc -s data.out/cdc.list -O cdc=1k |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -x -d data.out/dbcdc -o data.out/extract_cdc |& tee -a $0.log
+cmp data.out/cdc.in/a data.out/extract_cdc/cdc/a |& tee -a $0.log
+cmp data.out/cdc.in/b data.out/extract_cdc/cdc/b |& tee -a $0.log
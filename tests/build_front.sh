@@ -0,0 +1,4 @@
+#!/bin/bash
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbfront -s source.in -O names=front -O values=1 |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -l -d data.out/dbfront -o data.out/dbfront.list |& tee -a $0.log
@@ -0,0 +1,8 @@
+#!/bin/bash
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbhot -s source.in -O hot=hot.in -O records=1 -O report=data.out/dbhot.json |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -p -d data.out/dbhot -o data.out/dump_hot |& tee -a $0.log
+
+# names of hot.in by descending count shall own the lowest content offsets, duplicates share offset of their first copy
+got=`awk -F'\t' '$2 ~ /^\[/ { for(i=10;i<=NF;i++)  if($i ~ /^(newname2|data\.in\/.*)$/)  { print $6 "\t" $i; break } }' data.out/dump_hot/names.content.dump | sort -n -s -k1,1 | awk '!seen[$1]++ { print $2 }' | head -3 | xargs`
+test "$got" == "newname2 data.in/9 data.in/3" || echo "ERROR SUMMARY: hot names placed <$got>" |& tee -a $0.log
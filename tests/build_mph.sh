@@ -0,0 +1,4 @@
+#!/bin/bash
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbmph -s source.in -O mph=pthash -O packed_idx=1 |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -i -d data.out/dbmph |& tee -a $0.log
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# tiles of zoom 0 and 1 in scrambled order, coordinates in names for hilbert and in properties for zorder, one item without them
+printf 't/1/0/1\t:data.in/1\nother\t:data.in/2\nt/1/1/1\t:data.in/3\nt/0/0/0\t:data.in/5\nt/1/1/0\t:data.in/6\nt/1/0/0\t:data.in/7\n' >data.out/tiles.list
+sed -E 's#^t/([0-9]+)/([0-9]+)/([0-9]+)(.*)$#&\tz:\1\tx:\2\ty:\3#' data.out/tiles.list >data.out/tiles_props.list
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbhilbert -s data.out/tiles.list -O order=hilbert -O tiles='t/{z}/{x}/{y}' |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbzorder -s data.out/tiles_props.list -O order=zorder |& tee -a $0.log
+
+# names by content offset, zoom levels first, then curve position, items without coordinates last
+for db in hilbert:'t/0/0/0 t/1/0/0 t/1/1/0 t/1/1/1 t/1/0/1 other' zorder:'t/0/0/0 t/1/0/0 t/1/1/0 t/1/0/1 t/1/1/1 other'; do
+  curve=${db%%:*}
+  valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -p -d data.out/db$curve -o data.out/dump_$curve |& tee -a $0.log
+  got=`awk -F'\t' '$2 ~ /^\[/ { for(i=10;i<=NF;i++)  if($i ~ /^(t\/[0-9\/]+|other)$/)  print $6 "\t" $i }' data.out/dump_$curve/names.content.dump | sort -n | cut -f2 | xargs`
+  test "$got" == "${db#*:}" || echo "ERROR SUMMARY: $curve order placed <$got>" |& tee -a $0.log
+done
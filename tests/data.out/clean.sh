@@ -1,3 +1,3 @@
 #!/bin/bash
 
-rm -Rf db dump extract extract2
+rm -Rf db dbhot dbhot.json dbmph dbfront dbfront.list dbcdc cdc.in cdc.list extract_cdc dump extract extract2 file.list file2.list dbcols extract3 dbsample get.tsv get_budget.tsv pool.in pool.list pool.names dbpool pool.tsv pool_read.tsv get_pool.tsv hotkey.tsv hotkey.list dbkeys cols.list cols.sel sample.list sample.tsv aio.tsv aio_sync.tsv dbaio tiles.list tiles_props.list dbhilbert dbzorder dump_hilbert dump_zorder dump_hot
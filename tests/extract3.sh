@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# float column ratio beside integer key2 and sample-weight
+sed -e 's#^data.in/8$#data.in/8\tratio:0.25#' -e 's#^data.in/7$#data.in/7\tratio:2.5#' -e 's#^data.in/6$#data.in/6\tratio:-1.75#' source.in >data.out/cols.list
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbcols -s data.out/cols.list -O columns=1 |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -x -d data.out/dbcols -o data.out/extract3 -q 'key2>100 && key2!=13' |& tee -a $0.log
+test -f data.out/extract3/data.in/9 -a ! -f data.out/extract3/data.in/4 || echo "ERROR SUMMARY: predicate selected wrong names" |& tee -a $0.log
+
+# predicate, names it shall select
+while IFS=: read -r q names; do
+  valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -l -d data.out/dbcols -o data.out/cols.sel -q "$q" |& tee -a $0.log
+  test "`cut -f1 data.out/cols.sel | sort | xargs`" == "$names" || echo "ERROR SUMMARY: predicate $q selected wrong names" |& tee -a $0.log
+done <<'LIST'
+key2==13:data.in/4
+key2<=13:data.in/4
+key2>=13 && key2<=666:data.in/4 data.in/9
+ratio<=0.25:data.in/6 data.in/8
+ratio==2.5:data.in/7
+ratio>-1.75 && ratio<2.5:data.in/8
+ratio!=0.25 && ratio<=2.5:data.in/6 data.in/7
+sample-weight==3.1415926:data.in/3
+sample-weight<=3.14:
+LIST
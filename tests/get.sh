@@ -0,0 +1,5 @@
+#!/bin/bash
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/db -s source.in -o data.out/get.tsv |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/db -s source.in -o data.out/get_budget.tsv -O names_budget=300 |& tee -a $0.log
+cmp data.out/get.tsv data.out/get_budget.tsv || echo "ERROR SUMMARY: lookups with names_budget differ" |& tee -a $0.log
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+# data.in/4 leads first window, halved it falls behind data.in/3 of the second one
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/db -s hotkey.in -o data.out/hotkey.tsv -k data.out/hotkey.list |& tee $0.log
+cmp hotkey.expect data.out/hotkey.list || echo "ERROR SUMMARY: hot list differs" |& tee -a $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbkeys -s source.in -O hot=data.out/hotkey.list |& tee -a $0.log
@@ -1,3 +1,4 @@
 #!/bin/bash
 
 valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -l -d data.out/db -o data.out/file.list |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -l -d data.out/db -o data.out/file2.list -f 'data.in/@(deep|dup)*' |& tee -a $0.log
@@ -0,0 +1,14 @@
+#!/bin/bash
+
+# content several times bigger than smallest pool, every name twice so pages are reused after eviction
+mkdir -p data.out/pool.in
+for i in 1 2 3 4 5 6 7 8; do seq $i 9 $((i*60000)) >data.out/pool.in/$i; done
+for i in 1 2 3 4 5 6 7 8; do printf "pool/$i\t:data.out/pool.in/$i\n"; done >data.out/pool.list
+cut -f1 data.out/pool.list data.out/pool.list >data.out/pool.names
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbpool -s data.out/pool.list |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/dbpool -s data.out/pool.names -o data.out/pool.tsv |& tee -a $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/dbpool -s data.out/pool.names -o data.out/pool_read.tsv -O pool=64k -O pool_page=4k |& tee -a $0.log
+cmp data.out/pool.tsv data.out/pool_read.tsv || echo "ERROR SUMMARY: lookups through buffer pool differ" |& tee -a $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/db -s source.in -o data.out/get_pool.tsv -O pool=1m |& tee -a $0.log
+cmp data.out/get.tsv data.out/get_pool.tsv || echo "ERROR SUMMARY: lookups through buffer pool differ" |& tee -a $0.log
@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# weights 3.14, 3 and 1; zero, negative and non numeric weights are never drawn
+sed -e 's#^data.in/7$#data.in/7\tsample-weight:3#' -e 's#^data.in/8$#data.in/8\tsample-weight:1#' -e 's#^data.in/6$#data.in/6\tsample-weight:0#' \
+    -e 's#^data.in/5$#data.in/5\tsample-weight:-2#' -e 's#^data.in/dup4$#data.in/dup4\tsample-weight:heavy#' source.in >data.out/sample.list
+
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -c -d data.out/dbsample -s data.out/sample.list -O sample=sample-weight |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -i -d data.out/dbsample |& tee -a $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -g -d data.out/dbsample -n 20000 -o data.out/sample.tsv |& tee -a $0.log
+cut -f1 data.out/sample.tsv | sort | uniq -c | awk '
+  { n[$2]=$1; total+=$1; names++ }
+  END {
+    if(total!=20000 || names!=3)  bad=1
+    # expected shares 0.440, 0.420, 0.140
+    if(n["data.in/3"]<0.41*total || n["data.in/3"]>0.47*total)  bad=1
+    if(n["data.in/7"]<0.39*total || n["data.in/7"]>0.45*total)  bad=1
+    if(n["data.in/8"]<0.12*total || n["data.in/8"]>0.16*total)  bad=1
+    if(bad)  print "ERROR SUMMARY: weighted sampler drew wrong names"
+  }' |& tee -a $0.log
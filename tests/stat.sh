@@ -1,3 +1,6 @@
 #!/bin/bash
 
 valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -i -d data.out/db |& tee $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -i -d data.out/db -O pool=1m |& tee -a $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -i -d data.out/db -O verify=0 -O populate=idx,names -O content_advice=sequential |& tee -a $0.log
+valgrind --tool=memcheck --leak-check=full --num-callers=24 --show-reachable=yes --track-fds=yes ../src/hugefile -i -d data.out/db -s 0 -O mlock=idx,dict |& tee -a $0.log